@@ -20,6 +20,10 @@
 #include "assets/ChColorAsset.h"
 #include "unit_IRRLICHT/ChIrrApp.h"
 #include "utils/ChUtilsInputOutput.h"
+#include "utils/ChUtilsAsyncWriter.h"
+#include "utils/ChUtilsTelemetry.h"
+#include "utils/ChUtilsMassProperties.h"
+#include "utils/ChUtilsCreators.h"
 #include "core/ChFileutils.h"
 #include "core/ChStream.h"
 #include "core/ChRealtimeStep.h"
@@ -67,6 +71,22 @@ bool fixed = false;
 #define USE_IRRLICHT
 
 
+// Set the mass properties of a beam from the box shapes attached to it.
+void SetBeamMass(ChSharedPtr<ChBodyAuxRef> beam, double density) {
+	utils::ChCompositeInertia composite;
+
+	std::vector<ChSharedPtr<ChAsset> >& assets = beam->GetAssets();
+	for (size_t i = 0; i < assets.size(); i++) {
+		if (ChSharedPtr<ChBoxShape> box = assets[i].DynamicCastTo<ChBoxShape>()) {
+			const geometry::ChBox& geom = box->GetBoxGeometry();
+			composite.AddBox(geom.Size, density, geom.Pos, geom.Rot.Get_A_quaternion());
+		}
+	}
+
+	composite.ApplyTo(beam.get_ptr());
+}
+
+
 int main(int argc, char* argv[]) {
 
 	const std::string out_dir = "../VEHICLE";
@@ -87,32 +107,17 @@ int main(int argc, char* argv[]) {
 
 	//////////////////////////////Create the Robot//////////////////////////////////(Just one side)/////////////
 	//create the wheels
-	ChSharedPtr<ChBodyEasyCylinder> rearWheel(new ChBodyEasyCylinder(0.1, .15, 100, true, true));
-	rearWheel->SetPos({0.2, 0.5, 0.0});
-	rearWheel->SetRot(Q_from_AngAxis(CH_C_PI / 2.0, { 0, 0, 1.0 }));
-	//rearWheel->SetBodyFixed(fixed);
-	rearWheel->GetMaterialSurface()->SetFriction(0.8);
-	rearWheel->GetMaterialSurface()->SetRollingFriction(0.1);
-	rearWheel->GetMaterialSurface()->SetRestitution(0.0);
-	mphysicalSystem.Add(rearWheel);
-
-	ChSharedPtr<ChBodyEasyCylinder> middleWheel(new ChBodyEasyCylinder(0.1, .15, 100, true, true));
-	middleWheel->SetPos({ 0.2, 0.5, 0.5 });
-	middleWheel->SetRot(Q_from_AngAxis(CH_C_PI / 2.0, { 0, 0, 1.0 }));
-	//middleWheel->SetBodyFixed(fixed);
-	middleWheel->GetMaterialSurface()->SetFriction(0.8);
-	middleWheel->GetMaterialSurface()->SetRollingFriction(0.1);
-	middleWheel->GetMaterialSurface()->SetRestitution(0.0);
-	mphysicalSystem.Add(middleWheel);
-
-	ChSharedPtr<ChBodyEasyCylinder> frontWheel(new ChBodyEasyCylinder(0.1, .15, 100, true, true));
-	frontWheel->SetPos({ 0.2, 0.5, 1.0 });
-	frontWheel->SetRot(Q_from_AngAxis(CH_C_PI / 2.0, { 0, 0, 1.0 }));
-	//frontWheel->SetBodyFixed(fixed);
-	frontWheel->GetMaterialSurface()->SetFriction(0.8);
-	frontWheel->GetMaterialSurface()->SetRollingFriction(0.1);
-	frontWheel->GetMaterialSurface()->SetRestitution(0.0);
-	mphysicalSystem.Add(frontWheel);
+	ChSharedPtr<ChBodyEasyCylinder> wheelProto(new ChBodyEasyCylinder(0.1, .15, 100, true, true));
+	wheelProto->GetMaterialSurface()->SetFriction(0.8);
+	wheelProto->GetMaterialSurface()->SetRollingFriction(0.1);
+	wheelProto->GetMaterialSurface()->SetRestitution(0.0);
+	//all wheels are clones of this one (sharing its collision shape and material)
+	utils::ChBodyPrototype wheelPrototype(wheelProto);
+	ChQuaternion<> wheelRot = Q_from_AngAxis(CH_C_PI / 2.0, { 0, 0, 1.0 });
+
+	ChSharedPtr<ChBody> rearWheel = wheelPrototype.AddClone(&mphysicalSystem, { 0.2, 0.5, 0.0 }, wheelRot);
+	ChSharedPtr<ChBody> middleWheel = wheelPrototype.AddClone(&mphysicalSystem, { 0.2, 0.5, 0.5 }, wheelRot);
+	ChSharedPtr<ChBody> frontWheel = wheelPrototype.AddClone(&mphysicalSystem, { 0.2, 0.5, 1.0 }, wheelRot);
 
 	//rear leg
 	ChSharedPtr<ChBodyEasyBox> rearLeg(new ChBodyEasyBox(0.02, 0.2, 0.02, tubeDensity, false, true));
@@ -121,9 +126,8 @@ int main(int argc, char* argv[]) {
 	mphysicalSystem.Add(rearLeg);
 
 	//rear beam
-	ChSharedPtr<ChBody> rearBeam(new ChBody());
+	ChSharedPtr<ChBodyAuxRef> rearBeam(new ChBodyAuxRef());
 	rearBeam->SetDensity(2000.0);
-	rearBeam->SetMass(0.5);
 
 	ChSharedPtr<ChBoxShape> vshape1(new ChBoxShape());
 	vshape1->GetBoxGeometry().SetLengths({ 0.02, 0.02, 0.548 });
@@ -136,14 +140,14 @@ int main(int argc, char* argv[]) {
 	vshape2->GetBoxGeometry().Pos = { 0, 0.75, 0.625 };
 	vshape2->GetBoxGeometry().Rot = Q_from_AngAxis(.381, { 1.0, 0, 0 });
 	rearBeam->AddAsset(vshape2);
+	SetBeamMass(rearBeam, 2000.0);
 
 	rearBeam->SetBodyFixed(fixed);
 	mphysicalSystem.Add(rearBeam);
 
 	//front beam
-	ChSharedPtr<ChBody> frontBeam(new ChBody());
+	ChSharedPtr<ChBodyAuxRef> frontBeam(new ChBodyAuxRef());
 	frontBeam->SetDensity(2000.0);
-	frontBeam->SetMass(0.5);
 
 	ChSharedPtr<ChBoxShape> vshape3(new ChBoxShape());
 	vshape3->GetBoxGeometry().SetLengths({ 0.02, 0.02, 0.320 });
@@ -156,6 +160,7 @@ int main(int argc, char* argv[]) {
 	vshape4->GetBoxGeometry().Pos = { 0.125, 0.7, 0.875 };
 	vshape4->GetBoxGeometry().Rot = Q_from_AngAxis(.540, { 0, 1.0, 0 });
 	frontBeam->AddAsset(vshape4);
+	SetBeamMass(frontBeam, 2000.0);
 
 	//frontBeam->SetBodyFixed(fixed);
 	mphysicalSystem.Add(frontBeam);
@@ -175,32 +180,9 @@ int main(int argc, char* argv[]) {
 
 	/////////////////////////Left Side//////////////////////////////////////////////
 	//create the wheels
-	ChSharedPtr<ChBodyEasyCylinder> rearWheelL(new ChBodyEasyCylinder(0.1, .15, 100, true, true));
-	rearWheelL->SetPos({ -.7, 0.5, 0.0 });
-	rearWheelL->SetRot(Q_from_AngAxis(CH_C_PI / 2.0, { 0, 0, 1.0 }));
-	//rearWheelL->SetBodyFixed(fixed);
-	rearWheelL->GetMaterialSurface()->SetFriction(0.8);
-	rearWheelL->GetMaterialSurface()->SetRollingFriction(0.1);
-	rearWheelL->GetMaterialSurface()->SetRestitution(0.0);
-	mphysicalSystem.Add(rearWheelL);
-
-	ChSharedPtr<ChBodyEasyCylinder> middleWheelL(new ChBodyEasyCylinder(0.1, .15, 100, true, true));
-	middleWheelL->SetPos({ -.7, 0.5, 0.5 });
-	middleWheelL->SetRot(Q_from_AngAxis(CH_C_PI / 2.0, { 0, 0, 1.0 }));
-	//middleWheelL->SetBodyFixed(fixed);
-	middleWheelL->GetMaterialSurface()->SetFriction(0.8);
-	middleWheelL->GetMaterialSurface()->SetRollingFriction(0.1);
-	middleWheelL->GetMaterialSurface()->SetRestitution(0.0);
-	mphysicalSystem.Add(middleWheelL);
-
-	ChSharedPtr<ChBodyEasyCylinder> frontWheelL(new ChBodyEasyCylinder(0.1, .15, 100, true, true));
-	frontWheelL->SetPos({ -.7, 0.5, 1.0 });
-	frontWheelL->SetRot(Q_from_AngAxis(CH_C_PI / 2.0, { 0, 0, 1.0 }));
-	//frontWheelL->SetBodyFixed(fixed);
-	frontWheelL->GetMaterialSurface()->SetFriction(0.8);
-	frontWheelL->GetMaterialSurface()->SetRollingFriction(0.1);
-	frontWheelL->GetMaterialSurface()->SetRestitution(0.0);
-	mphysicalSystem.Add(frontWheelL);
+	ChSharedPtr<ChBody> rearWheelL = wheelPrototype.AddClone(&mphysicalSystem, { -.7, 0.5, 0.0 }, wheelRot);
+	ChSharedPtr<ChBody> middleWheelL = wheelPrototype.AddClone(&mphysicalSystem, { -.7, 0.5, 0.5 }, wheelRot);
+	ChSharedPtr<ChBody> frontWheelL = wheelPrototype.AddClone(&mphysicalSystem, { -.7, 0.5, 1.0 }, wheelRot);
 
 	//rear leg
 	ChSharedPtr<ChBodyEasyBox> rearLegL(new ChBodyEasyBox(0.02, 0.2, 0.02, tubeDensity, false, true));
@@ -209,9 +191,8 @@ int main(int argc, char* argv[]) {
 	mphysicalSystem.Add(rearLegL);
 
 	//rear beam
-	ChSharedPtr<ChBody> rearBeamL(new ChBody());
+	ChSharedPtr<ChBodyAuxRef> rearBeamL(new ChBodyAuxRef());
 	rearBeamL->SetDensity(2000.0);
-	rearBeamL->SetMass(0.5);
 
 	ChSharedPtr<ChBoxShape> vshape1L(new ChBoxShape());
 	vshape1L->GetBoxGeometry().SetLengths({ 0.02, 0.02, 0.548 });
@@ -224,14 +205,14 @@ int main(int argc, char* argv[]) {
 	vshape2L->GetBoxGeometry().Pos = { -.5, 0.75, 0.625 };
 	vshape2L->GetBoxGeometry().Rot = Q_from_AngAxis(.381, { 1.0, 0, 0 });
 	rearBeamL->AddAsset(vshape2L);
+	SetBeamMass(rearBeamL, 2000.0);
 
 	rearBeamL->SetBodyFixed(fixed);
 	mphysicalSystem.Add(rearBeamL);
 
 	//front beam
-	ChSharedPtr<ChBody> frontBeamL(new ChBody());
+	ChSharedPtr<ChBodyAuxRef> frontBeamL(new ChBodyAuxRef());
 	frontBeamL->SetDensity(2000.0);
-	frontBeamL->SetMass(0.5);
 
 	ChSharedPtr<ChBoxShape> vshape3L(new ChBoxShape());
 	vshape3L->GetBoxGeometry().SetLengths({ 0.02, 0.02, 0.320 });
@@ -244,6 +225,7 @@ int main(int argc, char* argv[]) {
 	vshape4L->GetBoxGeometry().Pos = { -.625, 0.7, 0.875 };
 	vshape4L->GetBoxGeometry().Rot = Q_from_AngAxis(-.540, { 0, 1.0, 0 });
 	frontBeamL->AddAsset(vshape4L);
+	SetBeamMass(frontBeamL, 2000.0);
 
 	//frontBeam->SetBodyFixed(fixed);
 	mphysicalSystem.Add(frontBeamL);
@@ -418,9 +400,7 @@ int main(int argc, char* argv[]) {
 	ground->SetBodyFixed(true);
 	mphysicalSystem.Add(ground);
 
-	ChSharedPtr<ChColorAsset> mcolor(new ChColorAsset());
-	mcolor->SetColor(ChColor(0.2, 0.25, 0.25));
-	ground->AddAsset(mcolor);
+	ground->AddAsset(utils::GetSharedColor(ChColor(0.2, 0.25, 0.25)));
 
 	ChSharedPtr<ChBodyEasyBox> step(new ChBodyEasyBox(5.0, 0.5, 4.0, 5000.0, true, true));
 	step->SetPos({ 0, 0.25, 3.5 });
@@ -442,8 +422,7 @@ int main(int argc, char* argv[]) {
 	step4->SetBodyFixed(true);
 	mphysicalSystem.Add(step4);
 
-	ChSharedPtr<ChColorAsset> stepColor(new ChColorAsset());
-	stepColor->SetColor(ChColor(0.2, 0.6, 0.25));
+	ChSharedPtr<ChColorAsset> stepColor = utils::GetSharedColor(ChColor(0.2, 0.6, 0.25));
 	step->AddAsset(stepColor);
 	step2->AddAsset(stepColor);
 	step3->AddAsset(stepColor);
@@ -474,6 +453,9 @@ int main(int argc, char* argv[]) {
 
 	char filename[100];
 
+	// Output frames are written by a background thread (pending frames are
+	// flushed when the writer goes out of scope).
+	utils::ChAsyncShapesWriter pov_writer(16, utils::ChAsyncShapesWriter::BLOCK);
 
 #endif
 	mphysicalSystem.SetIterLCPmaxItersSpeed(iterSpeed);
@@ -503,6 +485,18 @@ int main(int argc, char* argv[]) {
 	
 
 	
+	// Live state of the rover body and wheels, published without blocking
+	// (watch with: telemetry_subscriber rover).
+	utils::ChTelemetryPublisher telemetry;
+	telemetry.Open("rover");
+	telemetry.AddBody(centerRod.get_ptr());
+	telemetry.AddBody(rearWheel.get_ptr());
+	telemetry.AddBody(middleWheel.get_ptr());
+	telemetry.AddBody(frontWheel.get_ptr());
+	telemetry.AddBody(rearWheelL.get_ptr());
+	telemetry.AddBody(middleWheelL.get_ptr());
+	telemetry.AddBody(frontWheelL.get_ptr());
+
 	////////////////////////////Simulation Loop//////////////////////////////////
 
 #ifdef USE_IRRLICHT
@@ -523,7 +517,7 @@ int main(int argc, char* argv[]) {
 
 			// Output render data
 			sprintf(filename, "%s/data_%04d.dat", pov_dir.c_str(), render_frame + 1);
-			utils::WriteShapesPovray(&mphysicalSystem, filename);
+			pov_writer.Submit(&mphysicalSystem, filename);
 			std::cout << "Output frame:   " << render_frame << std::endl;
 			std::cout << "Sim frame:      " << step_number << std::endl;
 			std::cout << "Time:           " << time << std::endl;
@@ -535,7 +529,7 @@ int main(int argc, char* argv[]) {
 
 
 		if (step_number % 100 == 0){
-			std::cout << "Time:   " << time << std::endl;
+			telemetry.Publish(mphysicalSystem.GetChTime());
 		}
 		//printf("leg is at: %f, %f, %f\n", rearWheel->GetPos().x, rearWheel->GetPos().y, rearWheel->GetPos().z);
 		//for (long j = 0; j < 200; j++){
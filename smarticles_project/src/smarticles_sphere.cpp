@@ -27,7 +27,12 @@
 #include "core/ChRealtimeStep.h"
 #include "unit_POSTPROCESS/ChPovRay.h"
 #include "unit_POSTPROCESS/ChPovRayAssetCustom.h"
+#include "utils/ChUtilsCreators.h"
+#include "utils/ChUtilsGenerators.h"
+#include "utils/ChUtilsSamplers.h"
 #include "utils/ChUtilsInputOutput.h"
+#include "utils/ChUtilsAsyncWriter.h"
+#include "utils/ChUtilsTelemetry.h"
 
 
 
@@ -196,9 +201,7 @@ int main(int argc, char* argv[]) {
 	mphysicalSystem.Add(floorBody);
 
 	//set color for floor for visualization
-	ChSharedPtr<ChColorAsset> mcolor(new ChColorAsset());
-	mcolor->SetColor(ChColor(0.2, 0.25, 0.25));
-	floorBody->AddAsset(mcolor);
+	floorBody->AddAsset(utils::GetSharedColor(ChColor(0.2, 0.25, 0.25)));
 
 	//CREATE CENTER SPHERE
 	ChSharedPtr<ChBodyEasySphere> mSphere(new ChBodyEasySphere(sphereRadius, sphereDensity, false, true));
@@ -207,9 +210,7 @@ int main(int argc, char* argv[]) {
 	mphysicalSystem.Add(mSphere);
 
 	//add texture to the sphere for visualization
-	ChSharedPtr<ChTexture> mtexture(new ChTexture());
-	mtexture->SetTextureFilename(GetChronoDataFile("wood01.jpg"));  // texture in ../data
-	mSphere->AddAsset(mtexture);
+	mSphere->AddAsset(utils::GetSharedTexture(GetChronoDataFile("wood01.jpg")));  // texture in ../data
 
 	double xPos = 0;
 	double yPos = 0;
@@ -223,7 +224,11 @@ int main(int argc, char* argv[]) {
 	std::vector<ChSharedPtr<ChLinkDistance>> dists;
 	std::vector<ChSharedPtr<ChBody>> legs;
 
-
+	//build one leg (geometry, mass, texture) and clone it at each vertex;
+	//the clones share the collision shape, material and texture of the prototype
+	ChSharedPtr<ChBodyEasyCylinder> legProto(new ChBodyEasyCylinder(legRadius, legLength, legDensity, true, true));
+	legProto->AddAsset(utils::GetSharedTexture(GetChronoDataFile("redwhite.png")));
+	utils::ChBodyPrototype legPrototype(legProto);
 
 
 	for (int i = 0; i < vertices.size(); i++)
@@ -232,8 +237,6 @@ int main(int argc, char* argv[]) {
 		yPos = 0.02*vertices[i][1];
 		zPos = 0.02*vertices[i][2];
 
-		ChSharedPtr<ChBodyEasyCylinder> mleg(new ChBodyEasyCylinder(legRadius, legLength, legDensity, true, true));
-
 		//find axis of rotation
 		ChVector<double> axis{ 0.0, 0.0, 0.0 };
 		ChVector<double> start{ 0.0, 1.0, 0.0 };
@@ -255,9 +258,7 @@ int main(int argc, char* argv[]) {
 		axis.y = axis.y / length;
 		axis.z = axis.z / length;
 
-		mleg->SetRot(Q_from_AngAxis(ang, axis));
-		mleg->SetPos(ChVector<>(xPos, yPos, zPos));
-		mphysicalSystem.Add(mleg);
+		ChSharedPtr<ChBody> mleg = legPrototype.AddClone(&mphysicalSystem, ChVector<>(xPos, yPos, zPos), Q_from_AngAxis(ang, axis));
 
 		//add the prismatic contraint
 		ChSharedPtr<ChLinkLockPrismatic> legLink = ChSharedPtr<ChLinkLockPrismatic>(new ChLinkLockPrismatic);
@@ -281,11 +282,6 @@ int main(int argc, char* argv[]) {
 			mphysicalSystem.AddLink(legDis);
 		}
 
-		//add a textrue to the legs
-		ChSharedPtr<ChTexture> mlegTexture(new ChTexture());
-		mlegTexture->SetTextureFilename(GetChronoDataFile("redwhite.png"));
-		mleg->AddAsset(mlegTexture);
-
 		legs.push_back(mleg);
 	}
 
@@ -293,15 +289,16 @@ int main(int argc, char* argv[]) {
 
 	if (actuator){
 
+		//all obstacles share one texture asset
+		ChSharedPtr<ChTexture> obstacleTexture = utils::GetSharedTexture(GetChronoDataFile("cubetexture_bluwhite.png"));
+
 		ChSharedPtr<ChBodyEasyBox> mob(new ChBodyEasyBox(
 			.2, 2, 5, 3000, true, true));
 		mob->SetPos(ChVector<>(3.00, 0, 0));
 		mob->SetBodyFixed(true);
 		mphysicalSystem.Add(mob);
 
-		ChSharedPtr<ChTexture> mobTexture(new ChTexture());
-		mobTexture->SetTextureFilename(GetChronoDataFile("cubetexture_bluwhite.png"));
-		mob->AddAsset(mobTexture);
+		mob->AddAsset(obstacleTexture);
 
 		ChSharedPtr<ChBodyEasyBox> mob1(new ChBodyEasyBox(
 			5, .2, 5, 3000, true, true));
@@ -310,9 +307,7 @@ int main(int argc, char* argv[]) {
 		mob1->SetBodyFixed(true);
 		mphysicalSystem.Add(mob1);
 
-		ChSharedPtr<ChTexture> mob1Texture(new ChTexture());
-		mob1Texture->SetTextureFilename(GetChronoDataFile("cubetexture_bluwhite.png"));
-		mob1->AddAsset(mob1Texture);
+		mob1->AddAsset(obstacleTexture);
 
 		ChSharedPtr<ChBodyEasyBox> mob2(new ChBodyEasyBox(
 			3.0, 0.5, 0.1, 3000, true, true));
@@ -320,9 +315,7 @@ int main(int argc, char* argv[]) {
 		mob2->SetBodyFixed(true);
 		mphysicalSystem.Add(mob2);
 
-		ChSharedPtr<ChTexture> mobTexture2(new ChTexture());
-		mobTexture2->SetTextureFilename(GetChronoDataFile("cubetexture_bluwhite.png"));
-		mob2->AddAsset(mobTexture2);
+		mob2->AddAsset(obstacleTexture);
 
 		ChSharedPtr<ChBodyEasyBox> mob3(new ChBodyEasyBox(
 			3.0, 0.5, 0.1, 3000, true, true));
@@ -330,31 +323,18 @@ int main(int argc, char* argv[]) {
 		mob3->SetBodyFixed(true);
 		mphysicalSystem.Add(mob3);
 
-		ChSharedPtr<ChTexture> mobTexture3(new ChTexture());
-		mobTexture3->SetTextureFilename(GetChronoDataFile("cubetexture_bluwhite.png"));
-		mob3->AddAsset(mobTexture3);
+		mob3->AddAsset(obstacleTexture);
 
 
 	}
 	/*
-	//create some rolling spheres
-	int numSpheres = 100;
-	for (int i = 0; i < numSpheres; i++){
-	ChSharedPtr<ChBodyEasySphere> mSphs(new ChBodyEasySphere(0.03, 800000.0, true, true));
-	double x1 = rand() % 100;
-	double y1 = rand() % 100;
-	double z1 = rand() % 100;
-	mSphs->SetPos(ChVector<>(1.25 + x1/100.0, .25 + y1/100.0, -1.0 + z1/50.0));
-	//mSphere->SetBodyFixed(true);	//**will remove once the sphere has all its legs and ready to move**************************************************************
-	mphysicalSystem.Add(mSphs);
-
-	//add texture to the sphere for visualization
-	ChSharedPtr<ChTexture> mtextureS(new ChTexture());
-	mtextureS->SetTextureFilename(GetChronoDataFile("bluwhite.png"));  // texture in ../data
-	mSphs->AddAsset(mtextureS);
+	//create a bed of rolling spheres, laid out with a Poisson disk sampler
+	utils::ChParticleGenerator sphereGenerator(&mphysicalSystem, ChSharedPtr<ChMaterialSurface>(new ChMaterialSurface));
+	int sphereType = sphereGenerator.AddIngredient(utils::ChShape::Sphere(0.03), 800000.0);
+	sphereGenerator.AddIngredientAsset(sphereType, utils::GetSharedTexture(GetChronoDataFile("bluwhite.png")));  // texture in ../data
 
-
-	}
+	utils::ChPDSampler sphereSampler(0.06);
+	sphereGenerator.FillBox(sphereSampler, ChVector<>(1.75, 0.75, 0), ChVector<>(0.5, 0.5, 1.0));
 	*/
 
 
@@ -465,7 +445,17 @@ int main(int argc, char* argv[]) {
 
 	char filename[100];
 
-	while (true){//application.GetDevice()->run()) {
+	// Output frames are written by a background thread (pending frames are
+	// flushed at the end of the simulation).
+	utils::ChAsyncShapesWriter pov_writer(16, utils::ChAsyncShapesWriter::BLOCK);
+
+	// Live sphere state, published without blocking (samples are dropped if no
+	// subscriber keeps up).
+	utils::ChTelemetryPublisher telemetry;
+	telemetry.Open("smarticles");
+	telemetry.AddBody(mSphere.get_ptr());
+
+	while (application.GetDevice()->run() && time < tend) {
 		//application.AddTypicalCamera(core::vector3df(mSphere->GetPos().x - 3.0, mSphere->GetPos().y + 3.25, mSphere->GetPos().z),
 		//	core::vector3df(0, 0, 0));
 		application.BeginScene();
@@ -484,10 +474,8 @@ int main(int argc, char* argv[]) {
 
 		//Get velocity
 		if ((tim % (int)((1 / timestep) / 5) == 0)){
-			printf("Position: \t %f, %f, %f\n", mSphere->GetPos().x, mSphere->GetPos().y, mSphere->GetPos().z);
-			printf("Velocity:\t %f, %f, %f\n", mSphere->GetPos_dt().x, mSphere->GetPos_dt().y, mSphere->GetPos_dt().z);
-			printf("Acceleration:\t %f, %f, %f\n", mSphere->GetPos_dtdt().x, mSphere->GetPos_dtdt().y, mSphere->GetPos_dtdt().z);
-			printf("Tim is: %ld\n", tim);
+			// Sphere position, velocity and acceleration (see telemetry_subscriber).
+			telemetry.Publish(mphysicalSystem.GetChTime());
 
 			//printf("forward: %d\n", forward);
 			//printf("back:\t %d\n", back);
@@ -503,7 +491,7 @@ int main(int argc, char* argv[]) {
 
 			// Output render data
 			sprintf(filename, "%s/data_%03d.dat", pov_dir.c_str(), render_frame + 1);
-			utils::WriteShapesPovray(&mphysicalSystem, filename);
+			pov_writer.Submit(&mphysicalSystem, filename);
 			std::cout << "Output frame:   " << render_frame << std::endl;
 			std::cout << "Sim frame:      " << step_number << std::endl;
 			std::cout << "Time:           " << time << std::endl;
@@ -724,6 +712,10 @@ int main(int argc, char* argv[]) {
 		step_number++;
 		time += timestep;
 	}
+
+	// Wait for all submitted frames to be written.
+	pov_writer.Flush();
+
 	return 0;
 }
 
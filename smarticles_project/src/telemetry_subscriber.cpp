@@ -0,0 +1,80 @@
+//
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2013 Project Chrono
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file at the top level of the distribution
+// and at http://projectchrono.org/license-chrono.txt.
+//
+
+// Reference subscriber for the live telemetry of a running simulation.
+//
+// Usage:  telemetry_subscriber [endpoint] [csv_file]
+//
+// Prints every received sample or, if a file name is given, records the
+// samples in a CSV file (one line per body per sample: time, body identifier,
+// position, velocity, acceleration, orientation). The program exits when no
+// sample was received for 30 seconds.
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+#include "utils/ChUtilsInputOutput.h"
+#include "utils/ChUtilsTelemetry.h"
+
+using namespace chrono;
+
+
+int main(int argc, char* argv[]) {
+	std::string endpoint = (argc > 1) ? argv[1] : "smarticles";
+	std::string csv_file = (argc > 2) ? argv[2] : "";
+
+	utils::ChTelemetrySubscriber subscriber;
+	if (!subscriber.Open(endpoint)) {
+		std::cout << "Cannot open telemetry endpoint "
+		          << utils::ChTelemetryPublisher::GetEndpointPath(endpoint) << std::endl;
+		return 1;
+	}
+
+	utils::CSV_writer csv(",");
+	if (!csv_file.empty() && !csv.open(csv_file)) {
+		std::cout << "Cannot create file " << csv_file << std::endl;
+		return 1;
+	}
+
+	std::cout << "Listening on " << utils::ChTelemetryPublisher::GetEndpointPath(endpoint) << std::endl;
+
+	const int idle_timeout = 30000;
+	size_t num_samples = 0;
+	utils::ChTelemetrySample sample;
+
+	while (subscriber.Receive(sample, idle_timeout)) {
+		num_samples++;
+
+		for (size_t i = 0; i < sample.bodies.size(); i++) {
+			const utils::ChTelemetryBodyState& s = sample.bodies[i];
+
+			if (csv_file.empty()) {
+				printf("t = %f  body %d\n", sample.time, s.id);
+				printf("Position: \t %f, %f, %f\n", s.pos[0], s.pos[1], s.pos[2]);
+				printf("Velocity:\t %f, %f, %f\n", s.vel[0], s.vel[1], s.vel[2]);
+				printf("Acceleration:\t %f, %f, %f\n", s.acc[0], s.acc[1], s.acc[2]);
+			} else {
+				csv << sample.time << s.id;
+				csv.write(s.pos, 3).write(s.vel, 3).write(s.acc, 3).write(s.rot, 4);
+				csv << std::endl;
+			}
+		}
+	}
+
+	if (!csv_file.empty())
+		csv.close();
+
+	std::cout << "Received " << num_samples << " samples (" << subscriber.GetNumLost() << " lost, "
+	          << subscriber.GetNumInvalid() << " invalid packets skipped)" << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,69 @@
+//
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2013 Project Chrono
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file at the top level of the distribution
+// and at http://projectchrono.org/license-chrono.txt.
+//
+
+// Batch validation of simulation results against reference data.
+//
+// Usage:  validate_batch manifest report_file [num_threads]
+//
+// Processes all jobs listed in the manifest (see ReadValidationManifest) and
+// writes a consolidated JSON report with the per-column norms and failures of
+// every job. The program returns 0 if all jobs passed, 1 otherwise.
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "utils/ChUtilsValidation.h"
+
+using namespace chrono;
+
+
+int main(int argc, char* argv[]) {
+	if (argc < 3) {
+		std::cout << "Usage: " << argv[0] << " manifest report_file [num_threads]" << std::endl;
+		return 1;
+	}
+
+	std::string manifest = argv[1];
+	std::string report = argv[2];
+	int num_threads = (argc > 3) ? std::atoi(argv[3]) : 0;
+
+	std::vector<utils::ChValidationJob> jobs;
+	size_t error_line;
+	if (!utils::ReadValidationManifest(manifest, jobs, error_line)) {
+		if (error_line > 0)
+			std::cout << "Invalid entry in " << manifest << " (line " << error_line << ")" << std::endl;
+		else
+			std::cout << "Cannot open file " << manifest << std::endl;
+		return 1;
+	}
+
+	std::vector<utils::ChValidationResult> results;
+	size_t num_failed = utils::ValidateBatch(jobs, results, num_threads);
+
+	for (size_t i = 0; i < jobs.size(); i++) {
+		if (!results[i].passed) {
+			std::cout << "FAILED: " << jobs[i].sim_filename;
+			if (!results[i].processed)
+				std::cout << " (" << results[i].error << ")";
+			std::cout << std::endl;
+		}
+	}
+
+	if (!utils::WriteValidationReport(report, jobs, results)) {
+		std::cout << "Cannot write file " << report << std::endl;
+		return 1;
+	}
+
+	std::cout << jobs.size() - num_failed << " of " << jobs.size() << " jobs passed" << std::endl;
+
+	return (num_failed == 0) ? 0 : 1;
+}
@@ -0,0 +1,493 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Radu Serban
+// =============================================================================
+//
+// Single-file archive of PovRay output frames with random frame access.
+//
+// An archive consists of:
+//    header:   magic "CHSA", version (u32)
+//    frames:   one record per frame, each at an 8-byte aligned offset
+//    index:    for each frame, its simulation time (f64) and offset (u64)
+//    trailer:  index offset (u64), number of frames (u64), magic "CHSI",
+//              version (u32)
+// A frame record starts with a 48-byte header: magic "CHSR", the numbers of
+// bodies, assets, links, asset parameters, link parameters, the sizes of the
+// mesh names and static reference blocks (u32 each), the simulation time (f64)
+// and the total record size (u64). It is followed by the frame arrays, each
+// padded to a multiple of 8 bytes:
+//    f64:  body_pos, body_rot, asset_pos, asset_rot, asset_params, link_params
+//    f32:  asset_color
+//    i32:  body_id, asset_body_id, asset_type, asset_num_params, link_type,
+//          link_num_params
+//    u8:   body_active, asset_active, mesh_names, static_ref
+// All values are stored little-endian.
+//
+// =============================================================================
+
+#include <cstring>
+#include <algorithm>
+
+#include "utils/ChUtilsArchive.h"
+
+namespace chrono {
+namespace utils {
+
+
+static const char     ARCHIVE_MAGIC[4]  = {'C', 'H', 'S', 'A'};
+static const char     INDEX_MAGIC[4]    = {'C', 'H', 'S', 'I'};
+static const char     RECORD_MAGIC[4]   = {'C', 'H', 'S', 'R'};
+static const uint32_t ARCHIVE_VERSION   = 1;
+
+static const size_t   HEADER_SIZE       = 8;
+static const size_t   RECORD_HEADER_SIZE = 48;
+static const size_t   INDEX_ENTRY_SIZE  = 16;
+static const size_t   TRAILER_SIZE      = 24;
+
+
+// -----------------------------------------------------------------------------
+// Helper functions
+// -----------------------------------------------------------------------------
+static bool IsLittleEndian()
+{
+  const uint16_t one = 1;
+  return *(const unsigned char*) &one == 1;
+}
+
+static size_t Padded(size_t n)
+{
+  return (n + 7) & ~(size_t) 7;
+}
+
+template <typename T>
+static void PutRaw(std::vector<char>& buffer, const T& val)
+{
+  const char* p = (const char*) &val;
+  buffer.insert(buffer.end(), p, p + sizeof(T));
+}
+
+template <typename T>
+static T GetRaw(const char* data)
+{
+  T val;
+  std::memcpy(&val, data, sizeof(T));
+  return val;
+}
+
+// Append an array, converted to the element type T, padded to 8 bytes.
+template <typename T, typename S>
+static void PutBlock(std::vector<char>& buffer, const std::vector<S>& v)
+{
+  size_t start = buffer.size();
+  buffer.resize(start + Padded(v.size() * sizeof(T)), 0);
+  T* dst = (T*) (buffer.data() + start);
+  for (size_t i = 0; i < v.size(); i++)
+    dst[i] = (T) v[i];
+}
+
+// Return a pointer to an array of n elements of type T and advance the offset.
+template <typename T>
+static const T* GetBlock(const char* data, size_t& offset, size_t n)
+{
+  const T* p = (const T*) (data + offset);
+  offset += Padded(n * sizeof(T));
+  return p;
+}
+
+static size_t RecordSize(uint32_t nb, uint32_t na, uint32_t nl, uint32_t nap, uint32_t nlp,
+                         uint32_t nnames, uint32_t nref)
+{
+  return RECORD_HEADER_SIZE +
+         Padded(3 * (size_t) nb * 8) + Padded(4 * (size_t) nb * 8) +
+         Padded(3 * (size_t) na * 8) + Padded(4 * (size_t) na * 8) +
+         Padded((size_t) nap * 8) + Padded((size_t) nlp * 8) +
+         Padded(3 * (size_t) na * 4) +
+         Padded((size_t) nb * 4) + 3 * Padded((size_t) na * 4) + 2 * Padded((size_t) nl * 4) +
+         Padded(nb) + Padded(na) + Padded(nnames) + Padded(nref);
+}
+
+
+// -----------------------------------------------------------------------------
+// ShapesFrameView::CopyTo
+// -----------------------------------------------------------------------------
+void ShapesFrameView::CopyTo(ShapesFrame& frame) const
+{
+  frame.Clear();
+
+  frame.static_ref.assign(static_ref, static_ref_size);
+
+  frame.body_id.assign(body_id, body_id + num_bodies);
+  frame.body_active.assign(body_active, body_active + num_bodies);
+  frame.body_pos.assign(body_pos, body_pos + 3 * num_bodies);
+  frame.body_rot.assign(body_rot, body_rot + 4 * num_bodies);
+
+  frame.asset_body_id.assign(asset_body_id, asset_body_id + num_assets);
+  frame.asset_active.assign(asset_active, asset_active + num_assets);
+  frame.asset_pos.assign(asset_pos, asset_pos + 3 * num_assets);
+  frame.asset_rot.assign(asset_rot, asset_rot + 4 * num_assets);
+  frame.asset_color.assign(asset_color, asset_color + 3 * num_assets);
+  frame.asset_type.assign(asset_type, asset_type + num_assets);
+  frame.asset_num_params.assign(asset_num_params, asset_num_params + num_assets);
+  frame.asset_params.assign(asset_params, asset_params + num_asset_params);
+
+  frame.link_type.assign(link_type, link_type + num_links);
+  frame.link_num_params.assign(link_num_params, link_num_params + num_links);
+  frame.link_params.assign(link_params, link_params + num_link_params);
+
+  const char* name = mesh_names;
+  const char* end = mesh_names + mesh_names_size;
+  while (name < end) {
+    size_t len = strnlen(name, end - name);
+    frame.mesh_names.push_back(std::string(name, len));
+    name += len + 1;
+  }
+}
+
+
+// -----------------------------------------------------------------------------
+// ChShapesArchiveWriter
+// -----------------------------------------------------------------------------
+ChShapesArchiveWriter::ChShapesArchiveWriter()
+: m_offset(0)
+{
+}
+
+bool ChShapesArchiveWriter::Open(const std::string& filename)
+{
+  Close();
+
+  if (!IsLittleEndian())
+    return false;
+
+  m_file.open(filename.c_str(), std::ios::binary | std::ios::trunc);
+  if (!m_file.is_open())
+    return false;
+
+  m_buffer.clear();
+  m_buffer.insert(m_buffer.end(), ARCHIVE_MAGIC, ARCHIVE_MAGIC + 4);
+  PutRaw(m_buffer, ARCHIVE_VERSION);
+  m_file.write(m_buffer.data(), m_buffer.size());
+
+  m_offset = HEADER_SIZE;
+  m_times.clear();
+  m_offsets.clear();
+
+  return m_file.good();
+}
+
+bool ChShapesArchiveWriter::Close()
+{
+  if (!m_file.is_open())
+    return false;
+
+  m_buffer.clear();
+  for (size_t i = 0; i < m_times.size(); i++) {
+    PutRaw(m_buffer, m_times[i]);
+    PutRaw(m_buffer, m_offsets[i]);
+  }
+  PutRaw(m_buffer, m_offset);
+  PutRaw(m_buffer, (uint64_t) m_times.size());
+  m_buffer.insert(m_buffer.end(), INDEX_MAGIC, INDEX_MAGIC + 4);
+  PutRaw(m_buffer, ARCHIVE_VERSION);
+  m_file.write(m_buffer.data(), m_buffer.size());
+
+  bool ok = m_file.good();
+  m_file.close();
+
+  return ok;
+}
+
+void ChShapesArchiveWriter::AddFrame(const ShapesFrame& frame, double time)
+{
+  uint32_t nb = (uint32_t) frame.GetNumBodies();
+  uint32_t na = (uint32_t) frame.GetNumAssets();
+  uint32_t nl = (uint32_t) frame.GetNumLinks();
+  uint32_t nap = (uint32_t) frame.asset_params.size();
+  uint32_t nlp = (uint32_t) frame.link_params.size();
+  uint32_t nref = (uint32_t) frame.static_ref.size();
+
+  uint32_t nnames = 0;
+  for (size_t i = 0; i < frame.mesh_names.size(); i++)
+    nnames += (uint32_t) frame.mesh_names[i].size() + 1;
+
+  uint64_t size = RecordSize(nb, na, nl, nap, nlp, nnames, nref);
+
+  m_buffer.clear();
+  m_buffer.reserve(size);
+
+  m_buffer.insert(m_buffer.end(), RECORD_MAGIC, RECORD_MAGIC + 4);
+  PutRaw(m_buffer, nb);
+  PutRaw(m_buffer, na);
+  PutRaw(m_buffer, nl);
+  PutRaw(m_buffer, nap);
+  PutRaw(m_buffer, nlp);
+  PutRaw(m_buffer, nnames);
+  PutRaw(m_buffer, nref);
+  PutRaw(m_buffer, time);
+  PutRaw(m_buffer, size);
+
+  PutBlock<double>(m_buffer, frame.body_pos);
+  PutBlock<double>(m_buffer, frame.body_rot);
+  PutBlock<double>(m_buffer, frame.asset_pos);
+  PutBlock<double>(m_buffer, frame.asset_rot);
+  PutBlock<double>(m_buffer, frame.asset_params);
+  PutBlock<double>(m_buffer, frame.link_params);
+
+  PutBlock<float>(m_buffer, frame.asset_color);
+
+  PutBlock<int32_t>(m_buffer, frame.body_id);
+  PutBlock<int32_t>(m_buffer, frame.asset_body_id);
+  PutBlock<int32_t>(m_buffer, frame.asset_type);
+  PutBlock<uint32_t>(m_buffer, frame.asset_num_params);
+  PutBlock<int32_t>(m_buffer, frame.link_type);
+  PutBlock<uint32_t>(m_buffer, frame.link_num_params);
+
+  PutBlock<uint8_t>(m_buffer, frame.body_active);
+  PutBlock<uint8_t>(m_buffer, frame.asset_active);
+
+  size_t start = m_buffer.size();
+  for (size_t i = 0; i < frame.mesh_names.size(); i++)
+    m_buffer.insert(m_buffer.end(), frame.mesh_names[i].c_str(), frame.mesh_names[i].c_str() + frame.mesh_names[i].size() + 1);
+  m_buffer.resize(start + Padded(nnames), 0);
+
+  start = m_buffer.size();
+  m_buffer.insert(m_buffer.end(), frame.static_ref.begin(), frame.static_ref.end());
+  m_buffer.resize(start + Padded(nref), 0);
+
+  m_file.write(m_buffer.data(), m_buffer.size());
+
+  m_times.push_back(time);
+  m_offsets.push_back(m_offset);
+  m_offset += m_buffer.size();
+}
+
+void ChShapesArchiveWriter::AddFrame(ChSystem* system, bool body_info)
+{
+  UpdateShapesPlan(system, m_plan, ALL_BODIES);
+  CaptureShapes(m_plan, m_frame, body_info);
+  AddFrame(m_frame, system->GetChTime());
+}
+
+
+// -----------------------------------------------------------------------------
+// ChShapesArchiveReader
+// -----------------------------------------------------------------------------
+bool ChShapesArchiveReader::Open(const std::string& filename)
+{
+  m_times.clear();
+  m_offsets.clear();
+
+  if (!IsLittleEndian())
+    return false;
+
+  if (!m_file.Open(filename, false))
+    return false;
+
+  const char* data = m_file.GetData();
+  size_t size = m_file.GetSize();
+
+  if (size < HEADER_SIZE ||
+      std::memcmp(data, ARCHIVE_MAGIC, 4) != 0 ||
+      GetRaw<uint32_t>(data + 4) != ARCHIVE_VERSION) {
+    m_file.Close();
+    return false;
+  }
+
+  // Use the index if the archive was closed properly; otherwise, recover the
+  // frames written before the archive was interrupted.
+  if (!ReadIndex())
+    ScanFrames();
+
+  return true;
+}
+
+bool ChShapesArchiveReader::ReadIndex()
+{
+  const char* data = m_file.GetData();
+  size_t size = m_file.GetSize();
+
+  if (size < HEADER_SIZE + TRAILER_SIZE)
+    return false;
+
+  const char* trailer = data + size - TRAILER_SIZE;
+  uint64_t index_offset = GetRaw<uint64_t>(trailer);
+  uint64_t num_frames = GetRaw<uint64_t>(trailer + 8);
+
+  if (std::memcmp(trailer + 16, INDEX_MAGIC, 4) != 0 ||
+      GetRaw<uint32_t>(trailer + 20) != ARCHIVE_VERSION ||
+      index_offset < HEADER_SIZE ||
+      index_offset + num_frames * INDEX_ENTRY_SIZE + TRAILER_SIZE != size)
+    return false;
+
+  m_times.resize(num_frames);
+  m_offsets.resize(num_frames);
+
+  const char* entry = data + index_offset;
+  for (size_t i = 0; i < num_frames; i++, entry += INDEX_ENTRY_SIZE) {
+    m_times[i] = GetRaw<double>(entry);
+    m_offsets[i] = GetRaw<uint64_t>(entry + 8);
+    if ((m_offsets[i] & 7) != 0 || m_offsets[i] + RECORD_HEADER_SIZE > index_offset) {
+      m_times.clear();
+      m_offsets.clear();
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool ChShapesArchiveReader::ScanFrames()
+{
+  const char* data = m_file.GetData();
+  size_t size = m_file.GetSize();
+  uint64_t offset = HEADER_SIZE;
+
+  while (offset + RECORD_HEADER_SIZE <= size) {
+    const char* rec = data + offset;
+    if (std::memcmp(rec, RECORD_MAGIC, 4) != 0)
+      break;
+
+    uint64_t rec_size = GetRaw<uint64_t>(rec + 40);
+    if (rec_size < RECORD_HEADER_SIZE || (rec_size & 7) != 0 || offset + rec_size > size)
+      break;
+
+    m_times.push_back(GetRaw<double>(rec + 32));
+    m_offsets.push_back(offset);
+    offset += rec_size;
+  }
+
+  return !m_offsets.empty();
+}
+
+bool ChShapesArchiveReader::ParseFrame(uint64_t offset, ShapesFrameView& view) const
+{
+  std::memset(&view, 0, sizeof(view));
+
+  const char* data = m_file.GetData();
+  const char* rec = data + offset;
+
+  if (std::memcmp(rec, RECORD_MAGIC, 4) != 0)
+    return false;
+
+  uint32_t nb = GetRaw<uint32_t>(rec + 4);
+  uint32_t na = GetRaw<uint32_t>(rec + 8);
+  uint32_t nl = GetRaw<uint32_t>(rec + 12);
+  uint32_t nap = GetRaw<uint32_t>(rec + 16);
+  uint32_t nlp = GetRaw<uint32_t>(rec + 20);
+  uint32_t nnames = GetRaw<uint32_t>(rec + 24);
+  uint32_t nref = GetRaw<uint32_t>(rec + 28);
+  uint64_t rec_size = GetRaw<uint64_t>(rec + 40);
+
+  if (rec_size != RecordSize(nb, na, nl, nap, nlp, nnames, nref) || offset + rec_size > m_file.GetSize())
+    return false;
+
+  view.time = GetRaw<double>(rec + 32);
+  view.num_bodies = nb;
+  view.num_assets = na;
+  view.num_links = nl;
+  view.num_asset_params = nap;
+  view.num_link_params = nlp;
+
+  size_t pos = RECORD_HEADER_SIZE;
+  view.body_pos = GetBlock<double>(rec, pos, 3 * (size_t) nb);
+  view.body_rot = GetBlock<double>(rec, pos, 4 * (size_t) nb);
+  view.asset_pos = GetBlock<double>(rec, pos, 3 * (size_t) na);
+  view.asset_rot = GetBlock<double>(rec, pos, 4 * (size_t) na);
+  view.asset_params = GetBlock<double>(rec, pos, nap);
+  view.link_params = GetBlock<double>(rec, pos, nlp);
+
+  view.asset_color = GetBlock<float>(rec, pos, 3 * (size_t) na);
+
+  view.body_id = GetBlock<int32_t>(rec, pos, nb);
+  view.asset_body_id = GetBlock<int32_t>(rec, pos, na);
+  view.asset_type = GetBlock<int32_t>(rec, pos, na);
+  view.asset_num_params = GetBlock<uint32_t>(rec, pos, na);
+  view.link_type = GetBlock<int32_t>(rec, pos, nl);
+  view.link_num_params = GetBlock<uint32_t>(rec, pos, nl);
+
+  view.body_active = GetBlock<uint8_t>(rec, pos, nb);
+  view.asset_active = GetBlock<uint8_t>(rec, pos, na);
+
+  view.mesh_names = GetBlock<char>(rec, pos, nnames);
+  view.mesh_names_size = nnames;
+  view.static_ref = GetBlock<char>(rec, pos, nref);
+  view.static_ref_size = nref;
+
+  return true;
+}
+
+size_t ChShapesArchiveReader::FindFrame(double time) const
+{
+  std::vector<double>::const_iterator it = std::upper_bound(m_times.begin(), m_times.end(), time);
+  return (it == m_times.begin()) ? 0 : (it - m_times.begin()) - 1;
+}
+
+ShapesFrameView ChShapesArchiveReader::GetFrame(size_t frame) const
+{
+  // A corrupt record results in an empty frame.
+  ShapesFrameView view;
+  if (!ParseFrame(m_offsets[frame], view))
+    view.time = m_times[frame];
+
+  return view;
+}
+
+const char* ChShapesArchiveReader::GetBodyRecord(size_t frame, uint32_t& num_bodies) const
+{
+  const char* rec = m_file.GetData() + m_offsets[frame];
+  num_bodies = GetRaw<uint32_t>(rec + 4);
+  uint64_t rec_size = GetRaw<uint64_t>(rec + 40);
+
+  // Only check that the body arrays lie within the record (and the file).
+  if (m_offsets[frame] + rec_size > m_file.GetSize() ||
+      RECORD_HEADER_SIZE + Padded(3 * (size_t) num_bodies * 8) + Padded(4 * (size_t) num_bodies * 8) > rec_size)
+    return 0;
+
+  return rec;
+}
+
+const double* ChShapesArchiveReader::GetBodyPos(size_t frame, size_t body) const
+{
+  uint32_t nb;
+  const char* rec = GetBodyRecord(frame, nb);
+  if (!rec || body >= nb)
+    return 0;
+
+  // Body positions are the first array of a frame record.
+  return (const double*) (rec + RECORD_HEADER_SIZE) + 3 * body;
+}
+
+const double* ChShapesArchiveReader::GetBodyRot(size_t frame, size_t body) const
+{
+  uint32_t nb;
+  const char* rec = GetBodyRecord(frame, nb);
+  if (!rec || body >= nb)
+    return 0;
+
+  // Body rotations follow the body positions.
+  return (const double*) (rec + RECORD_HEADER_SIZE + Padded(3 * (size_t) nb * 8)) + 4 * body;
+}
+
+int ChShapesArchiveReader::FindBody(size_t frame, int id) const
+{
+  ShapesFrameView view = GetFrame(frame);
+  for (uint32_t i = 0; i < view.num_bodies; i++) {
+    if (view.body_id[i] == id)
+      return (int) i;
+  }
+
+  return -1;
+}
+
+
+}  // namespace utils
+}  // namespace chrono
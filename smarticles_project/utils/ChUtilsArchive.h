@@ -0,0 +1,209 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Radu Serban
+// =============================================================================
+//
+// Single-file archive of PovRay output frames with random frame access.
+//
+// =============================================================================
+
+#ifndef CH_UTILS_ARCHIVE_H
+#define CH_UTILS_ARCHIVE_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <stdint.h>
+
+#include "physics/ChSystem.h"
+
+#include "utils/ChApiUtils.h"
+#include "utils/ChUtilsInputOutput.h"
+#include "utils/ChUtilsMappedFile.h"
+
+
+namespace chrono {
+namespace utils {
+
+
+///
+/// Zero-copy view of a frame stored in a shapes archive.
+/// All pointers refer directly to the memory-mapped archive and remain valid as
+/// long as the archive reader is open. The arrays have the same layout as the
+/// corresponding arrays of ShapesFrame.
+///
+struct CH_UTILS_API ShapesFrameView {
+  double          time;
+
+  uint32_t        num_bodies;
+  uint32_t        num_assets;
+  uint32_t        num_links;
+  uint32_t        num_asset_params;
+  uint32_t        num_link_params;
+
+  const int32_t*  body_id;
+  const uint8_t*  body_active;
+  const double*   body_pos;          ///< 3 values per body
+  const double*   body_rot;          ///< 4 values per body
+
+  const int32_t*  asset_body_id;
+  const uint8_t*  asset_active;
+  const double*   asset_pos;         ///< 3 values per asset
+  const double*   asset_rot;         ///< 4 values per asset
+  const float*    asset_color;       ///< 3 values per asset
+  const int32_t*  asset_type;
+  const uint32_t* asset_num_params;
+  const double*   asset_params;
+
+  const int32_t*  link_type;
+  const uint32_t* link_num_params;
+  const double*   link_params;
+
+  const char*     mesh_names;        ///< NUL-terminated names, in asset order
+  uint32_t        mesh_names_size;
+  const char*     static_ref;        ///< name of the static scene file (not NUL-terminated)
+  uint32_t        static_ref_size;
+
+  /// Copy the viewed data into a frame object.
+  void CopyTo(ShapesFrame& frame) const;
+};
+
+
+///
+/// Writer for shapes archives.
+/// Frames are appended to a log, each at an 8-byte aligned offset and with all
+/// arrays aligned to their natural boundary. When the archive is closed, an
+/// index with the offset and simulation time of every frame is appended,
+/// followed by a fixed-size trailer locating the index. Frames of an archive
+/// that was not closed (e.g. after a crash) can still be recovered by the
+/// reader, which then rebuilds the index by scanning the log.
+///
+class CH_UTILS_API ChShapesArchiveWriter
+{
+public:
+
+  ChShapesArchiveWriter();
+  ~ChShapesArchiveWriter() { Close(); }
+
+  /// Create the specified archive file.
+  bool Open(const std::string& filename);
+
+  /// Write the frame index and close the archive file.
+  bool Close();
+
+  /// Append a frame, with the given simulation time, to the archive.
+  void AddFrame(const ShapesFrame& frame, double time);
+
+  /// Capture the current state of the system and append it to the archive.
+  void AddFrame(ChSystem* system, bool body_info = true);
+
+  /// Return the number of frames written so far.
+  size_t GetNumFrames() const { return m_times.size(); }
+
+private:
+
+  std::ofstream          m_file;
+  uint64_t               m_offset;
+  std::vector<char>      m_buffer;
+  std::vector<double>    m_times;
+  std::vector<uint64_t>  m_offsets;
+  ShapesPlan             m_plan;
+  ShapesFrame            m_frame;
+};
+
+
+///
+/// Reader for shapes archives.
+/// The archive is memory-mapped; frames are accessed through their index in
+/// constant time, or by simulation time with a binary search of the index.
+/// Archives are stored little-endian and can only be read on little-endian
+/// hosts.
+///
+class CH_UTILS_API ChShapesArchiveReader
+{
+public:
+
+  ChShapesArchiveReader() {}
+
+  /// Map the specified archive file and load its index.
+  /// Return false if the file cannot be opened or is not a valid archive.
+  bool Open(const std::string& filename);
+
+  /// Return the number of frames in the archive.
+  size_t GetNumFrames() const { return m_offsets.size(); }
+
+  /// Return the simulation time of the specified frame.
+  double GetTime(size_t frame) const { return m_times[frame]; }
+
+  /// Return the index of the last frame with a simulation time not larger than
+  /// the specified time (0 if all frames are later).
+  size_t FindFrame(double time) const;
+
+  /// Return a view of the specified frame.
+  ShapesFrameView GetFrame(size_t frame) const;
+
+  /// Copy the specified frame into a frame object.
+  void ReadFrame(size_t frame, ShapesFrame& out) const { GetFrame(frame).CopyTo(out); }
+
+  /// Return the position of the body with the given index in the specified
+  /// frame (3 values, or NULL if the frame has fewer bodies).
+  const double* GetBodyPos(size_t frame, size_t body) const;
+
+  /// Return the rotation of the body with the given index in the specified
+  /// frame (4 values, or NULL if the frame has fewer bodies).
+  const double* GetBodyRot(size_t frame, size_t body) const;
+
+  /// Return the index, in the specified frame, of the body with the given
+  /// identifier (or -1 if not found).
+  int FindBody(size_t frame, int id) const;
+
+private:
+
+  bool ReadIndex();
+  bool ScanFrames();
+  bool ParseFrame(uint64_t offset, ShapesFrameView& view) const;
+  const char* GetBodyRecord(size_t frame, uint32_t& num_bodies) const;
+
+  ChMappedFile           m_file;
+  std::vector<double>    m_times;
+  std::vector<uint64_t>  m_offsets;
+};
+
+
+///
+/// Zero-copy view of the time series of one body (identified by its index in
+/// each frame) in a shapes archive.
+///
+class CH_UTILS_API ChBodySeriesView
+{
+public:
+
+  ChBodySeriesView(const ChShapesArchiveReader& reader, size_t body)
+  : m_reader(reader), m_body(body) {}
+
+  size_t        GetNumFrames() const   { return m_reader.GetNumFrames(); }
+  double        GetTime(size_t i) const { return m_reader.GetTime(i); }
+  const double* GetPos(size_t i) const  { return m_reader.GetBodyPos(i, m_body); }
+  const double* GetRot(size_t i) const  { return m_reader.GetBodyRot(i, m_body); }
+
+private:
+
+  const ChShapesArchiveReader&  m_reader;
+  size_t                        m_body;
+};
+
+
+} // namespace utils
+} // namespace chrono
+
+
+#endif
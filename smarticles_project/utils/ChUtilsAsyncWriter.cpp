@@ -0,0 +1,174 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Radu Serban
+// =============================================================================
+//
+// Asynchronous writer for PovRay output frames.
+//
+// =============================================================================
+
+#include "utils/ChUtilsAsyncWriter.h"
+
+namespace chrono {
+namespace utils {
+
+
+// -----------------------------------------------------------------------------
+// Constructor: allocate the ring buffer and start the writer thread.
+// One slot is always left empty to distinguish a full ring from an empty one.
+// -----------------------------------------------------------------------------
+ChAsyncShapesWriter::ChAsyncShapesWriter(size_t             capacity,
+                                         OverflowPolicy     policy,
+                                         Format             format,
+                                         const std::string& delim)
+: m_format(format),
+  m_policy(policy),
+  m_delim(delim),
+  m_slots(capacity > 0 ? capacity + 1 : 2),
+  m_head(0),
+  m_tail(0),
+  m_stop(false),
+  m_num_written(0),
+  m_num_failed(0),
+  m_num_dropped(0)
+{
+  m_thread = std::thread(&ChAsyncShapesWriter::Process, this);
+}
+
+// -----------------------------------------------------------------------------
+// Destructor: the writer thread drains the ring buffer before exiting.
+// -----------------------------------------------------------------------------
+ChAsyncShapesWriter::~ChAsyncShapesWriter()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_cv_data.notify_one();
+
+  if (m_thread.joinable())
+    m_thread.join();
+}
+
+// -----------------------------------------------------------------------------
+// Submit (called from the simulation thread only)
+// -----------------------------------------------------------------------------
+bool ChAsyncShapesWriter::Submit(ChSystem*          system,
+                                 const std::string& filename,
+                                 bool               body_info)
+{
+  size_t head = m_head.load(std::memory_order_relaxed);
+  size_t next = (head + 1) % m_slots.size();
+
+  if (next == m_tail.load(std::memory_order_acquire)) {
+    if (m_policy == DROP) {
+      m_num_dropped++;
+      return false;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (next == m_tail.load(std::memory_order_acquire))
+      m_cv_space.wait(lock);
+  }
+
+  // The slot at 'head' is owned by the producer until the head index is
+  // published below.
+  // The output plan is only rebuilt when the system topology changes.
+  Slot& slot = m_slots[head];
+  UpdateShapesPlan(system, m_plan, m_static_ref.empty() ? ALL_BODIES : MOVING_BODIES);
+  CaptureShapes(m_plan, slot.frame, body_info);
+  slot.frame.static_ref = m_static_ref;
+  slot.filename = filename;
+
+  m_head.store(next, std::memory_order_release);
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+  }
+  m_cv_data.notify_one();
+
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+// WriteStaticScene (called from the simulation thread only)
+// -----------------------------------------------------------------------------
+bool ChAsyncShapesWriter::WriteStaticScene(ChSystem*          system,
+                                           const std::string& filename,
+                                           bool               body_info)
+{
+  Slot slot;
+  CaptureShapes(system, slot.frame, body_info, FIXED_BODIES);
+  slot.filename = filename;
+  if (!WriteSlot(slot))
+    return false;
+
+  m_static_ref = filename;
+
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+// Flush
+// -----------------------------------------------------------------------------
+void ChAsyncShapesWriter::Flush()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (m_tail.load(std::memory_order_acquire) != m_head.load(std::memory_order_acquire))
+    m_cv_space.wait(lock);
+}
+
+// -----------------------------------------------------------------------------
+// Process (writer thread)
+// -----------------------------------------------------------------------------
+void ChAsyncShapesWriter::Process()
+{
+  while (true) {
+    size_t tail = m_tail.load(std::memory_order_relaxed);
+
+    if (tail == m_head.load(std::memory_order_acquire)) {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      while (tail == m_head.load(std::memory_order_acquire) && !m_stop)
+        m_cv_data.wait(lock);
+
+      // Exit only once there is nothing left to write.
+      if (tail == m_head.load(std::memory_order_acquire))
+        return;
+    }
+
+    if (WriteSlot(m_slots[tail]))
+      m_num_written++;
+    else
+      m_num_failed++;
+
+    m_tail.store((tail + 1) % m_slots.size(), std::memory_order_release);
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+    }
+    m_cv_space.notify_all();
+  }
+}
+
+bool ChAsyncShapesWriter::WriteSlot(const Slot& slot)
+{
+  switch (m_format) {
+  case POVRAY_CSV: return WriteShapesPovray(slot.frame, slot.filename, m_delim);
+  case BINARY:     return WriteShapesBinary(slot.frame, slot.filename);
+  }
+
+  return false;
+}
+
+
+}  // namespace utils
+}  // namespace chrono
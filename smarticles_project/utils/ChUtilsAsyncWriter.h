@@ -0,0 +1,143 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Radu Serban
+// =============================================================================
+//
+// Asynchronous writer for PovRay output frames.
+//
+// =============================================================================
+
+#ifndef CH_UTILS_ASYNC_WRITER_H
+#define CH_UTILS_ASYNC_WRITER_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "physics/ChSystem.h"
+
+#include "utils/ChApiUtils.h"
+#include "utils/ChUtilsInputOutput.h"
+
+
+namespace chrono {
+namespace utils {
+
+
+///
+/// Background writer for output frames.
+/// The simulation thread captures the system state into a pre-allocated slot
+/// of a bounded single-producer/single-consumer ring buffer; a dedicated thread
+/// formats and writes the output files. Slots are handed over through atomic
+/// head and tail indices; the mutex and condition variables are only used to
+/// put either thread to sleep when the ring is empty or full.
+/// All queued frames are written before the object is destroyed.
+///
+class CH_UTILS_API ChAsyncShapesWriter
+{
+public:
+
+  /// Format of the output files.
+  enum Format {
+    POVRAY_CSV,     ///< same as WriteShapesPovray
+    BINARY          ///< same as WriteShapesBinary
+  };
+
+  /// Behavior of Submit when the ring buffer is full.
+  enum OverflowPolicy {
+    BLOCK,          ///< wait until the writer thread frees a slot
+    DROP            ///< discard the new frame
+  };
+
+  ChAsyncShapesWriter(
+    size_t             capacity = 16,           ///< number of slots in the ring buffer
+    OverflowPolicy     policy = BLOCK,          ///< behavior when the ring buffer is full
+    Format             format = POVRAY_CSV,     ///< output file format
+    const std::string& delim = ","              ///< delimiter (CSV format only)
+    );
+
+  /// Write all pending frames and stop the writer thread.
+  ~ChAsyncShapesWriter();
+
+  /// Capture the current state of the system and queue it for output to the
+  /// specified file. Return false if the frame was dropped.
+  bool Submit(
+    ChSystem*          system,                  ///< system to capture
+    const std::string& filename,                ///< name of the output file
+    bool               body_info = true         ///< also output body information
+    );
+
+  /// Write the static part of the scene (all fixed bodies) to the specified
+  /// file. From now on, submitted frames contain only the non-fixed bodies and
+  /// a reference to this static scene file. Return false (and keep writing
+  /// complete frames) if the file cannot be written.
+  bool WriteStaticScene(
+    ChSystem*          system,                  ///< system to capture
+    const std::string& filename,                ///< name of the static scene file
+    bool               body_info = true         ///< also output body information
+    );
+
+  /// Block until all frames submitted so far have been written.
+  void Flush();
+
+  /// Return the number of frames written to disk.
+  size_t GetNumWritten() const { return m_num_written; }
+  /// Return the number of frames whose output file could not be written.
+  size_t GetNumFailed() const { return m_num_failed; }
+  /// Return the number of frames discarded because the ring buffer was full.
+  size_t GetNumDropped() const { return m_num_dropped; }
+
+private:
+
+  struct Slot {
+    ShapesFrame frame;
+    std::string filename;
+  };
+
+  void Process();
+  bool WriteSlot(const Slot& slot);
+
+  Format          m_format;
+  OverflowPolicy  m_policy;
+  std::string     m_delim;
+  std::string     m_static_ref;
+  ShapesPlan      m_plan;         ///< cached output plan (producer only)
+
+  std::vector<Slot>    m_slots;
+  std::atomic<size_t>  m_head;        ///< next slot to be filled (producer)
+  std::atomic<size_t>  m_tail;        ///< next slot to be written (consumer)
+  std::atomic<bool>    m_stop;
+
+  std::atomic<size_t>  m_num_written;
+  std::atomic<size_t>  m_num_failed;
+  std::atomic<size_t>  m_num_dropped;
+
+  std::mutex               m_mutex;
+  std::condition_variable  m_cv_data;
+  std::condition_variable  m_cv_space;
+
+  std::thread  m_thread;
+
+  // Not copyable
+  ChAsyncShapesWriter(const ChAsyncShapesWriter&);
+  ChAsyncShapesWriter& operator=(const ChAsyncShapesWriter&);
+};
+
+
+} // namespace utils
+} // namespace chrono
+
+
+#endif
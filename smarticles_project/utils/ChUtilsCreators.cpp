@@ -18,11 +18,230 @@
 // =============================================================================
 
 
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
 #include "utils/ChUtilsCreators.h"
+#include "utils/ChUtilsMeshLoader.h"
 
 namespace chrono {
 namespace utils {
 
+// -----------------------------------------------------------------------------
+// Mesh cache
+//
+// Each entry holds the mesh loaded from one OBJ file, as a single visualization
+// asset (ChTriangleMeshShape stores its mesh by value, so the asset itself is
+// what gets shared). An entry is replaced if the file modification time or size
+// changed; bodies still holding the asset of the old entry keep it alive.
+// -----------------------------------------------------------------------------
+struct MeshCacheEntry {
+  time_t  mtime;
+  off_t   size;
+  ChSharedPtr<ChTriangleMeshShape> shape;
+};
+
+static std::mutex                             s_mesh_cache_mutex;
+static std::map<std::string, MeshCacheEntry>  s_mesh_cache;
+
+ChSharedPtr<ChTriangleMeshShape> GetCachedMeshShape(const std::string& obj_filename)
+{
+  struct stat st;
+  if (stat(obj_filename.c_str(), &st) != 0) {
+    st.st_mtime = 0;
+    st.st_size = 0;
+  }
+
+  std::lock_guard<std::mutex> lock(s_mesh_cache_mutex);
+
+  MeshCacheEntry& entry = s_mesh_cache[obj_filename];
+
+  if (entry.shape.IsNull() || entry.mtime != st.st_mtime || entry.size != st.st_size) {
+    ChSharedPtr<ChTriangleMeshShape> shape(new ChTriangleMeshShape);
+    if (!LoadObjMesh(obj_filename, shape->GetMesh()))
+      shape->GetMesh().LoadWavefrontMesh(obj_filename, false, false);
+
+    entry.mtime = st.st_mtime;
+    entry.size = st.st_size;
+    entry.shape = shape;
+  }
+
+  return entry.shape;
+}
+
+void ClearMeshCache()
+{
+  std::lock_guard<std::mutex> lock(s_mesh_cache_mutex);
+  s_mesh_cache.clear();
+}
+
+size_t GetMeshCacheSize()
+{
+  std::lock_guard<std::mutex> lock(s_mesh_cache_mutex);
+  return s_mesh_cache.size();
+}
+
+
+// -----------------------------------------------------------------------------
+// Asset pool
+//
+// Assets are keyed on a kind tag followed by the raw bytes of their defining
+// values, so that only bitwise identical textures, colors, or shapes (and
+// poses) are merged.
+// -----------------------------------------------------------------------------
+enum PoolAssetKind {
+  POOL_TEXTURE,
+  POOL_COLOR,
+  POOL_SHAPE
+};
+
+static std::mutex                                              s_asset_pool_mutex;
+static std::unordered_map<std::string, ChSharedPtr<ChAsset> >  s_asset_pool;
+
+static std::string AssetKey(PoolAssetKind kind, const void* data, size_t size)
+{
+  std::string key(1, (char) kind);
+  key.append(static_cast<const char*>(data), size);
+  return key;
+}
+
+static ChSharedPtr<ChVisualization> CreateShapeAsset(const ChShape& shape)
+{
+  const double* p = shape.params;
+
+  switch (shape.type) {
+  case collision::SPHERE:
+    {
+      ChSharedPtr<ChSphereShape> sphere(new ChSphereShape);
+      sphere->GetSphereGeometry().rad = p[0];
+      return sphere;
+    }
+  case collision::ELLIPSOID:
+    {
+      ChSharedPtr<ChEllipsoidShape> ellipsoid(new ChEllipsoidShape);
+      ellipsoid->GetEllipsoidGeometry().rad = ChVector<>(p[0], p[1], p[2]);
+      return ellipsoid;
+    }
+  case collision::BOX:
+    {
+      ChSharedPtr<ChBoxShape> box(new ChBoxShape);
+      box->GetBoxGeometry().Size = ChVector<>(p[0], p[1], p[2]);
+      return box;
+    }
+  case collision::CAPSULE:
+    {
+      ChSharedPtr<ChCapsuleShape> capsule(new ChCapsuleShape);
+      capsule->GetCapsuleGeometry().rad = p[0];
+      capsule->GetCapsuleGeometry().hlen = p[1];
+      return capsule;
+    }
+  case collision::CYLINDER:
+    {
+      ChSharedPtr<ChCylinderShape> cylinder(new ChCylinderShape);
+      cylinder->GetCylinderGeometry().rad = p[0];
+      cylinder->GetCylinderGeometry().p1 = ChVector<>(0,  p[1], 0);
+      cylinder->GetCylinderGeometry().p2 = ChVector<>(0, -p[1], 0);
+      return cylinder;
+    }
+  case collision::ROUNDEDBOX:
+    {
+      ChSharedPtr<ChRoundedBoxShape> box(new ChRoundedBoxShape);
+      box->GetRoundedBoxGeometry().Size = ChVector<>(p[0], p[1], p[2]);
+      box->GetRoundedBoxGeometry().radsphere = p[3];
+      return box;
+    }
+  case collision::ROUNDEDCYL:
+    {
+      ChSharedPtr<ChRoundedCylinderShape> rcyl(new ChRoundedCylinderShape);
+      rcyl->GetRoundedCylinderGeometry().rad = p[0];
+      rcyl->GetRoundedCylinderGeometry().hlen = p[1];
+      rcyl->GetRoundedCylinderGeometry().radsphere = p[2];
+      return rcyl;
+    }
+  }
+
+  return ChSharedPtr<ChVisualization>();
+}
+
+ChSharedPtr<ChTexture> GetSharedTexture(const std::string& filename)
+{
+  std::string key = AssetKey(POOL_TEXTURE, filename.data(), filename.size());
+
+  std::lock_guard<std::mutex> lock(s_asset_pool_mutex);
+
+  ChSharedPtr<ChAsset>& asset = s_asset_pool[key];
+  if (asset.IsNull()) {
+    ChSharedPtr<ChTexture> texture(new ChTexture);
+    texture->SetTextureFilename(filename);
+    asset = texture;
+  }
+
+  return asset.DynamicCastTo<ChTexture>();
+}
+
+ChSharedPtr<ChColorAsset> GetSharedColor(const ChColor& color)
+{
+  float rgb[3] = {color.R, color.G, color.B};
+  std::string key = AssetKey(POOL_COLOR, rgb, sizeof(rgb));
+
+  std::lock_guard<std::mutex> lock(s_asset_pool_mutex);
+
+  ChSharedPtr<ChAsset>& asset = s_asset_pool[key];
+  if (asset.IsNull()) {
+    ChSharedPtr<ChColorAsset> color_asset(new ChColorAsset);
+    color_asset->SetColor(color);
+    asset = color_asset;
+  }
+
+  return asset.DynamicCastTo<ChColorAsset>();
+}
+
+ChSharedPtr<ChVisualization> GetSharedShapeAsset(const ChShape&        shape,
+                                                 const ChVector<>&     pos,
+                                                 const ChQuaternion<>& rot)
+{
+  double data[1 + SHAPE_MAX_PARAMS + 7] = {(double) shape.type};
+  std::memcpy(data + 1, shape.params, sizeof(shape.params));
+  double* x = data + 1 + SHAPE_MAX_PARAMS;
+  x[0] = pos.x;  x[1] = pos.y;  x[2] = pos.z;
+  x[3] = rot.e0; x[4] = rot.e1; x[5] = rot.e2; x[6] = rot.e3;
+  std::string key = AssetKey(POOL_SHAPE, data, sizeof(data));
+
+  std::lock_guard<std::mutex> lock(s_asset_pool_mutex);
+
+  std::unordered_map<std::string, ChSharedPtr<ChAsset> >::iterator it = s_asset_pool.find(key);
+  if (it != s_asset_pool.end())
+    return it->second.DynamicCastTo<ChVisualization>();
+
+  ChSharedPtr<ChVisualization> asset = CreateShapeAsset(shape);
+  if (asset.IsNull())
+    return asset;
+
+  asset->Pos = pos;
+  asset->Rot = rot;
+  s_asset_pool[key] = asset;
+
+  return asset;
+}
+
+void ClearAssetPool()
+{
+  std::lock_guard<std::mutex> lock(s_asset_pool_mutex);
+  s_asset_pool.clear();
+}
+
+size_t GetAssetPoolSize()
+{
+  std::lock_guard<std::mutex> lock(s_asset_pool_mutex);
+  return s_asset_pool.size();
+}
+
+
 // -----------------------------------------------------------------------------
 // CreateBoxContainer
 //
@@ -68,5 +287,126 @@ void CreateBoxContainer(ChSystem*                           system,
 }
 
 
+// -----------------------------------------------------------------------------
+// ChBodyPrototype
+// -----------------------------------------------------------------------------
+static const int NUM_COLLISION_FAMILIES = 16;
+
+ChBodyPrototype::ChBodyPrototype(ChSharedPtr<ChBody> body)
+: m_body(body),
+  m_family(-1),
+  m_family_mask((1 << NUM_COLLISION_FAMILIES) - 1),
+  m_family_mask_set(false)
+{
+}
+
+bool ChBodyPrototype::SetFamily(int family)
+{
+  if (family < 0 || family >= NUM_COLLISION_FAMILIES)
+    return false;
+
+  m_family = family;
+  return true;
+}
+
+bool ChBodyPrototype::SetFamilyMaskNoCollisionWithFamily(int family)
+{
+  if (family < 0 || family >= NUM_COLLISION_FAMILIES)
+    return false;
+
+  m_family_mask &= ~(1u << family);
+  m_family_mask_set = true;
+  return true;
+}
+
+ChSharedPtr<ChBody> ChBodyPrototype::Clone(const ChVector<>&     pos,
+                                           const ChQuaternion<>& rot,
+                                           int                   id) const
+{
+  ChSharedPtr<ChBody> body(new ChBody(m_body->GetContactMethod()));
+
+  // Share the contact material.
+  if (m_body->GetContactMethod() == ChBody::DVI)
+    body->SetMaterialSurface(m_body->GetMaterialSurface());
+  else
+    body->SetMaterialSurface(m_body->GetMaterialSurfaceDEM());
+
+  // Copy body properties and set the pose.
+  body->SetIdentifier(id);
+  body->SetMass(m_body->GetMass());
+  body->SetInertiaXX(m_body->GetInertiaXX());
+  body->SetInertiaXY(m_body->GetInertiaXY());
+  body->SetPos(pos);
+  body->SetRot(rot);
+  body->SetBodyFixed(m_body->GetBodyFixed());
+  body->SetCollide(m_body->GetCollide());
+
+  // Share the collision shapes and copy the collision settings.
+  collision::ChCollisionModel* proto_model = m_body->GetCollisionModel();
+  collision::ChCollisionModel* model = body->GetCollisionModel();
+
+  model->SetEnvelope(proto_model->GetEnvelope());
+  model->SetSafeMargin(proto_model->GetSafeMargin());
+
+  model->ClearModel();
+  model->AddCopyOfAnotherModel(proto_model);
+  model->BuildModel();
+
+  // Share the assets.
+  std::vector<ChSharedPtr<ChAsset> >& assets = m_body->GetAssets();
+  body->GetAssets().reserve(assets.size());
+  for (size_t k = 0; k < assets.size(); k++)
+    body->GetAssets().push_back(assets[k]);
+
+  return body;
+}
+
+// The collision family can only be set once the collision model is part of the
+// system (which is why it is not read from the prototype body either).
+ChSharedPtr<ChBody> ChBodyPrototype::AddClone(ChSystem*             system,
+                                              const ChVector<>&     pos,
+                                              const ChQuaternion<>& rot,
+                                              int                   id) const
+{
+  ChSharedPtr<ChBody> body = Clone(pos, rot, id);
+
+  system->AddBody(body);
+
+  collision::ChCollisionModel* model = body->GetCollisionModel();
+
+  if (m_family >= 0)
+    model->SetFamily(m_family);
+
+  if (m_family_mask_set) {
+    for (int f = 0; f < NUM_COLLISION_FAMILIES; f++) {
+      if (m_family_mask & (1 << f))
+        model->SetFamilyMaskDoCollisionWithFamily(f);
+      else
+        model->SetFamilyMaskNoCollisionWithFamily(f);
+    }
+  }
+
+  return body;
+}
+
+void ChBodyPrototype::AddClones(ChSystem*                            system,
+                                const std::vector<ChCoordsys<> >&    poses,
+                                int                                  first_id,
+                                std::vector<ChSharedPtr<ChBody> >*   clones) const
+{
+  std::vector<ChBody*>* bodylist = system->Get_bodylist();
+  bodylist->reserve(bodylist->size() + poses.size());
+
+  if (clones)
+    clones->reserve(clones->size() + poses.size());
+
+  for (size_t i = 0; i < poses.size(); i++) {
+    ChSharedPtr<ChBody> body = AddClone(system, poses[i].pos, poses[i].rot, first_id + (int) i);
+    if (clones)
+      clones->push_back(body);
+  }
+}
+
+
 }  // namespace utils
 }  // namespace chrono
\ No newline at end of file
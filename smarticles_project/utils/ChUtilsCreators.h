@@ -35,6 +35,7 @@
 #include "physics/ChMaterialSurface.h"
 #include "physics/ChMaterialSurfaceDEM.h"
 
+#include "assets/ChAssetLevel.h"
 #include "assets/ChSphereShape.h"
 #include "assets/ChEllipsoidShape.h"
 #include "assets/ChBoxShape.h"
@@ -45,8 +46,11 @@
 #include "assets/ChRoundedBoxShape.h"
 #include "assets/ChRoundedConeShape.h"
 #include "assets/ChRoundedCylinderShape.h"
+#include "assets/ChTexture.h"
+#include "assets/ChColorAsset.h"
 
 #include "utils/ChApiUtils.h"
+#include "utils/ChUtilsShapeTraits.h"
 
 namespace chrono {
 namespace utils {
@@ -169,6 +173,83 @@ void AddConeGeometry(ChBody*               body,
   body->GetAssets().push_back(cone);
 }
 
+// -----------------------------------------------------------------------------
+// ChMeshLevel
+//
+/// Asset level attaching a shared triangle mesh to one body. The level carries
+/// the pose of the mesh relative to the body and the name under which the mesh
+/// is exported (e.g. the POV-Ray include), so that bodies sharing one cached
+/// mesh can still refer to it by different names.
+// -----------------------------------------------------------------------------
+class CH_UTILS_API ChMeshLevel : public ChAssetLevel
+{
+public:
+  ChMeshLevel(const std::string& name) : m_name(name) {}
+
+  const std::string& GetName() const { return m_name; }
+
+private:
+  std::string m_name;
+};
+
+// -----------------------------------------------------------------------------
+// GetCachedMeshShape
+// ClearMeshCache
+// GetMeshCacheSize
+//
+// Process-wide cache of triangle meshes loaded from Wavefront OBJ files, keyed
+// on the file path and its modification time (a file that changed on disk is
+// loaded again). All requests for the same file return the same visualization
+// asset, which holds the mesh in the frame of the OBJ file, so that each mesh
+// is stored only once. The shared asset carries no name; per-body names are
+// given by a ChMeshLevel wrapping it. The returned asset is shared and must not
+// be modified. The cache is thread-safe.
+// -----------------------------------------------------------------------------
+CH_UTILS_API
+ChSharedPtr<ChTriangleMeshShape> GetCachedMeshShape(const std::string& obj_filename);
+
+CH_UTILS_API
+void ClearMeshCache();
+
+CH_UTILS_API
+size_t GetMeshCacheSize();
+
+// -----------------------------------------------------------------------------
+// GetSharedTexture
+// GetSharedColor
+// GetSharedShapeAsset
+// ClearAssetPool
+// GetAssetPoolSize
+//
+// Process-wide pool of interned visualization assets: a single asset is created
+// for each distinct texture file, color (identified by its RGB components), or
+// primitive shape with a given pose relative to the body. Attaching the same
+// asset to many bodies avoids creating (and later converting for rendering)
+// identical asset objects. Pooled assets are shared and must not be modified.
+// GetSharedShapeAsset returns an empty pointer for shape types other than
+// those of ChShape. The pool is thread-safe.
+// -----------------------------------------------------------------------------
+CH_UTILS_API
+ChSharedPtr<ChTexture> GetSharedTexture(const std::string& filename);
+
+CH_UTILS_API
+ChSharedPtr<ChColorAsset> GetSharedColor(const ChColor& color);
+
+CH_UTILS_API
+ChSharedPtr<ChVisualization> GetSharedShapeAsset(const ChShape&        shape,
+                                                 const ChVector<>&     pos = ChVector<>(0,0,0),
+                                                 const ChQuaternion<>& rot = ChQuaternion<>(1,0,0,0));
+
+CH_UTILS_API
+void ClearAssetPool();
+
+CH_UTILS_API
+size_t GetAssetPoolSize();
+
+// The mesh is obtained from the mesh cache. The collision model receives the
+// specified transform, while the visualization asset is shared by all bodies
+// using the same mesh and attached through a ChMeshLevel carrying the transform
+// and the specified name.
 inline
 void AddTriangleMeshGeometry(ChBody*               body,
                              const std::string&    obj_filename,
@@ -176,21 +257,15 @@ void AddTriangleMeshGeometry(ChBody*               body,
                              const ChVector<>&     pos = ChVector<>(0,0,0),
                              const ChQuaternion<>& rot = ChQuaternion<>(1,0,0,0))
 {
-  geometry::ChTriangleMeshConnected trimesh;
-  trimesh.LoadWavefrontMesh(obj_filename, false, false);
+  ChSharedPtr<ChTriangleMeshShape> trimesh_shape = GetCachedMeshShape(obj_filename);
 
-  for (int i = 0; i < trimesh.m_vertices.size(); i++)
-    trimesh.m_vertices[i] = pos + rot.Rotate(trimesh.m_vertices[i]);
+  body->GetCollisionModel()->AddTriangleMesh(trimesh_shape->GetMesh(), false, false, pos, rot);
 
-  body->GetCollisionModel()->AddTriangleMesh(trimesh, false, false);
+  ChSharedPtr<ChMeshLevel> level(new ChMeshLevel(name));
+  level->GetFrame() = ChFrame<>(pos, rot);
+  level->AddAsset(trimesh_shape);
 
-  ChSharedPtr<ChTriangleMeshShape> trimesh_shape(new ChTriangleMeshShape);
-  trimesh_shape->SetMesh(trimesh);
-  trimesh_shape->SetName(name);
-  trimesh_shape->Pos = ChVector<>(0,0,0);
-  trimesh_shape->Rot = ChQuaternion<>(1,0,0,0);
-
-  body->GetAssets().push_back(trimesh_shape);
+  body->GetAssets().push_back(level);
 }
 
 inline
@@ -247,6 +322,65 @@ void CreateBoxContainer(ChSystem*                           system,
                         bool                                collide = true);
 
 
+///
+/// Prototype for creating copies of a fully configured body.
+/// The prototype body (with its collision geometry, material, assets, and mass
+/// properties) is built once and must not be added to a system. Each clone
+/// receives the mass and inertia of the prototype as is, shares its material
+/// and assets by reference, and shares its collision shapes through
+/// AddCopyOfAnotherModel; only the clone pose is specified. Clones are created
+/// at rest. Only the ChBody state is copied (in particular, the prototype
+/// should not be a ChBodyAuxRef with an offset reference frame).
+///
+class CH_UTILS_API ChBodyPrototype
+{
+public:
+
+  ChBodyPrototype(ChSharedPtr<ChBody> body);
+
+  /// Return the prototype body (e.g. to add geometry or assets to it). Changes
+  /// to shared data (material, assets) also affect existing clones.
+  ChSharedPtr<ChBody> GetBody() const { return m_body; }
+
+  /// Set the collision family of the clones added to a system, and disable
+  /// their collisions with the specified family. Each setting is applied
+  /// independently, and only if it was specified (by default, the family
+  /// settings of the clones are not changed). Families must be in the range
+  /// [0, 15]; return false (and leave the settings unchanged) otherwise.
+  bool SetFamily(int family);
+  bool SetFamilyMaskNoCollisionWithFamily(int family);
+
+  /// Create a clone of the prototype body at the specified pose. The clone is
+  /// not added to any system; note that its collision family and family mask
+  /// can only be set after that.
+  ChSharedPtr<ChBody> Clone(const ChVector<>&     pos,
+                            const ChQuaternion<>& rot = ChQuaternion<>(1,0,0,0),
+                            int                   id = 0) const;
+
+  /// Create a clone of the prototype body at the specified pose, add it to the
+  /// system, and apply the collision family settings of the prototype.
+  ChSharedPtr<ChBody> AddClone(ChSystem*             system,
+                               const ChVector<>&     pos,
+                               const ChQuaternion<>& rot = ChQuaternion<>(1,0,0,0),
+                               int                   id = 0) const;
+
+  /// Create clones of the prototype body at the specified poses and add them
+  /// to the system. Clones are assigned consecutive identifiers, starting at
+  /// 'first_id'. If 'clones' is not NULL, the new bodies are appended to it.
+  void AddClones(ChSystem*                            system,
+                 const std::vector<ChCoordsys<> >&    poses,
+                 int                                  first_id = 0,
+                 std::vector<ChSharedPtr<ChBody> >*   clones = NULL) const;
+
+private:
+
+  ChSharedPtr<ChBody>  m_body;
+  int                  m_family;
+  unsigned int         m_family_mask;
+  bool                 m_family_mask_set;
+};
+
+
 } // end namespace utils
 } // end namespace chrono
 
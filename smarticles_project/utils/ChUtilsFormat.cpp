@@ -0,0 +1,378 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Radu Serban
+// =============================================================================
+//
+// Conversion of floating point values to short, round-trip exact text.
+//
+// The digit generation follows the Grisu2 algorithm (F. Loitsch, "Printing
+// floating-point numbers quickly and accurately with integers", PLDI 2010):
+// the value and the boundaries of its rounding interval are scaled by a cached
+// power of ten into 64-bit fixed point numbers, and digits are generated until
+// the result lies within the (conservatively shrunk) interval. The output
+// therefore always reads back as the original value.
+//
+// =============================================================================
+
+#include <cstring>
+#include <stdint.h>
+
+#include "utils/ChUtilsFormat.h"
+
+namespace chrono {
+namespace utils {
+
+
+// -----------------------------------------------------------------------------
+// 64-bit floating point numbers with a separate binary exponent (f * 2^e)
+// -----------------------------------------------------------------------------
+struct DiyFp {
+  DiyFp() {}
+  DiyFp(uint64_t f_, int e_) : f(f_), e(e_) {}
+
+  uint64_t f;
+  int      e;
+};
+
+static DiyFp Multiply(const DiyFp& a, const DiyFp& b)
+{
+  // Upper 64 bits of the 128-bit product, rounded.
+  const uint64_t M32 = 0xFFFFFFFFULL;
+  uint64_t a1 = a.f >> 32, a0 = a.f & M32;
+  uint64_t b1 = b.f >> 32, b0 = b.f & M32;
+  uint64_t p11 = a1 * b1, p01 = a0 * b1, p10 = a1 * b0, p00 = a0 * b0;
+  uint64_t mid = (p00 >> 32) + (p10 & M32) + (p01 & M32) + (1ULL << 31);
+  return DiyFp(p11 + (p10 >> 32) + (p01 >> 32) + (mid >> 32), a.e + b.e + 64);
+}
+
+static DiyFp Normalize(DiyFp v)
+{
+  while (!(v.f & (1ULL << 63))) {
+    v.f <<= 1;
+    v.e--;
+  }
+  return v;
+}
+
+// Calculate the normalized upper boundary of the rounding interval of f * 2^e
+// and the lower boundary, with the same exponent.
+static void Boundaries(uint64_t f, int e, bool lower_closer, DiyFp& minus, DiyFp& plus)
+{
+  plus = Normalize(DiyFp((f << 1) + 1, e - 1));
+  minus = lower_closer ? DiyFp((f << 2) - 1, e - 2) : DiyFp((f << 1) - 1, e - 1);
+  minus.f <<= minus.e - plus.e;
+  minus.e = plus.e;
+}
+
+
+// -----------------------------------------------------------------------------
+// Normalized powers 10^k, for k = -348, -340, ..., 340
+// -----------------------------------------------------------------------------
+static const uint64_t s_cached_powers_f[] = {
+  0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL,
+  0xcf42894a5dce35eaULL, 0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL,
+  0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL, 0xbe5691ef416bd60cULL,
+  0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+  0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL,
+  0xc21094364dfb5637ULL, 0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL,
+  0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL, 0xb23867fb2a35b28eULL,
+  0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+  0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL,
+  0xb5b5ada8aaff80b8ULL, 0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL,
+  0x964e858c91ba2655ULL, 0xdff9772470297ebdULL, 0xa6dfbd9fb8e5b88fULL,
+  0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+  0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL,
+  0xaa242499697392d3ULL, 0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL,
+  0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL, 0x9c40000000000000ULL,
+  0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+  0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL,
+  0x9f4f2726179a2245ULL, 0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL,
+  0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL, 0x924d692ca61be758ULL,
+  0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+  0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL,
+  0x952ab45cfa97a0b3ULL, 0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL,
+  0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL, 0x88fcf317f22241e2ULL,
+  0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+  0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL,
+  0x8bab8eefb6409c1aULL, 0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL,
+  0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL, 0x80444b5e7aa7cf85ULL,
+  0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+  0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL
+};
+
+static const int16_t s_cached_powers_e[] = {
+  -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+  -954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+  -688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+  -422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+  -157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+  109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+  375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+  641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+  907, 933, 960, 986, 1013, 1039, 1066
+};
+
+// Return a cached power c = 10^-K such that the product of c with a number
+// with binary exponent e has a binary exponent in [-60, -32].
+static DiyFp CachedPower(int e, int& K)
+{
+  double dk = (-61 - e) * 0.30102999566398114 + 347;
+  int k = (int) dk;
+  if (dk - k > 0.0)
+    k++;
+
+  unsigned int index = (unsigned int) ((k >> 3) + 1);
+  K = -(-348 + (int) index * 8);
+
+  return DiyFp(s_cached_powers_f[index], s_cached_powers_e[index]);
+}
+
+
+// -----------------------------------------------------------------------------
+// Digit generation
+// -----------------------------------------------------------------------------
+static const uint64_t s_pow10[] = {
+  1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+  100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+  10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+  100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+};
+
+static int CountDigits(uint32_t n)
+{
+  int count = 1;
+  while (count < 10 && n >= s_pow10[count])
+    count++;
+  return count;
+}
+
+// Move the last digit towards the value, as long as the result stays within
+// the rounding interval.
+static void RoundWeed(char* buffer, int len, uint64_t delta, uint64_t rest, uint64_t ten_kappa, uint64_t wp_w)
+{
+  while (rest < wp_w && delta - rest >= ten_kappa &&
+         (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)) {
+    buffer[len - 1]--;
+    rest += ten_kappa;
+  }
+}
+
+static void GenerateDigits(const DiyFp& W, const DiyFp& Mp, uint64_t delta, char* buffer, int& len, int& K)
+{
+  const DiyFp one(1ULL << -Mp.e, Mp.e);
+  const uint64_t wp_w = Mp.f - W.f;
+
+  uint32_t p1 = (uint32_t) (Mp.f >> -one.e);
+  uint64_t p2 = Mp.f & (one.f - 1);
+  int kappa = CountDigits(p1);
+  len = 0;
+
+  // Integral part.
+  while (kappa > 0) {
+    uint32_t div = (uint32_t) s_pow10[kappa - 1];
+    uint32_t d = p1 / div;
+    p1 %= div;
+    if (d || len)
+      buffer[len++] = (char) ('0' + d);
+    kappa--;
+
+    uint64_t rest = ((uint64_t) p1 << -one.e) + p2;
+    if (rest <= delta) {
+      K += kappa;
+      RoundWeed(buffer, len, delta, rest, s_pow10[kappa] << -one.e, wp_w);
+      return;
+    }
+  }
+
+  // Fractional part.
+  for (;;) {
+    p2 *= 10;
+    delta *= 10;
+    char d = (char) (p2 >> -one.e);
+    if (d || len)
+      buffer[len++] = (char) ('0' + d);
+    p2 &= one.f - 1;
+    kappa--;
+
+    if (p2 < delta) {
+      K += kappa;
+      int index = -kappa;
+      RoundWeed(buffer, len, delta, p2, one.f, index < 20 ? wp_w * s_pow10[index] : 0);
+      return;
+    }
+  }
+}
+
+// Generate the digits of f * 2^e; the value is digits * 10^K.
+static void Grisu2(uint64_t f, int e, bool lower_closer, char* buffer, int& len, int& K)
+{
+  DiyFp minus, plus;
+  Boundaries(f, e, lower_closer, minus, plus);
+
+  DiyFp c_mk = CachedPower(plus.e, K);
+
+  DiyFp W = Multiply(Normalize(DiyFp(f, e)), c_mk);
+  DiyFp Wp = Multiply(plus, c_mk);
+  DiyFp Wm = Multiply(minus, c_mk);
+  Wm.f++;
+  Wp.f--;
+
+  GenerateDigits(W, Wp, Wp.f - Wm.f, buffer, len, K);
+}
+
+
+// -----------------------------------------------------------------------------
+// Output
+// -----------------------------------------------------------------------------
+static int WriteExponent(int K, char* buf)
+{
+  char* p = buf;
+  if (K < 0) {
+    *p++ = '-';
+    K = -K;
+  }
+
+  if (K >= 100) {
+    *p++ = (char) ('0' + K / 100);
+    K %= 100;
+    *p++ = (char) ('0' + K / 10);
+    *p++ = (char) ('0' + K % 10);
+  } else if (K >= 10) {
+    *p++ = (char) ('0' + K / 10);
+    *p++ = (char) ('0' + K % 10);
+  } else {
+    *p++ = (char) ('0' + K);
+  }
+
+  return (int) (p - buf);
+}
+
+// Lay out the digits (value = digits * 10^K) in fixed or scientific notation.
+static int Prettify(char* buf, int len, int K)
+{
+  // The value is 0.digits * 10^kk.
+  const int kk = len + K;
+
+  if (K >= 0 && kk <= 21) {
+    // Integer: append trailing zeros.
+    for (int i = len; i < kk; i++)
+      buf[i] = '0';
+    return kk;
+  }
+
+  if (kk > 0 && kk <= 21) {
+    // Decimal point inside the digits.
+    std::memmove(&buf[kk + 1], &buf[kk], len - kk);
+    buf[kk] = '.';
+    return len + 1;
+  }
+
+  if (kk > -6 && kk <= 0) {
+    // Leading zeros after the decimal point.
+    int offset = 2 - kk;
+    std::memmove(&buf[offset], &buf[0], len);
+    buf[0] = '0';
+    buf[1] = '.';
+    for (int i = 2; i < offset; i++)
+      buf[i] = '0';
+    return len + offset;
+  }
+
+  // Scientific notation.
+  if (len == 1) {
+    buf[1] = 'e';
+    return 2 + WriteExponent(kk - 1, &buf[2]);
+  }
+
+  std::memmove(&buf[2], &buf[1], len - 1);
+  buf[1] = '.';
+  buf[len + 1] = 'e';
+  return len + 2 + WriteExponent(kk - 1, &buf[len + 2]);
+}
+
+// Handle sign, zero, infinity and NaN, then format a finite nonzero value.
+static int Format(bool negative, uint64_t f, int e, bool lower_closer, bool is_zero, bool is_special, char* buf)
+{
+  char* p = buf;
+
+  if (is_special) {
+    if (f != 0) {
+      std::memcpy(p, "nan", 4);
+      return 3;
+    }
+    if (negative)
+      *p++ = '-';
+    std::memcpy(p, "inf", 4);
+    return (int) (p - buf) + 3;
+  }
+
+  if (negative)
+    *p++ = '-';
+
+  if (is_zero) {
+    *p++ = '0';
+    *p = '\0';
+    return (int) (p - buf);
+  }
+
+  int len, K;
+  Grisu2(f, e, lower_closer, p, len, K);
+  int n = Prettify(p, len, K);
+  p[n] = '\0';
+
+  return (int) (p - buf) + n;
+}
+
+
+// -----------------------------------------------------------------------------
+// FormatDouble
+// FormatFloat
+// -----------------------------------------------------------------------------
+int FormatDouble(double val, char* buf)
+{
+  uint64_t bits;
+  std::memcpy(&bits, &val, sizeof(bits));
+
+  bool     negative = (bits >> 63) != 0;
+  int      biased_e = (int) ((bits >> 52) & 0x7FF);
+  uint64_t significand = bits & 0x000FFFFFFFFFFFFFULL;
+
+  if (biased_e == 0x7FF)
+    return Format(negative, significand, 0, false, false, true, buf);
+
+  uint64_t f = biased_e ? (significand | (1ULL << 52)) : significand;
+  int      e = biased_e ? biased_e - 1075 : -1074;
+
+  return Format(negative, f, e, significand == 0 && biased_e > 1, f == 0, false, buf);
+}
+
+int FormatFloat(float val, char* buf)
+{
+  uint32_t bits;
+  std::memcpy(&bits, &val, sizeof(bits));
+
+  bool     negative = (bits >> 31) != 0;
+  int      biased_e = (int) ((bits >> 23) & 0xFF);
+  uint32_t significand = bits & 0x007FFFFF;
+
+  if (biased_e == 0xFF)
+    return Format(negative, significand, 0, false, false, true, buf);
+
+  uint64_t f = biased_e ? (significand | (1U << 23)) : significand;
+  int      e = biased_e ? biased_e - 150 : -149;
+
+  return Format(negative, f, e, significand == 0 && biased_e > 1, f == 0, false, buf);
+}
+
+
+}  // namespace utils
+}  // namespace chrono
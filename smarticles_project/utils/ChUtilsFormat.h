@@ -0,0 +1,52 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Radu Serban
+// =============================================================================
+//
+// Conversion of floating point values to short, round-trip exact text.
+//
+// =============================================================================
+
+#ifndef CH_UTILS_FORMAT_H
+#define CH_UTILS_FORMAT_H
+
+#include "utils/ChApiUtils.h"
+
+
+namespace chrono {
+namespace utils {
+
+
+// Size of a buffer large enough for any value formatted with FormatDouble or
+// FormatFloat (including the terminating NUL).
+const int FORMAT_BUFFER_SIZE = 32;
+
+// Write the decimal representation of the given value to the buffer (which
+// must have at least FORMAT_BUFFER_SIZE characters) and return its length.
+// The representation is independent of the locale and converts back (e.g.
+// with strtod) to exactly the same value. It uses the fewest digits possible
+// in almost all cases (Grisu2 algorithm). Values with a decimal exponent in
+// [-6, 21) are written in fixed notation, all others in scientific notation.
+CH_UTILS_API
+int FormatDouble(double val, char* buf);
+
+// Same as FormatDouble, for single precision values (the representation
+// converts back exactly when read as a float).
+CH_UTILS_API
+int FormatFloat(float val, char* buf);
+
+
+} // namespace utils
+} // namespace chrono
+
+
+#endif
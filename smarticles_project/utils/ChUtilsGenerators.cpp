@@ -0,0 +1,260 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Radu Serban
+// =============================================================================
+//
+// Generator for granular beds: fill a volume with non-overlapping particles of
+// several types, laid out with a point sampler.
+//
+// =============================================================================
+
+#include <algorithm>
+
+#include "utils/ChUtilsGenerators.h"
+#include "utils/ChUtilsCreators.h"
+
+namespace chrono {
+namespace utils {
+
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+ChParticleGenerator::ChParticleGenerator(ChSystem*                           system,
+                                         ChSharedPtr<ChMaterialSurfaceBase>  mat,
+                                         unsigned int                        seed)
+: m_system(system),
+  m_mat(mat),
+  m_rng(seed),
+  m_gap(0),
+  m_next_id(0),
+  m_num_bodies(0),
+  m_total_mass(0)
+{
+}
+
+int ChParticleGenerator::AddIngredient(const ChShape& shape, double density, double ratio)
+{
+  double volume;
+  if (CalcShapeVolumes(&shape, 1, &volume) != 0)
+    return -1;
+
+  Ingredient ingredient;
+  ingredient.shape = shape;
+  ingredient.density = density;
+  ingredient.ratio = ratio;
+  ingredient.stddev = 0;
+  ingredient.min_scale = 1;
+  ingredient.max_scale = 1;
+
+  m_ingredients.push_back(ingredient);
+
+  return (int) m_ingredients.size() - 1;
+}
+
+void ChParticleGenerator::SetSizeDistribution(int ingredient, double stddev, double min_scale, double max_scale)
+{
+  Ingredient& ing = m_ingredients[ingredient];
+
+  ing.stddev = stddev;
+  ing.min_scale = (stddev > 0) ? min_scale : 1;
+  ing.max_scale = (stddev > 0) ? max_scale : 1;
+}
+
+void ChParticleGenerator::AddIngredientAsset(int ingredient, ChSharedPtr<ChAsset> asset)
+{
+  m_ingredients[ingredient].assets.push_back(asset);
+}
+
+double ChParticleGenerator::GetSeparation() const
+{
+  double max_radius = 0;
+
+  for (size_t i = 0; i < m_ingredients.size(); i++) {
+    double radius;
+    CalcShapeBradii(&m_ingredients[i].shape, 1, &radius);
+    max_radius = std::max(max_radius, radius * m_ingredients[i].max_scale);
+  }
+
+  return 2 * max_radius + m_gap;
+}
+
+ChShape ChParticleGenerator::ScaleShape(const ChShape& shape, double scale) const
+{
+  // All shape parameters are lengths.
+  ChShape scaled = shape;
+  for (int i = 0; i < SHAPE_MAX_PARAMS; i++)
+    scaled.params[i] *= scale;
+  return scaled;
+}
+
+
+// -----------------------------------------------------------------------------
+// Creation of a single particle body (not added to the system).
+// -----------------------------------------------------------------------------
+ChSharedPtr<ChBody> ChParticleGenerator::CreateBody(const Ingredient&  ingredient,
+                                                    const ChShape&     shape,
+                                                    double             mass,
+                                                    const ChVector<>&  gyration) const
+{
+  // Infer the type of contact method from the specified material properties.
+  ChBody::ContactMethod contact_method = m_mat.IsType<ChMaterialSurface>() ? ChBody::DVI : ChBody::DEM;
+
+  ChSharedPtr<ChBody> body(new ChBody(contact_method));
+
+  body->SetMaterialSurface(m_mat);
+  body->SetMass(mass);
+  body->SetInertiaXX(gyration * mass);
+  body->SetCollide(true);
+
+  const double* p = shape.params;
+
+  body->GetCollisionModel()->ClearModel();
+  switch (shape.type) {
+  case collision::SPHERE:     AddSphereGeometry(body.get_ptr(), p[0]); break;
+  case collision::ELLIPSOID:  AddEllipsoidGeometry(body.get_ptr(), ChVector<>(p[0], p[1], p[2])); break;
+  case collision::BOX:        AddBoxGeometry(body.get_ptr(), ChVector<>(p[0], p[1], p[2])); break;
+  case collision::CAPSULE:    AddCapsuleGeometry(body.get_ptr(), p[0], p[1]); break;
+  case collision::CYLINDER:   AddCylinderGeometry(body.get_ptr(), p[0], p[1]); break;
+  case collision::ROUNDEDBOX: AddRoundedBoxGeometry(body.get_ptr(), ChVector<>(p[0], p[1], p[2]), p[3]); break;
+  case collision::ROUNDEDCYL: AddRoundedCylinderGeometry(body.get_ptr(), p[0], p[1], p[2]); break;
+  }
+  body->GetCollisionModel()->BuildModel();
+
+  for (size_t k = 0; k < ingredient.assets.size(); k++)
+    body->AddAsset(ingredient.assets[k]);
+
+  return body;
+}
+
+
+// -----------------------------------------------------------------------------
+// ChParticleGenerator::FillBox
+//
+// Particle centers are sampled in the box shrunk by the largest bounding
+// radius. The type and size of all particles are drawn first, so that their
+// mass properties can be evaluated in batches; the bodies are then created
+// (or cloned from the prototype of their type) and added to the system.
+// -----------------------------------------------------------------------------
+size_t ChParticleGenerator::FillBox(ChSampler&                          sampler,
+                                    const ChVector<>&                   center,
+                                    const ChVector<>&                   hdims,
+                                    std::vector<ChSharedPtr<ChBody> >*  bodies)
+{
+  if (m_ingredients.empty())
+    return 0;
+
+  double separation = GetSeparation();
+  double margin = (separation - m_gap) / 2;
+  ChVector<> inner = hdims - ChVector<>(margin, margin, margin);
+  if (inner.x < 0 || inner.y < 0 || inner.z < 0)
+    return 0;
+
+  PointVector points;
+  sampler.SetSeparation(separation);
+  sampler.SampleBox(center, inner, points);
+
+  size_t n = points.size();
+  if (n == 0)
+    return 0;
+
+  // Draw the type and size of each particle.
+  size_t num_ingredients = m_ingredients.size();
+  std::vector<double> cumulative(num_ingredients);
+  double total_ratio = 0;
+  for (size_t i = 0; i < num_ingredients; i++) {
+    total_ratio += m_ingredients[i].ratio;
+    cumulative[i] = total_ratio;
+  }
+
+  std::uniform_real_distribution<double> uniform(0.0, total_ratio);
+  std::normal_distribution<double> normal(0.0, 1.0);
+
+  std::vector<int>     types(n);
+  std::vector<ChShape> shapes(n);
+
+  for (size_t j = 0; j < n; j++) {
+    double u = uniform(m_rng);
+    int t = (int) (std::upper_bound(cumulative.begin(), cumulative.end(), u) - cumulative.begin());
+    t = std::min(t, (int) num_ingredients - 1);
+
+    const Ingredient& ing = m_ingredients[t];
+    types[j] = t;
+
+    if (ing.stddev > 0) {
+      double scale = 1 + ing.stddev * normal(m_rng);
+      scale = std::min(std::max(scale, ing.min_scale), ing.max_scale);
+      shapes[j] = ScaleShape(ing.shape, scale);
+    } else {
+      shapes[j] = ing.shape;
+    }
+  }
+
+  // Mass properties of all particles.
+  std::vector<double> volumes(n);
+  std::vector<double> gyrations(3 * n);
+  CalcShapeVolumes(&shapes[0], n, &volumes[0]);
+  CalcShapeGyrations(&shapes[0], n, &gyrations[0]);
+
+  // Prototypes for the ingredients with fixed size.
+  std::vector<ChBodyPrototype> prototypes;
+  std::vector<int> prototype_index(num_ingredients, -1);
+  prototypes.reserve(num_ingredients);
+  for (size_t i = 0; i < num_ingredients; i++) {
+    const Ingredient& ing = m_ingredients[i];
+    if (ing.stddev > 0)
+      continue;
+
+    double volume;
+    double gyration[3];
+    CalcShapeVolumes(&ing.shape, 1, &volume);
+    CalcShapeGyrations(&ing.shape, 1, gyration);
+
+    prototype_index[i] = (int) prototypes.size();
+    prototypes.push_back(ChBodyPrototype(CreateBody(ing, ing.shape, ing.density * volume,
+                                                    ChVector<>(gyration[0], gyration[1], gyration[2]))));
+  }
+
+  // Create the bodies and add them to the system.
+  std::vector<ChBody*>* bodylist = m_system->Get_bodylist();
+  bodylist->reserve(bodylist->size() + n);
+  if (bodies)
+    bodies->reserve(bodies->size() + n);
+
+  for (size_t j = 0; j < n; j++) {
+    const Ingredient& ing = m_ingredients[types[j]];
+    double mass = ing.density * volumes[j];
+
+    ChSharedPtr<ChBody> body;
+    if (prototype_index[types[j]] >= 0) {
+      body = prototypes[prototype_index[types[j]]].AddClone(m_system, points[j], QUNIT, m_next_id);
+    } else {
+      body = CreateBody(ing, shapes[j], mass, ChVector<>(gyrations[3 * j], gyrations[3 * j + 1], gyrations[3 * j + 2]));
+      body->SetIdentifier(m_next_id);
+      body->SetPos(points[j]);
+      m_system->AddBody(body);
+    }
+
+    if (bodies)
+      bodies->push_back(body);
+
+    m_next_id++;
+    m_total_mass += mass;
+  }
+
+  m_num_bodies += n;
+
+  return n;
+}
+
+
+} // end namespace utils
+} // end namespace chrono
@@ -0,0 +1,134 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Radu Serban
+// =============================================================================
+//
+// Generator for granular beds: fill a volume with non-overlapping particles of
+// several types, laid out with a point sampler.
+//
+// =============================================================================
+
+#ifndef CH_UTILS_GENERATORS_H
+#define CH_UTILS_GENERATORS_H
+
+#include <random>
+#include <vector>
+
+#include "core/ChSmartpointers.h"
+#include "core/ChVector.h"
+
+#include "physics/ChSystem.h"
+#include "physics/ChBody.h"
+#include "physics/ChMaterialSurface.h"
+#include "physics/ChMaterialSurfaceDEM.h"
+
+#include "utils/ChApiUtils.h"
+#include "utils/ChUtilsShapeTraits.h"
+#include "utils/ChUtilsSamplers.h"
+
+
+namespace chrono {
+namespace utils {
+
+
+///
+/// Generator of particle beds.
+/// Each particle type (ingredient) is a primitive shape (e.g. sphere, capsule,
+/// or box; see ChShape) of uniform density, created with a relative frequency
+/// given by its ratio. Particle sizes can be scaled by a random factor drawn from a clamped normal
+/// distribution. Particles are placed at points generated by a sampler whose
+/// separation is set to the diameter of the largest possible bounding sphere
+/// (plus an optional gap), so that no two particles overlap initially, and
+/// all particles lie inside the filled box.
+/// Particles of fixed size are cloned from a prototype body of their type
+/// (see ChBodyPrototype); the mass properties of all other particles are
+/// evaluated in batches (see ChShapeTraits). All particles share the contact
+/// material and the assets of their ingredient.
+///
+class CH_UTILS_API ChParticleGenerator
+{
+public:
+
+  ChParticleGenerator(ChSystem*                           system,
+                      ChSharedPtr<ChMaterialSurfaceBase>  mat,
+                      unsigned int                        seed = 0);
+
+  /// Add a particle type with the specified nominal shape, density, and ratio.
+  /// Return the ingredient index (-1 if the shape type is not supported).
+  int AddIngredient(const ChShape& shape, double density, double ratio = 1);
+
+  /// Scale the size of particles of the specified ingredient by a factor with
+  /// normal distribution of mean 1 and standard deviation 'stddev', clamped to
+  /// [min_scale, max_scale].
+  void SetSizeDistribution(int ingredient, double stddev, double min_scale, double max_scale);
+
+  /// Attach an asset (e.g. a shared color or texture) to all particles of the
+  /// specified ingredient.
+  void AddIngredientAsset(int ingredient, ChSharedPtr<ChAsset> asset);
+
+  /// Set the minimum gap between the bounding spheres of any two particles.
+  void SetGap(double gap) { m_gap = gap; }
+
+  /// Return the separation of sampled points (the diameter of the largest
+  /// bounding sphere of any particle, plus the gap).
+  double GetSeparation() const;
+
+  /// Fill the specified box with particles placed at the points generated by
+  /// the sampler (whose separation is set by the generator) and add them to
+  /// the system. Particles are assigned consecutive identifiers, starting
+  /// after those of previously created particles. If 'bodies' is not NULL, the
+  /// new bodies are appended to it. Return the number of particles created.
+  size_t FillBox(ChSampler&                          sampler,
+                 const ChVector<>&                   center,
+                 const ChVector<>&                   hdims,
+                 std::vector<ChSharedPtr<ChBody> >*  bodies = NULL);
+
+  /// Set the identifier of the next particle.
+  void SetStartIdentifier(int id) { m_next_id = id; }
+
+  /// Return the total number and mass of the particles created so far.
+  size_t GetTotalNumBodies() const { return m_num_bodies; }
+  double GetTotalMass() const { return m_total_mass; }
+
+private:
+
+  struct Ingredient {
+    ChShape                             shape;
+    double                              density;
+    double                              ratio;
+    double                              stddev;
+    double                              min_scale;
+    double                              max_scale;
+    std::vector<ChSharedPtr<ChAsset> >  assets;
+  };
+
+  ChSharedPtr<ChBody> CreateBody(const Ingredient& ingredient, const ChShape& shape, double mass, const ChVector<>& gyration) const;
+  ChShape ScaleShape(const ChShape& shape, double scale) const;
+
+  ChSystem*                           m_system;
+  ChSharedPtr<ChMaterialSurfaceBase>  m_mat;
+  std::mt19937                        m_rng;
+
+  std::vector<Ingredient>  m_ingredients;
+  double                   m_gap;
+
+  int     m_next_id;
+  size_t  m_num_bodies;
+  double  m_total_mass;
+};
+
+
+} // end namespace utils
+} // end namespace chrono
+
+
+#endif
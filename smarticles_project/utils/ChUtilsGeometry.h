@@ -29,6 +29,7 @@
 #include "collision/ChCCollisionModel.h"
 
 #include "utils/ChApiUtils.h"
+#include "utils/ChUtilsShapeTraits.h"
 
 
 namespace chrono {
@@ -39,47 +40,54 @@ namespace utils {
 // These utility functions return the bounding radius of the corresponding
 // shape. A sphere with this radius and centered at the origin of the frame
 // defining the shape is a bounding sphere for that shape.
+// (See ChShapeTraits for the formulas and for batch evaluation.)
 // -----------------------------------------------------------------------------
 inline
 double CalcSphereBradius(double radius)
 {
-  return radius;
+  return ChShapeTraits<collision::SPHERE>::Bradius(&radius);
 }
 
 inline
 double CalcEllipsoidBradius(const ChVector<>& hdims)
 {
-  return hdims.LengthInf();
+  double p[] = {hdims.x, hdims.y, hdims.z};
+  return ChShapeTraits<collision::ELLIPSOID>::Bradius(p);
 }
 
 inline
 double CalcBoxBradius(const ChVector<>& hdims)
 {
-  return hdims.Length();
+  double p[] = {hdims.x, hdims.y, hdims.z};
+  return ChShapeTraits<collision::BOX>::Bradius(p);
 }
 
 inline
 double CalcCapsuleBradius(double radius, double hlen)
 {
-  return hlen + radius;
+  double p[] = {radius, hlen};
+  return ChShapeTraits<collision::CAPSULE>::Bradius(p);
 }
 
 inline
 double CalcCylinderBradius(double radius, double hlen)
 {
-  return sqrt(hlen * hlen + radius * radius);
+  double p[] = {radius, hlen};
+  return ChShapeTraits<collision::CYLINDER>::Bradius(p);
 }
 
 inline
 double CalcRoundedCylinderBradius(double radius, double hlen, double srad)
 {
-  return sqrt(hlen * hlen + radius * radius) + srad;
+  double p[] = {radius, hlen, srad};
+  return ChShapeTraits<collision::ROUNDEDCYL>::Bradius(p);
 }
 
 inline
 double CalcRoundedBoxBradius(const ChVector<>& hdims, double srad)
 {
-  return hdims.Length() + srad;
+  double p[] = {hdims.x, hdims.y, hdims.z, srad};
+  return ChShapeTraits<collision::ROUNDEDBOX>::Bradius(p);
 }
 
 
@@ -89,49 +97,49 @@ double CalcRoundedBoxBradius(const ChVector<>& hdims, double srad)
 inline
 double CalcSphereVolume(double radius)
 {
-  return (4.0/3.0) * CH_C_PI * radius * radius * radius;
+  return ChShapeTraits<collision::SPHERE>::Volume(&radius);
 }
 
 inline
 double CalcEllipsoidVolume(const ChVector<>& hdims)
 {
-  return (4.0/3.0) * CH_C_PI * hdims.x * hdims.y * hdims.z;
+  double p[] = {hdims.x, hdims.y, hdims.z};
+  return ChShapeTraits<collision::ELLIPSOID>::Volume(p);
 }
 
 inline
 double CalcBoxVolume(const ChVector<>& hdims)
 {
-  return 8.0 * hdims.x * hdims.y * hdims.z;
+  double p[] = {hdims.x, hdims.y, hdims.z};
+  return ChShapeTraits<collision::BOX>::Volume(p);
 }
 
 inline
 double CalcCapsuleVolume(double radius, double hlen)
 {
-  double tmp = radius * radius * hlen + (2.0/3.0) * radius * radius * radius;
-  return 2.0 * CH_C_PI * tmp;
+  double p[] = {radius, hlen};
+  return ChShapeTraits<collision::CAPSULE>::Volume(p);
 }
 
 inline
 double CalcCylinderVolume(double radius, double hlen)
 {
-  return 2.0 * CH_C_PI * radius * radius * hlen;
+  double p[] = {radius, hlen};
+  return ChShapeTraits<collision::CYLINDER>::Volume(p);
 }
 
 inline
 double CalcRoundedCylinderVolume(double radius, double hlen, double srad)
 {
-  double tmp = (radius + srad) * (radius + srad) * hlen +
-         srad * (radius * radius + (2.0/3.0) * srad * srad) +
-         (CH_C_PI/2.0 - 1.0) * radius * srad * srad;
-  return 2.0 * CH_C_PI * tmp;
+  double p[] = {radius, hlen, srad};
+  return ChShapeTraits<collision::ROUNDEDCYL>::Volume(p);
 }
 
 inline
 double CalcRoundedBoxVolume(const ChVector<>& hdims, double srad)
 {
-  return  8 * hdims.x * hdims.y * hdims.z +
-          2 * srad * (hdims.x * hdims.y + hdims.y * hdims.z + hdims.z * hdims.x) +
-          (4.0 * CH_C_PI / 3.0) * srad * srad * srad;
+  double p[] = {hdims.x, hdims.y, hdims.z, srad};
+  return ChShapeTraits<collision::ROUNDEDBOX>::Volume(p);
 }
 
 // -----------------------------------------------------------------------------
@@ -144,48 +152,61 @@ void TransformGyration(ChMatrix33<>&         J,
                        const ChVector<>&     pos,
                        const ChQuaternion<>& rot)
 {
-  ////
-  ////  TODO
-  ////
+  // Rotate: J' = A * J * A^T
+  ChMatrix33<> A(rot);
+  ChMatrix33<> AJ;
+  AJ.MatrMultiply(A, J);
+  J.MatrMultiplyT(AJ, A);
+
+  // Translate (parallel axis theorem, per unit mass): J' += (p.p) I - p p^T
+  double p[3] = {pos.x, pos.y, pos.z};
+  double pp = pos.Length2();
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++)
+      J.SetElement(i, j, J.GetElement(i, j) + (i == j ? pp : 0.0) - p[i] * p[j]);
+  }
 }
 
 // -----------------------------------------------------------------------------
-// These utility functions calculate the gyration tensor of the corresponding
-// shape, given its position and orientation.
+// These utility functions calculate the gyration tensor (inertia tensor per
+// unit mass) of the corresponding shape, given its position and orientation.
+// Half-dimensions are used throughout; the axis of capsules and cylinders is
+// the Y axis of the shape frame.
 // -----------------------------------------------------------------------------
+template <int TYPE>
 inline
-ChMatrix33<> CalcSphereGyration(
-                 double                radius,
-                 const ChVector<>&     pos = ChVector<>(0,0,0),
-                 const ChQuaternion<>& rot = ChQuaternion<>(1,0,0,0))
+ChMatrix33<> CalcGyration(const double*         p,
+                          const ChVector<>&     pos,
+                          const ChQuaternion<>& rot)
 {
   ChMatrix33<> J;
-  double       Jxx = (2.0/5.0) * radius * radius;
 
-  J.SetElement(0, 0, Jxx);
-  J.SetElement(1, 1, Jxx);
-  J.SetElement(2, 2, Jxx);
+  J.SetElement(0, 0, ChShapeTraits<TYPE>::GyrationXX(p));
+  J.SetElement(1, 1, ChShapeTraits<TYPE>::GyrationYY(p));
+  J.SetElement(2, 2, ChShapeTraits<TYPE>::GyrationZZ(p));
 
   TransformGyration(J, pos, rot);
 
   return J;
 }
 
+inline
+ChMatrix33<> CalcSphereGyration(
+                 double                radius,
+                 const ChVector<>&     pos = ChVector<>(0,0,0),
+                 const ChQuaternion<>& rot = ChQuaternion<>(1,0,0,0))
+{
+  return CalcGyration<collision::SPHERE>(&radius, pos, rot);
+}
+
 inline
 ChMatrix33<> CalcEllipsoidGyration(
                  const ChVector<>&     hdims,
                  const ChVector<>&     pos = ChVector<>(0,0,0),
                  const ChQuaternion<>& rot = ChQuaternion<>(1,0,0,0))
 {
-  ChMatrix33<> J;
-
-  J.SetElement(0, 0, (1.0/5.0) * (hdims.y * hdims.y + hdims.z * hdims.z));
-  J.SetElement(1, 1, (1.0/5.0) * (hdims.z * hdims.z + hdims.x * hdims.x));
-  J.SetElement(2, 2, (1.0/5.0) * (hdims.x * hdims.x + hdims.y * hdims.y));
-
-  TransformGyration(J, pos, rot);
-
-  return J;
+  double p[] = {hdims.x, hdims.y, hdims.z};
+  return CalcGyration<collision::ELLIPSOID>(p, pos, rot);
 }
 
 inline
@@ -194,15 +215,8 @@ ChMatrix33<> CalcBoxGyration(
                  const ChVector<>&     pos = ChVector<>(0,0,0),
                  const ChQuaternion<>& rot = ChQuaternion<>(1,0,0,0))
 {
-  ChMatrix33<> J;
-
-  J.SetElement(0, 0, (1.0/12.0) * (hdims.y * hdims.y + hdims.z * hdims.z));
-  J.SetElement(1, 1, (1.0/12.0) * (hdims.z * hdims.z + hdims.x * hdims.x));
-  J.SetElement(2, 2, (1.0/12.0) * (hdims.x * hdims.x + hdims.y * hdims.y));
-
-  TransformGyration(J, pos, rot);
-
-  return J;
+  double p[] = {hdims.x, hdims.y, hdims.z};
+  return CalcGyration<collision::BOX>(p, pos, rot);
 }
 
 inline
@@ -212,18 +226,8 @@ ChMatrix33<> CalcCapsuleGyration(
                  const ChVector<>&     pos = ChVector<>(0,0,0),
                  const ChQuaternion<>& rot = ChQuaternion<>(1,0,0,0))
 {
-  ChMatrix33<> J;
-
-  //// TODO: for now, use the gyration of the circumscibed cylinder
-  double hlen1 = hlen + radius;
-
-  J.SetElement(0, 0, (1.0/12.0) * (3 * radius * radius + hlen1 * hlen1));
-  J.SetElement(1, 1, (1.0/12.0) * (radius * radius));
-  J.SetElement(2, 2, (1.0/12.0) * (3 * radius * radius + hlen1 * hlen1));
-
-  TransformGyration(J, pos, rot);
-
-  return J;
+  double p[] = {radius, hlen};
+  return CalcGyration<collision::CAPSULE>(p, pos, rot);
 }
 
 inline
@@ -233,15 +237,8 @@ ChMatrix33<> CalcCylinderGyration(
                  const ChVector<>&     pos = ChVector<>(0,0,0),
                  const ChQuaternion<>& rot = ChQuaternion<>(1,0,0,0))
 {
-  ChMatrix33<> J;
-
-  J.SetElement(0, 0, (1.0/12.0) * (3 * radius * radius + hlen * hlen));
-  J.SetElement(1, 1, (1.0/12.0) * (radius * radius));
-  J.SetElement(2, 2, (1.0/12.0) * (3 * radius * radius + hlen * hlen));
-
-  TransformGyration(J, pos, rot);
-
-  return J;
+  double p[] = {radius, hlen};
+  return CalcGyration<collision::CYLINDER>(p, pos, rot);
 }
 
 inline
@@ -252,16 +249,8 @@ ChMatrix33<> CalcRoundedCylinderGyration(
                  const ChVector<>&     pos = ChVector<>(0,0,0),
                  const ChQuaternion<>& rot = ChQuaternion<>(1,0,0,0))
 {
-  ChMatrix33<> J;
-
-  //// TODO: for now, use the gyration of the skeleton cylinder
-  J.SetElement(0, 0, (1.0/12.0) * (3 * radius * radius + hlen * hlen));
-  J.SetElement(1, 1, (1.0/12.0) * (radius * radius));
-  J.SetElement(2, 2, (1.0/12.0) * (3 * radius * radius + hlen * hlen));
-
-  TransformGyration(J, pos, rot);
-
-  return J;
+  double p[] = {radius, hlen, srad};
+  return CalcGyration<collision::ROUNDEDCYL>(p, pos, rot);
 }
 
 inline
@@ -271,16 +260,8 @@ ChMatrix33<> CalcRoundedBoxGyration(
                  const ChVector<>&     pos = ChVector<>(0,0,0),
                  const ChQuaternion<>& rot = ChQuaternion<>(1,0,0,0))
 {
-  ChMatrix33<> J;
-
-  //// TODO: for now, use the gyration of the skeleton box
-  J.SetElement(0, 0, (1.0/12.0) * (hdims.y * hdims.y + hdims.z * hdims.z));
-  J.SetElement(1, 1, (1.0/12.0) * (hdims.z * hdims.z + hdims.x * hdims.x));
-  J.SetElement(2, 2, (1.0/12.0) * (hdims.x * hdims.x + hdims.y * hdims.y));
-
-  TransformGyration(J, pos, rot);
-
-  return J;
+  double p[] = {hdims.x, hdims.y, hdims.z, srad};
+  return CalcGyration<collision::ROUNDEDBOX>(p, pos, rot);
 }
 
 
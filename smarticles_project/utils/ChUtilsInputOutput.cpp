@@ -16,27 +16,185 @@
 //
 // =============================================================================
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <thread>
+#include <unordered_map>
+#include <stdint.h>
+
+#include "physics/ChBodyAuxRef.h"
+#include "physics/ChLinkEngine.h"
+#include "physics/ChLinkLinActuator.h"
+#include "motion_functions/ChFunction_Const.h"
+#include "motion_functions/ChFunction_Ramp.h"
+#include "motion_functions/ChFunction_Sine.h"
 #include "assets/ChColorAsset.h"
 
 #include "utils/ChUtilsInputOutput.h"
+#include "utils/ChUtilsMappedFile.h"
+#include "utils/ChUtilsMeshLoader.h"
 
 namespace chrono {
 namespace utils {
 
 
+// -----------------------------------------------------------------------------
+// CSV_writer::open
+// CSV_writer::close
+//
+// Streaming mode for CSV_writer.
+// -----------------------------------------------------------------------------
+bool CSV_writer::open(const std::string& filename,
+                      size_t             header_size,
+                      size_t             buffer_size)
+{
+  if (m_file.is_open())
+    close();
+
+  // The user-space buffer must be installed before the file is opened.
+  m_buffer.resize(buffer_size > 0 ? buffer_size : 1);
+  m_file.clear();
+  m_file.rdbuf()->pubsetbuf(&m_buffer[0], m_buffer.size());
+  m_file.open(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+
+  if (!m_file.is_open())
+    return false;
+
+  m_file.copyfmt(m_ss);
+  m_filename = filename;
+  m_header_size = header_size;
+
+  // Reserve space for the header, then write out anything already buffered.
+  if (header_size > 0)
+    m_file << std::string(header_size, ' ');
+
+  m_file << m_ss.str();
+  m_ss.str("");
+
+  m_out = &m_file;
+
+  return true;
+}
+
+bool CSV_writer::close(const std::string& header)
+{
+  if (!m_file.is_open())
+    return false;
+
+  bool fits = header.size() <= m_header_size;
+
+  if (m_header_size > 0 && fits) {
+    // Pad the header with blanks, keeping its final newline (if any) at the
+    // end of the reserved region.
+    std::string patch(header);
+    bool eol = !patch.empty() && patch[patch.size() - 1] == '\n';
+    if (eol)
+      patch.erase(patch.size() - 1);
+    patch.resize(m_header_size - (eol ? 1 : 0), ' ');
+    if (eol)
+      patch += '\n';
+
+    m_file.seekp(0);
+    m_file.write(patch.data(), patch.size());
+  }
+
+  bool ok = m_file.good();
+  m_file.close();
+  m_out = &m_ss;
+
+  if (!ok || fits)
+    return ok;
+
+  // The header does not fit in the reserved region: copy the file contents,
+  // in chunks, after the header into a temporary file and replace the file.
+  std::string tmp_filename = m_filename + ".tmp";
+  {
+    std::ifstream ifile(m_filename.c_str(), std::ios::binary);
+    std::ofstream ofile(tmp_filename.c_str(), std::ios::binary | std::ios::trunc);
+    if (!ifile.is_open() || !ofile.is_open())
+      return false;
+
+    ofile << header;
+    ifile.seekg(m_header_size);
+
+    char chunk[65536];
+    while (ifile.read(chunk, sizeof(chunk)) || ifile.gcount() > 0)
+      ofile.write(chunk, ifile.gcount());
+
+    if (!ofile.good())
+      return false;
+  }
+
+  std::remove(m_filename.c_str());
+  return std::rename(tmp_filename.c_str(), m_filename.c_str()) == 0;
+}
+
+
+// -----------------------------------------------------------------------------
+// CSV_writer::write
+//
+// Format a group of floating point values, with their delimiters, in a local
+// buffer and pass them to the output stream with a single write.
+// -----------------------------------------------------------------------------
+template <typename T>
+static void WriteValues(std::ostream& out, const std::string& delim, const T* vals, size_t n)
+{
+  const size_t group = 8;
+  char buf[group * (FORMAT_BUFFER_SIZE + 8)];
+
+  if (delim.size() > 8) {
+    // Unusually long delimiter: write it separately.
+    for (size_t i = 0; i < n; i++) {
+      int len = (sizeof(T) == sizeof(float)) ? FormatFloat((float) vals[i], buf) : FormatDouble((double) vals[i], buf);
+      out.write(buf, len);
+      out.write(delim.data(), delim.size());
+    }
+    return;
+  }
+
+  for (size_t start = 0; start < n; start += group) {
+    size_t end = std::min(start + group, n);
+    char* p = buf;
+    for (size_t i = start; i < end; i++) {
+      p += (sizeof(T) == sizeof(float)) ? FormatFloat((float) vals[i], p) : FormatDouble((double) vals[i], p);
+      std::memcpy(p, delim.data(), delim.size());
+      p += delim.size();
+    }
+    out.write(buf, p - buf);
+  }
+}
+
+CSV_writer& CSV_writer::write(const double* vals, size_t n)
+{
+  WriteValues(*m_out, m_delim, vals, n);
+  return *this;
+}
+
+CSV_writer& CSV_writer::write(const float* vals, size_t n)
+{
+  WriteValues(*m_out, m_delim, vals, n);
+  return *this;
+}
+
+
 // -----------------------------------------------------------------------------
 // WriteBodies
 //
 // Write to a CSV file pody position, orientation, and (optionally) linear and
 // angular velocity. Optionally, only active bodies are processed.
 // -----------------------------------------------------------------------------
-void WriteBodies(ChSystem*          system,
+bool WriteBodies(ChSystem*          system,
                  const std::string& filename,
                  bool               active_only,
                  bool               dump_vel,
                  const std::string& delim)
 {
   CSV_writer csv(delim);
+  if (!csv.open(filename))
+    return false;
 
   for (int i = 0; i < system->Get_bodylist()->size(); i++) {
     ChBody* body = system->Get_bodylist()->at(i);
@@ -48,7 +206,7 @@ void WriteBodies(ChSystem*          system,
     csv << std::endl;
   }
 
-  csv.write_to_file(filename);
+  return csv.close();
 }
 
 
@@ -61,11 +219,16 @@ bool WriteCheckpoint(ChSystem*          system,
                      const std::string& filename)
 {
   CSV_writer csv(" ");
+  if (!csv.open(filename))
+    return false;
 
-  std::vector<ChBody*>::iterator ibody = system->Get_bodylist()->begin();
-  for (; ibody != system->Get_bodylist()->end(); ++ibody)
+  // Resolve all visual assets once.
+  ShapesPlan plan;
+  BuildShapesPlan(system, plan, ALL_BODIES);
+
+  for (size_t ib = 0; ib < plan.GetNumBodies(); ib++)
   {
-    ChBody* body = *ibody;
+    ChBody* body = plan.bodies[ib];
 
     // Infer body type (0: DVI, 1:DEM)
     int btype = (body->GetContactMethod() == ChBody::DVI) ? 0 : 1;
@@ -99,130 +262,145 @@ bool WriteCheckpoint(ChSystem*          system,
 
     csv << std::endl;
 
-    // Count and write all visual assets.
-    int num_visual_assets = 0;
-    std::vector<ChSharedPtr<ChAsset> >::iterator iasset = (*ibody)->GetAssets().begin();
-    for (; iasset != (*ibody)->GetAssets().end(); ++iasset)
-    {
-      if ((*iasset).IsType<ChVisualization>())
-        num_visual_assets++;
+    // Write the number of visual assets. All of them must be supported.
+    unsigned int begin = plan.body_asset_start[ib];
+    unsigned int end = plan.body_asset_start[ib + 1];
+    if (end - begin != plan.body_num_visual[ib]) {
+      csv.close();
+      std::remove(filename.c_str());
+      return false;
     }
-    csv << num_visual_assets << std::endl;
+    csv << plan.body_num_visual[ib] << std::endl;
 
-    // Loop over each asset and, for selected visual assets only, write its data
-    // on a separate line. If we encounter an unsupported type, return false.
-    iasset = (*ibody)->GetAssets().begin();
-    for (; iasset != (*ibody)->GetAssets().end(); ++iasset)
+    // Loop over the planned visual assets and write the data of each on a
+    // separate line. If we encounter an unsupported type, return false.
+    for (unsigned int i = begin; i < end; i++)
     {
-      ChSharedPtr<ChVisualization> visual_asset = (*iasset).DynamicCastTo<ChVisualization>();
-      if (visual_asset.IsNull())
-        continue;
-
-      // Write relative position and rotation
-      csv << visual_asset->Pos << visual_asset->Rot.Get_A_quaternion();
-
-      // Write shape type and geometry data
-      if (ChSharedPtr<ChSphereShape> sphere = visual_asset.DynamicCastTo<ChSphereShape>())
-      {
-        csv << collision::SPHERE << sphere->GetSphereGeometry().rad;
-      }
-      else if (ChSharedPtr<ChEllipsoidShape> ellipsoid = visual_asset.DynamicCastTo<ChEllipsoidShape>())
-      {
-        csv << collision::ELLIPSOID << ellipsoid->GetEllipsoidGeometry().rad;
-      }
-      else if (ChSharedPtr<ChBoxShape> box = visual_asset.DynamicCastTo<ChBoxShape>())
-      {
-        csv << collision::BOX << box->GetBoxGeometry().Size;
-      }
-      else if (ChSharedPtr<ChCapsuleShape> capsule = visual_asset.DynamicCastTo<ChCapsuleShape>())
-      {
-        const geometry::ChCapsule& geom = capsule->GetCapsuleGeometry();
-        csv << collision::CAPSULE << geom.rad << geom.hlen;
-      }
-      ////else if (ChSharedPtr<ChCylinderShape> cylinder = visual_asset.DynamicCastTo<ChCylinderShape>())
-      ////{
-      ////  const geometry::ChCylinder& geom = cylinder->GetCylinderGeometry();
-      ////  csv << collision::CYLINDER << geom.rad << (geom.p1.y - geom.p2.y) / 2;
-      ////}
-      else if (ChSharedPtr<ChConeShape> cone = visual_asset.DynamicCastTo<ChConeShape>())
-      {
-        const geometry::ChCone& geom = cone->GetConeGeometry();
-        csv << collision::CONE << geom.rad.x << geom.rad.y;
-      }
-      else if (ChSharedPtr<ChRoundedBoxShape> rbox = visual_asset.DynamicCastTo<ChRoundedBoxShape>())
-      {
-        const geometry::ChRoundedBox& geom = rbox->GetRoundedBoxGeometry();
-        csv << collision::ROUNDEDBOX << geom.Size << geom.radsphere;
-      }
-      else if (ChSharedPtr<ChRoundedCylinderShape> rcyl = visual_asset.DynamicCastTo<ChRoundedCylinderShape>())
-      {
-        const geometry::ChRoundedCylinder& geom = rcyl->GetRoundedCylinderGeometry();
-        csv << collision::ROUNDEDCYL << geom.rad << geom.hlen << geom.radsphere;
-      }
-      else
-      {
-        // Unsupported visual asset type.
+      int type = plan.asset_type[i];
+      if (type == collision::CYLINDER || type == collision::TRIANGLEMESH) {
+        // Unsupported visual asset type. Discard the partial checkpoint.
+        csv.close();
+        std::remove(filename.c_str());
         return false;
       }
 
+      // Write relative position and rotation, shape type and geometry data
+      csv << plan.asset_pos[i] << plan.asset_rot[i] << type;
+
+      const double* params = plan.asset_params.data() + plan.asset_params_start[i];
+      for (unsigned int j = 0; j < plan.asset_num_params[i]; j++)
+        csv << params[j];
+
       csv << std::endl;
     }
   }
 
-  csv.write_to_file(filename);
-
-  return true;
+  return csv.close();
 }
 
 
 // -----------------------------------------------------------------------------
 // ReadCheckpoint
 //
-//
+// Bulk loader for checkpoint files created with WriteCheckpoint. The file is
+// memory-mapped and scanned in a single pass. Bodies with identical sets of
+// shapes share the collision shapes and the visual assets of the first such
+// body (the prototype), which are created only once.
 // -----------------------------------------------------------------------------
+static void AddCheckpointShape(ChBody*               body,
+                               int                   type,
+                               const double*         p,
+                               const ChVector<>&     pos,
+                               const ChQuaternion<>& rot)
+{
+  switch (collision::ShapeType(type)) {
+  case collision::SPHERE:
+    AddSphereGeometry(body, p[0], pos, rot);
+    break;
+  case collision::ELLIPSOID:
+    AddEllipsoidGeometry(body, ChVector<>(p[0], p[1], p[2]), pos, rot);
+    break;
+  case collision::BOX:
+    AddBoxGeometry(body, ChVector<>(p[0], p[1], p[2]), pos, rot);
+    break;
+  case collision::CAPSULE:
+    AddCapsuleGeometry(body, p[0], p[1], pos, rot);
+    break;
+  ////case collision::CYLINDER:
+  ////  AddCylinderGeometry(body, p[0], p[1], pos, rot);
+  ////  break;
+  case collision::CONE:
+    AddConeGeometry(body, p[0], p[1], pos, rot);
+    break;
+  case collision::ROUNDEDBOX:
+    AddRoundedBoxGeometry(body, ChVector<>(p[0], p[1], p[2]), p[3], pos, rot);
+    break;
+  case collision::ROUNDEDCYL:
+    AddRoundedCylinderGeometry(body, p[0], p[1], p[2], pos, rot);
+    break;
+  }
+}
+
+// Number of geometry data values for each shape type in a checkpoint file.
+static int CheckpointShapeSize(int type)
+{
+  switch (collision::ShapeType(type)) {
+  case collision::SPHERE:     return 1;
+  case collision::ELLIPSOID:  return 3;
+  case collision::BOX:        return 3;
+  case collision::CAPSULE:    return 2;
+  case collision::CONE:       return 2;
+  case collision::ROUNDEDBOX: return 4;
+  case collision::ROUNDEDCYL: return 3;
+  default:                    return 0;
+  }
+}
+
 void ReadCheckpoint(ChSystem*          system,
                     const std::string& filename)
 {
-  // Open input file stream
-  std::ifstream      ifile(filename.c_str());
-  std::string        line;
+  // Map the input file
+  ChMappedFile file;
+  if (!file.Open(filename))
+    return;
 
-  while (std::getline(ifile, line)) {
-    std::istringstream iss1(line);
+  ChTextScanner scan(file.GetData(), file.GetSize());
 
+  // Shape descriptors (packed shape data) of the prototype bodies.
+  std::unordered_map<std::string, ChBody*> prototypes;
+  std::vector<double> shapes;
+
+  while (scan.SkipSpace()) {
     // Read body type, Id, flags
-    int btype, bid, bfixed, bcollide;
-    iss1 >> btype >> bid >> bfixed >> bcollide;
+    int btype, bid;
+    bool bfixed, bcollide;
+    scan >> btype >> bid >> bfixed >> bcollide;
 
     // Read body mass and inertia
     double     mass;
     ChVector<> inertiaXX;
-    iss1 >> mass >> inertiaXX.x >> inertiaXX.y >> inertiaXX.z;
+    scan >> mass >> inertiaXX.x >> inertiaXX.y >> inertiaXX.z;
 
     // Read body position, orientation, and their time derivatives
     ChVector<>     bpos, bpos_dt;
     ChQuaternion<> brot, brot_dt;
-    iss1 >> bpos.x >> bpos.y >> bpos.z >> brot.e0 >> brot.e1 >> brot.e2 >> brot.e3;
-    iss1 >> bpos_dt.x >> bpos_dt.y >> bpos_dt.z >> brot_dt.e0 >> brot_dt.e1 >> brot_dt.e2 >> brot_dt.e3;
-
-    // Get the next line in the file (material properties)
-    std::getline(ifile, line);
-    std::istringstream iss2(line);
+    scan >> bpos.x >> bpos.y >> bpos.z >> brot.e0 >> brot.e1 >> brot.e2 >> brot.e3;
+    scan >> bpos_dt.x >> bpos_dt.y >> bpos_dt.z >> brot_dt.e0 >> brot_dt.e1 >> brot_dt.e2 >> brot_dt.e3;
 
     // Create a body of the appropriate type, read and apply material properties
     ChBody* body;
     if (btype == 0) {
       body = new ChBody(ChBody::DVI);
       ChSharedPtr<ChMaterialSurface> mat = body->GetMaterialSurface();
-      iss2 >> mat->static_friction >> mat->sliding_friction >> mat->rolling_friction >> mat->spinning_friction;
-      iss2 >> mat->restitution >> mat->cohesion >> mat->dampingf;
-      iss2 >> mat->compliance >> mat->complianceT >> mat->complianceRoll >> mat->complianceSpin;
+      scan >> mat->static_friction >> mat->sliding_friction >> mat->rolling_friction >> mat->spinning_friction;
+      scan >> mat->restitution >> mat->cohesion >> mat->dampingf;
+      scan >> mat->compliance >> mat->complianceT >> mat->complianceRoll >> mat->complianceSpin;
     } else {
       body = new ChBody(ChBody::DEM);
       ChSharedPtr<ChMaterialSurfaceDEM> mat = body->GetMaterialSurfaceDEM();
-      iss2 >> mat->young_modulus >> mat->poisson_ratio;
-      iss2 >> mat->static_friction >> mat->sliding_friction;
-      iss2 >> mat->restitution >> mat->cohesion;
+      scan >> mat->young_modulus >> mat->poisson_ratio;
+      scan >> mat->static_friction >> mat->sliding_friction;
+      scan >> mat->restitution >> mat->cohesion;
     }
 
     // Set body properties and state
@@ -232,95 +410,63 @@ void ReadCheckpoint(ChSystem*          system,
     body->SetRot_dt(brot_dt);
 
     body->SetIdentifier(bid);
-    body->SetBodyFixed(bfixed != 0);
-    body->SetCollide(bcollide != 0);
+    body->SetBodyFixed(bfixed);
+    body->SetCollide(bcollide);
 
     body->SetMass(mass);
     body->SetInertiaXX(inertiaXX);
 
-    // Get next line in the file (number of visualization assets)
-    std::getline(ifile, line);
-    std::istringstream iss3(line);
-
+    // Read all shapes of this body in a descriptor: for each shape, its type,
+    // relative position and rotation, and geometry data.
     int numAssets;
-    iss3 >> numAssets;
+    scan >> numAssets;
+
+    shapes.clear();
+    for (int j = 0; j < numAssets && scan.Ok(); j++) {
+      double val;
+      for (int k = 0; k < 7; k++) {
+        scan >> val;
+        shapes.push_back(val);
+      }
 
-    // In a loop, read information about each asset and add geometry to the body
-    body->GetCollisionModel()->ClearModel();
+      int atype;
+      scan >> atype;
+      shapes.push_back(atype);
+
+      for (int k = 0; k < CheckpointShapeSize(atype); k++) {
+        scan >> val;
+        shapes.push_back(val);
+      }
+    }
 
-    for (int j = 0; j < numAssets; j++) {
-      std::getline(ifile, line);
-      std::istringstream iss(line);
+    if (!scan.Ok()) {
+      delete body;
+      return;
+    }
 
-      // Get relative position and rotation
-      ChVector<>     apos;
-      ChQuaternion<> arot;
-      iss >> apos.x >> apos.y >> apos.z >> arot.e0 >> arot.e1 >> arot.e2 >> arot.e3;
+    std::string key(reinterpret_cast<const char*>(shapes.data()), shapes.size() * sizeof(double));
+    std::unordered_map<std::string, ChBody*>::iterator proto = prototypes.find(key);
 
-      // Get visualization asset type and geometry data.
-      // Create the appropriate 
-      int atype;
-      iss >> atype;
+    body->GetCollisionModel()->ClearModel();
 
-      switch (collision::ShapeType(atype)) {
-      case collision::SPHERE:
-        {
-          double radius;
-          iss >> radius;
-          AddSphereGeometry(body, radius, apos, arot);
-        }
-        break;
-      case collision::ELLIPSOID:
-        {
-          ChVector<> size;
-          iss >> size.x >> size.y >> size.z;
-          AddEllipsoidGeometry(body, size, apos, arot);
-        }
-        break;
-      case collision::BOX:
-        {
-          ChVector<> size;
-          iss >> size.x >> size.y >> size.z;
-          AddBoxGeometry(body, size, apos, arot);
-        }
-        break;
-      case collision::CAPSULE:
-        {
-          double radius, hlen;
-          iss >> radius >> hlen;
-          AddCapsuleGeometry(body, radius, hlen, apos, arot);
-        }
-        break;
-      ////case collision::CYLINDER:
-      ////  {
-      ////    double radius, hlen;
-      ////    iss >> radius >> hlen;
-      ////    AddCylinderGeometry(body, radius, hlen, apos, arot);
-      ////  }
-      ////  break;
-      case collision::CONE:
-        {
-          double radius, height;
-          iss >> radius >> height;
-          AddConeGeometry(body, radius, height, apos, arot);
-        }
-        break;
-      case collision::ROUNDEDBOX:
-        {
-          ChVector<> size;
-          double srad;
-          iss >> size.x >> size.y >> size.z >> srad;
-          AddRoundedBoxGeometry(body, size, srad, apos, arot);
-        }
-        break;
-        case collision::ROUNDEDCYL:
-        {
-          double radius, hlen, srad;
-          iss >> radius >> hlen >> srad;
-          AddRoundedCylinderGeometry(body, radius, hlen, srad, apos, arot);
-        }
-        break;
+    if (proto != prototypes.end()) {
+      // Share the collision shapes and visual assets of the prototype.
+      body->GetCollisionModel()->AddCopyOfAnotherModel(proto->second->GetCollisionModel());
+      std::vector<ChSharedPtr<ChAsset> >& assets = proto->second->GetAssets();
+      for (size_t k = 0; k < assets.size(); k++)
+        body->GetAssets().push_back(assets[k]);
+    } else {
+      // Add geometry for each shape and use this body as prototype.
+      const double* s = shapes.data();
+      const double* s_end = s + shapes.size();
+      while (s < s_end) {
+        ChVector<>     apos(s[0], s[1], s[2]);
+        ChQuaternion<> arot(s[3], s[4], s[5], s[6]);
+        int            atype = (int) s[7];
+        AddCheckpointShape(body, atype, s + 8, apos, arot);
+        s += 8 + CheckpointShapeSize(atype);
       }
+      prototypes[key] = body;
     }
 
     body->GetCollisionModel()->BuildModel();
@@ -332,49 +478,304 @@ void ReadCheckpoint(ChSystem*          system,
 
 
 // -----------------------------------------------------------------------------
-// WriteShapesPovray
+// ShapesFrame::Clear
+// -----------------------------------------------------------------------------
+void ShapesFrame::Clear()
+{
+  static_ref.clear();
+
+  body_id.clear();
+  body_active.clear();
+  body_pos.clear();
+  body_rot.clear();
+
+  asset_body_id.clear();
+  asset_active.clear();
+  asset_pos.clear();
+  asset_rot.clear();
+  asset_color.clear();
+  asset_type.clear();
+  asset_num_params.clear();
+  asset_params.clear();
+  mesh_names.clear();
+
+  link_type.clear();
+  link_num_params.clear();
+  link_params.clear();
+}
+
+
+// -----------------------------------------------------------------------------
+// ShapesPlan::IsValid
+// ShapesPlan::Clear
+// -----------------------------------------------------------------------------
+bool ShapesPlan::IsValid(ChSystem* sys, ShapesFilter flt) const
+{
+  if (sys != system || flt != filter)
+    return false;
+
+  // A body or link removed from the system may have been replaced by a new
+  // one at the same address, so identifiers are compared as well.
+  const std::vector<ChBody*>& sys_bodylist = *sys->Get_bodylist();
+  const std::vector<ChLink*>& sys_linklist = *sys->Get_linklist();
+
+  if (sys_bodylist.size() != sys_bodies.size() || sys_linklist.size() != sys_links.size())
+    return false;
+
+  for (size_t i = 0; i < sys_bodies.size(); i++) {
+    ChBody* body = sys_bodylist[i];
+    if (body != sys_bodies[i] || body->GetIdentifier() != sys_body_ids[i] || body->GetBodyFixed() != sys_body_fixed[i])
+      return false;
+  }
+
+  for (size_t i = 0; i < sys_links.size(); i++) {
+    ChLink* link = sys_linklist[i];
+    if (link != sys_links[i] || link->GetIdentifier() != sys_link_ids[i])
+      return false;
+  }
+
+  for (size_t i = 0; i < bodies.size(); i++) {
+    if (bodies[i]->GetAssets().size() != body_num_assets[i])
+      return false;
+  }
+
+  return true;
+}
+
+void ShapesPlan::Clear()
+{
+  system = 0;
+  filter = ALL_BODIES;
+
+  sys_bodies.clear();
+  sys_body_ids.clear();
+  sys_body_fixed.clear();
+  sys_links.clear();
+  sys_link_ids.clear();
+
+  bodies.clear();
+  body_num_assets.clear();
+  body_num_visual.clear();
+  body_asset_start.clear();
+
+  asset_body.clear();
+  asset_pos.clear();
+  asset_rot.clear();
+  asset_color.clear();
+  asset_type.clear();
+  asset_num_params.clear();
+  asset_params.clear();
+  asset_params_start.clear();
+  mesh_names.clear();
+
+  links.clear();
+  link_kind.clear();
+}
+
+
+// -----------------------------------------------------------------------------
+// BuildShapesPlan
+// UpdateShapesPlan
 //
-// Write CSV output file for PovRay.
-// First line contains the number of visual assets and links to follow.
-// A line with information about a visualization asset contains:
-//    bodyId, bodyActive, x, y, z, e0, e1, e2, e3, shapeType, [shape Data]
-// A line with information about a link contains:
-//    linkType, [linkData]
+// Resolve, once, the color, shape type, relative pose, and geometry data of all
+// supported visual assets, and classify all supported links.
 //
 // NOTE: we do not account for any transform specified for the ChGeometry of
 // a visual asset (except for cylinders where that is implicit)!
 // -----------------------------------------------------------------------------
-void WriteShapesPovray(ChSystem*          system,
-                       const std::string& filename,
-                       bool               body_info,
-                       const std::string& delim)
+
+// Categories of link data output per frame.
+enum LinkKind {
+  LINK_POS_ZAXIS,       // position and Z axis of marker 1 (revolute, prismatic, engine)
+  LINK_POS,             // position of marker 1 (spherical)
+  LINK_POS_POS,         // positions of markers 1 and 2 (springs)
+  LINK_UNIVERSAL,       // position and X axis of frame 1, Y axis of frame 2
+  LINK_DISTANCE         // absolute end points
+};
+
+static void PushVector(std::vector<double>& v, const ChVector<>& a)
 {
-  CSV_writer csv(delim);
+  v.push_back(a.x);
+  v.push_back(a.y);
+  v.push_back(a.z);
+}
 
-  // If requested, Loop over all bodies and write out their position and
-  // orientation.  Otherwise, body count is left at 0.
-  int b_count = 0;
+static void PushQuaternion(std::vector<double>& v, const ChQuaternion<>& q)
+{
+  v.push_back(q.e0);
+  v.push_back(q.e1);
+  v.push_back(q.e2);
+  v.push_back(q.e3);
+}
 
-  if (body_info) {
-    std::vector<ChBody*>::iterator ibody = system->Get_bodylist()->begin();
-    for (; ibody != system->Get_bodylist()->end(); ++ibody)
-    {
-      const ChVector<>& body_pos = (*ibody)->GetFrame_REF_to_abs().GetPos();
-      const ChQuaternion<>& body_rot = (*ibody)->GetFrame_REF_to_abs().GetRot();
+static bool SelectBody(ChBody* body, ShapesFilter filter)
+{
+  switch (filter) {
+  case FIXED_BODIES:  return body->GetBodyFixed();
+  case MOVING_BODIES: return !body->GetBodyFixed();
+  default:            return true;
+  }
+}
 
-      csv << (*ibody)->GetIdentifier() << (*ibody)->IsActive() << body_pos << body_rot << std::endl;
+// Append the shape type and geometry data of a visual asset to the plan. A
+// triangle mesh is recorded under the specified name if one is given, and under
+// the name of the asset otherwise. Return false if the asset type is not
+// supported.
+static bool ResolveVisualAsset(const ChSharedPtr<ChVisualization>& visual_asset,
+                               const std::string*                  mesh_name,
+                               ShapesPlan&                         plan)
+{
+  if (ChSharedPtr<ChSphereShape> sphere = visual_asset.DynamicCastTo<ChSphereShape>())
+  {
+    plan.asset_type.push_back(collision::SPHERE);
+    plan.asset_params.push_back(sphere->GetSphereGeometry().rad);
+  }
+  else if (ChSharedPtr<ChEllipsoidShape> ellipsoid = visual_asset.DynamicCastTo<ChEllipsoidShape>())
+  {
+    plan.asset_type.push_back(collision::ELLIPSOID);
+    PushVector(plan.asset_params, ellipsoid->GetEllipsoidGeometry().rad);
+  }
+  else if (ChSharedPtr<ChBoxShape> box = visual_asset.DynamicCastTo<ChBoxShape>())
+  {
+    plan.asset_type.push_back(collision::BOX);
+    PushVector(plan.asset_params, box->GetBoxGeometry().Size);
+  }
+  else if (ChSharedPtr<ChCapsuleShape> capsule = visual_asset.DynamicCastTo<ChCapsuleShape>())
+  {
+    const geometry::ChCapsule& geom = capsule->GetCapsuleGeometry();
+    plan.asset_type.push_back(collision::CAPSULE);
+    plan.asset_params.push_back(geom.rad);
+    plan.asset_params.push_back(geom.hlen);
+  }
+  else if (ChSharedPtr<ChCylinderShape> cylinder = visual_asset.DynamicCastTo<ChCylinderShape>())
+  {
+    const geometry::ChCylinder& geom = cylinder->GetCylinderGeometry();
+    plan.asset_type.push_back(collision::CYLINDER);
+    plan.asset_params.push_back(geom.rad);
+    PushVector(plan.asset_params, geom.p1);
+    PushVector(plan.asset_params, geom.p2);
+  }
+  else if (ChSharedPtr<ChConeShape> cone = visual_asset.DynamicCastTo<ChConeShape>())
+  {
+    const geometry::ChCone& geom = cone->GetConeGeometry();
+    plan.asset_type.push_back(collision::CONE);
+    plan.asset_params.push_back(geom.rad.x);
+    plan.asset_params.push_back(geom.rad.y);
+  }
+  else if (ChSharedPtr<ChRoundedBoxShape> rbox = visual_asset.DynamicCastTo<ChRoundedBoxShape>())
+  {
+    const geometry::ChRoundedBox& geom = rbox->GetRoundedBoxGeometry();
+    plan.asset_type.push_back(collision::ROUNDEDBOX);
+    PushVector(plan.asset_params, geom.Size);
+    plan.asset_params.push_back(geom.radsphere);
+  }
+  else if (ChSharedPtr<ChRoundedCylinderShape> rcyl = visual_asset.DynamicCastTo<ChRoundedCylinderShape>())
+  {
+    const geometry::ChRoundedCylinder& geom = rcyl->GetRoundedCylinderGeometry();
+    plan.asset_type.push_back(collision::ROUNDEDCYL);
+    plan.asset_params.push_back(geom.rad);
+    plan.asset_params.push_back(geom.hlen);
+    plan.asset_params.push_back(geom.radsphere);
+  }
+  else if (ChSharedPtr<ChTriangleMeshShape> mesh = visual_asset.DynamicCastTo<ChTriangleMeshShape>())
+  {
+    plan.asset_type.push_back(collision::TRIANGLEMESH);
+    plan.mesh_names.push_back(mesh_name ? *mesh_name : mesh->GetName());
+  }
+  else
+  {
+    return false;
+  }
 
-      b_count++;
-    }
+  return true;
+}
+
+// Append a visual asset, with the specified pose relative to its body, to the
+// plan. Return false if the asset type is not supported.
+static bool AddPlanAsset(const ChSharedPtr<ChVisualization>& visual_asset,
+                         const std::string*                  mesh_name,
+                         const ChVector<>&                   pos,
+                         const ChQuaternion<>&               rot,
+                         unsigned int                        body_index,
+                         const ChColor&                      color,
+                         ShapesPlan&                         plan)
+{
+  size_t num_params = plan.asset_params.size();
+
+  if (!ResolveVisualAsset(visual_asset, mesh_name, plan))
+    return false;
+
+  plan.asset_body.push_back(body_index);
+  plan.asset_pos.push_back(pos);
+  plan.asset_rot.push_back(rot);
+  plan.asset_color.push_back(color.R);
+  plan.asset_color.push_back(color.G);
+  plan.asset_color.push_back(color.B);
+  plan.asset_num_params.push_back((unsigned int)(plan.asset_params.size() - num_params));
+  plan.asset_params_start.push_back((unsigned int) num_params);
+
+  return true;
+}
+
+// Classify a link. Return false if the link type is not supported.
+static bool ResolveLink(ChLink* link, int& kind)
+{
+  if (dynamic_cast<ChLinkLockRevolute*>(link))
+    kind = LINK_POS_ZAXIS;
+  else if (dynamic_cast<ChLinkLockSpherical*>(link))
+    kind = LINK_POS;
+  else if (dynamic_cast<ChLinkLockPrismatic*>(link))
+    kind = LINK_POS_ZAXIS;
+  else if (dynamic_cast<ChLinkUniversal*>(link))
+    kind = LINK_UNIVERSAL;
+  else if (dynamic_cast<ChLinkSpring*>(link))
+    kind = LINK_POS_POS;
+  else if (dynamic_cast<ChLinkSpringCB*>(link))
+    kind = LINK_POS_POS;
+  else if (dynamic_cast<ChLinkDistance*>(link))
+    kind = LINK_DISTANCE;
+  else if (dynamic_cast<ChLinkEngine*>(link))
+    kind = LINK_POS_ZAXIS;
+  else
+    return false;
+
+  return true;
+}
+
+void BuildShapesPlan(ChSystem*    system,
+                     ShapesPlan&  plan,
+                     ShapesFilter filter)
+{
+  plan.Clear();
+
+  plan.system = system;
+  plan.filter = filter;
+
+  plan.sys_bodies = *system->Get_bodylist();
+  plan.sys_links = *system->Get_linklist();
+  plan.sys_body_ids.reserve(plan.sys_bodies.size());
+  plan.sys_body_fixed.reserve(plan.sys_bodies.size());
+  plan.sys_link_ids.reserve(plan.sys_links.size());
+  for (size_t i = 0; i < plan.sys_bodies.size(); i++) {
+    plan.sys_body_ids.push_back(plan.sys_bodies[i]->GetIdentifier());
+    plan.sys_body_fixed.push_back(plan.sys_bodies[i]->GetBodyFixed());
   }
+  for (size_t i = 0; i < plan.sys_links.size(); i++)
+    plan.sys_link_ids.push_back(plan.sys_links[i]->GetIdentifier());
 
-  // Loop over all bodies and over all their assets.
-  int a_count = 0;
+  // Loop over all selected bodies and over all their assets.
   std::vector<ChBody*>::iterator ibody = system->Get_bodylist()->begin();
   for (; ibody != system->Get_bodylist()->end(); ++ibody)
   {
-    const ChVector<>& body_pos = (*ibody)->GetFrame_REF_to_abs().GetPos();
-    const ChQuaternion<>& body_rot = (*ibody)->GetFrame_REF_to_abs().GetRot();
+    if (!SelectBody(*ibody, filter))
+      continue;
+
+    unsigned int body_index = (unsigned int) plan.bodies.size();
+    unsigned int num_visual = 0;
+
+    plan.bodies.push_back(*ibody);
+    plan.body_num_assets.push_back((unsigned int) (*ibody)->GetAssets().size());
+    plan.body_asset_start.push_back((unsigned int) plan.asset_body.size());
 
     ChColor color(0.8f, 0.8f, 0.8f);
 
@@ -386,159 +787,1365 @@ void WriteShapesPovray(ChSystem*          system,
         color = color_asset->GetColor();
     }
 
-    // Loop over assets once again -- write information for supported types.
+    // Loop over assets once again -- resolve supported visual assets. Visual
+    // assets in an asset level (e.g. shared meshes) are placed relative to the
+    // frame of the level; meshes in a ChMeshLevel take the name of the level.
     iasset = (*ibody)->GetAssets().begin();
     for (; iasset != (*ibody)->GetAssets().end(); ++iasset)
     {
+      if (ChSharedPtr<ChAssetLevel> level = (*iasset).DynamicCastTo<ChAssetLevel>())
+      {
+        const ChFrame<>& frame = level->GetFrame();
+        ChSharedPtr<ChMeshLevel> mesh_level = level.DynamicCastTo<ChMeshLevel>();
+        const std::string* mesh_name = mesh_level.IsNull() ? 0 : &mesh_level->GetName();
+        std::vector<ChSharedPtr<ChAsset> >::iterator ilevel = level->GetAssets().begin();
+        for (; ilevel != level->GetAssets().end(); ++ilevel)
+        {
+          ChSharedPtr<ChVisualization> visual_asset = (*ilevel).DynamicCastTo<ChVisualization>();
+          if (visual_asset.IsNull())
+            continue;
+
+          num_visual++;
+          AddPlanAsset(visual_asset, mesh_name,
+                       frame.GetPos() + frame.GetRot().Rotate(visual_asset->Pos),
+                       frame.GetRot() % visual_asset->Rot.Get_A_quaternion(),
+                       body_index, color, plan);
+        }
+        continue;
+      }
+
       ChSharedPtr<ChVisualization> visual_asset = (*iasset).DynamicCastTo<ChVisualization>();
       if (visual_asset.IsNull())
         continue;
 
-      const Vector& asset_pos = visual_asset->Pos;
-      Quaternion    asset_rot = visual_asset->Rot.Get_A_quaternion();
-
-      Vector     pos = body_pos + body_rot.Rotate(asset_pos);
-      Quaternion rot = body_rot % asset_rot;
+      num_visual++;
+      AddPlanAsset(visual_asset, 0, visual_asset->Pos, visual_asset->Rot.Get_A_quaternion(), body_index, color, plan);
+    }
 
-      std::stringstream gss;
+    plan.body_num_visual.push_back(num_visual);
+  }
 
-      if (ChSharedPtr<ChSphereShape> sphere = visual_asset.DynamicCastTo<ChSphereShape>())
-      {
-        gss << collision::SPHERE << delim << sphere->GetSphereGeometry().rad;
-        a_count++;
-      }
-      else if (ChSharedPtr<ChEllipsoidShape> ellipsoid = visual_asset.DynamicCastTo<ChEllipsoidShape>()) {
-        const Vector& size = ellipsoid->GetEllipsoidGeometry().rad;
-        gss << collision::ELLIPSOID << delim << size.x << delim << size.y << delim << size.z;
-        a_count++;
-      }
-      else if (ChSharedPtr<ChBoxShape> box = visual_asset.DynamicCastTo<ChBoxShape>())
-      {
-        const Vector& size = box->GetBoxGeometry().Size;
-        gss << collision::BOX << delim << size.x << delim << size.y << delim << size.z;
-        a_count++;
-      }
-      else if (ChSharedPtr<ChCapsuleShape> capsule = visual_asset.DynamicCastTo<ChCapsuleShape>())
-      {
-        const geometry::ChCapsule& geom = capsule->GetCapsuleGeometry();
-        gss << collision::CAPSULE << delim << geom.rad << delim << geom.hlen;
-        a_count++;
-      }
-      else if (ChSharedPtr<ChCylinderShape> cylinder = visual_asset.DynamicCastTo<ChCylinderShape>())
-      {
-        const geometry::ChCylinder& geom = cylinder->GetCylinderGeometry();
-        gss << collision::CYLINDER << delim << geom.rad << delim
-            << geom.p1.x << delim << geom.p1.y << delim << geom.p1.z << delim
-            << geom.p2.x << delim << geom.p2.y << delim << geom.p2.z;
-        a_count++;
-      }
-      else if (ChSharedPtr<ChConeShape> cone = visual_asset.DynamicCastTo<ChConeShape>())
-      {
-        const geometry::ChCone& geom = cone->GetConeGeometry();
-        gss << collision::CONE << delim << geom.rad.x << delim << geom.rad.y;
-        a_count++;
-      }
-      else if (ChSharedPtr<ChRoundedBoxShape> rbox = visual_asset.DynamicCastTo<ChRoundedBoxShape>())
-      {
-        const geometry::ChRoundedBox& geom = rbox->GetRoundedBoxGeometry();
-        gss << collision::ROUNDEDBOX << delim << geom.Size.x << delim << geom.Size.y << delim << geom.Size.z << delim << geom.radsphere;
-        a_count++;
-      }
-      else if (ChSharedPtr<ChRoundedCylinderShape> rcyl = visual_asset.DynamicCastTo<ChRoundedCylinderShape>())
-      {
-        const geometry::ChRoundedCylinder& geom = rcyl->GetRoundedCylinderGeometry();
-        gss << collision::ROUNDEDCYL << delim << geom.rad << delim << geom.hlen << delim << geom.radsphere;
-        a_count++;
-      }
-      else if (ChSharedPtr<ChTriangleMeshShape> mesh = visual_asset.DynamicCastTo<ChTriangleMeshShape>())
-      {
-        gss << collision::TRIANGLEMESH << delim << "\"" << mesh->GetName() << "\"";
-        a_count++;
-      }
+  plan.body_asset_start.push_back((unsigned int) plan.asset_body.size());
 
-      csv << (*ibody)->GetIdentifier() << (*ibody)->IsActive() 
-          << pos << rot 
-          << color
-          << gss.str() << std::endl;
-    }
-  }
+  // The static scene does not include any links.
+  if (filter == FIXED_BODIES)
+    return;
 
-  // Loop over all links.  Write information on selected types of links.
-  int l_count = 0;
+  // Loop over all links and classify supported types.
   std::vector<ChLink*>::iterator ilink = system->Get_linklist()->begin();
   for (; ilink != system->Get_linklist()->end(); ++ilink)
   {
-    int type = (*ilink)->GetType();
-
-    if (ChLinkLockRevolute* link = dynamic_cast<ChLinkLockRevolute*>(*ilink))
-    {
-      chrono::ChFrame<> frA_abs = *(link->GetMarker1()) >> *(link->GetBody1());
-      chrono::ChFrame<> frB_abs = *(link->GetMarker2()) >> *(link->GetBody2());
+    int kind;
+    if (!ResolveLink(*ilink, kind))
+      continue;
 
-      csv << type << frA_abs.GetPos() << frA_abs.GetA().Get_A_Zaxis() << std::endl;
-      l_count++;
-    }
-    else if (ChLinkLockSpherical* link = dynamic_cast<ChLinkLockSpherical*>(*ilink))
-    {
-      chrono::ChFrame<> frA_abs = *(link->GetMarker1()) >> *(link->GetBody1());
-      chrono::ChFrame<> frB_abs = *(link->GetMarker2()) >> *(link->GetBody2());
+    plan.links.push_back(*ilink);
+    plan.link_kind.push_back(kind);
+  }
+}
 
-      csv << type << frA_abs.GetPos() << std::endl;
-      l_count++;
-    }
-    if (ChLinkLockPrismatic* link = dynamic_cast<ChLinkLockPrismatic*>(*ilink))
-    {
-      chrono::ChFrame<> frA_abs = *(link->GetMarker1()) >> *(link->GetBody1());
-      chrono::ChFrame<> frB_abs = *(link->GetMarker2()) >> *(link->GetBody2());
+bool UpdateShapesPlan(ChSystem*    system,
+                      ShapesPlan&  plan,
+                      ShapesFilter filter)
+{
+  if (plan.IsValid(system, filter))
+    return false;
 
-      csv << type << frA_abs.GetPos() << frA_abs.GetA().Get_A_Zaxis() << std::endl;
-      l_count++;
-    }
-    else if (ChLinkUniversal* link = dynamic_cast<ChLinkUniversal*>(*ilink))
-    {
-      chrono::ChFrame<> frA_abs = link->GetFrame1Abs();
-      chrono::ChFrame<> frB_abs = link->GetFrame2Abs();
+  BuildShapesPlan(system, plan, filter);
+  return true;
+}
 
-      csv << type << frA_abs.GetPos() << frA_abs.GetA().Get_A_Xaxis() << frB_abs.GetA().Get_A_Yaxis() << std::endl;
-      l_count++;
-    }
-    else if (ChLinkSpring* link = dynamic_cast<ChLinkSpring*>(*ilink))
-    {
-      chrono::ChFrame<> frA_abs = *(link->GetMarker1()) >> *(link->GetBody1());
-      chrono::ChFrame<> frB_abs = *(link->GetMarker2()) >> *(link->GetBody2());
 
-      csv << type << frA_abs.GetPos() << frB_abs.GetPos() << std::endl;
-      l_count++;
-    }
-    else if (ChLinkSpringCB* link = dynamic_cast<ChLinkSpringCB*>(*ilink))
-    {
-      chrono::ChFrame<> frA_abs = *(link->GetMarker1()) >> *(link->GetBody1());
-      chrono::ChFrame<> frB_abs = *(link->GetMarker2()) >> *(link->GetBody2());
+// -----------------------------------------------------------------------------
+// CaptureShapes
+//
+// Collect, in the specified frame object, the information on bodies, visual
+// assets, and links that is output by WriteShapesPovray. Only the body poses
+// and the link frames are evaluated; everything else is copied from the plan.
+// -----------------------------------------------------------------------------
+void CaptureShapes(ChSystem*    system,
+                   ShapesFrame& frame,
+                   bool         body_info,
+                   ShapesFilter filter)
+{
+  ShapesPlan plan;
+  BuildShapesPlan(system, plan, filter);
+  CaptureShapes(plan, frame, body_info);
+}
+
+void CaptureShapes(const ShapesPlan& plan,
+                   ShapesFrame&      frame,
+                   bool              body_info)
+{
+  frame.Clear();
+
+  size_t nb = plan.GetNumBodies();
+  size_t na = plan.GetNumAssets();
+
+  // If requested, Loop over all bodies and collect their position and
+  // orientation.  Otherwise, body count is left at 0.
+  if (body_info) {
+    for (size_t i = 0; i < nb; i++) {
+      ChBody* body = plan.bodies[i];
+      frame.body_id.push_back(body->GetIdentifier());
+      frame.body_active.push_back(body->IsActive());
+      PushVector(frame.body_pos, body->GetFrame_REF_to_abs().GetPos());
+      PushQuaternion(frame.body_rot, body->GetFrame_REF_to_abs().GetRot());
+    }
+  }
+
+  // Compose the current body poses with the cached relative asset transforms.
+  frame.asset_body_id.reserve(na);
+  frame.asset_active.reserve(na);
+  frame.asset_pos.reserve(3 * na);
+  frame.asset_rot.reserve(4 * na);
+
+  for (size_t ib = 0; ib < nb; ib++) {
+    ChBody* body = plan.bodies[ib];
+
+    int                   body_id = body->GetIdentifier();
+    bool                  body_active = body->IsActive();
+    const ChVector<>&     body_pos = body->GetFrame_REF_to_abs().GetPos();
+    const ChQuaternion<>& body_rot = body->GetFrame_REF_to_abs().GetRot();
+
+    for (unsigned int i = plan.body_asset_start[ib]; i < plan.body_asset_start[ib + 1]; i++) {
+      frame.asset_body_id.push_back(body_id);
+      frame.asset_active.push_back(body_active);
+      PushVector(frame.asset_pos, body_pos + body_rot.Rotate(plan.asset_pos[i]));
+      PushQuaternion(frame.asset_rot, body_rot % plan.asset_rot[i]);
+    }
+  }
+
+  frame.asset_color.assign(plan.asset_color.begin(), plan.asset_color.end());
+  frame.asset_type.assign(plan.asset_type.begin(), plan.asset_type.end());
+  frame.asset_num_params.assign(plan.asset_num_params.begin(), plan.asset_num_params.end());
+  frame.asset_params.assign(plan.asset_params.begin(), plan.asset_params.end());
+  frame.mesh_names.assign(plan.mesh_names.begin(), plan.mesh_names.end());
+
+  // Loop over all planned links and collect their current frames.
+  for (size_t i = 0; i < plan.GetNumLinks(); i++)
+  {
+    ChLink* link = plan.links[i];
+    size_t num_params = frame.link_params.size();
+
+    switch (plan.link_kind[i]) {
+    case LINK_POS_ZAXIS:
+      {
+        ChLinkMarkers* mlink = static_cast<ChLinkMarkers*>(link);
+        chrono::ChFrame<> frA_abs = *(mlink->GetMarker1()) >> *(mlink->GetBody1());
+
+        PushVector(frame.link_params, frA_abs.GetPos());
+        PushVector(frame.link_params, frA_abs.GetA().Get_A_Zaxis());
+      }
+      break;
+    case LINK_POS:
+      {
+        ChLinkMarkers* mlink = static_cast<ChLinkMarkers*>(link);
+        chrono::ChFrame<> frA_abs = *(mlink->GetMarker1()) >> *(mlink->GetBody1());
+
+        PushVector(frame.link_params, frA_abs.GetPos());
+      }
+      break;
+    case LINK_POS_POS:
+      {
+        ChLinkMarkers* mlink = static_cast<ChLinkMarkers*>(link);
+        chrono::ChFrame<> frA_abs = *(mlink->GetMarker1()) >> *(mlink->GetBody1());
+        chrono::ChFrame<> frB_abs = *(mlink->GetMarker2()) >> *(mlink->GetBody2());
+
+        PushVector(frame.link_params, frA_abs.GetPos());
+        PushVector(frame.link_params, frB_abs.GetPos());
+      }
+      break;
+    case LINK_UNIVERSAL:
+      {
+        ChLinkUniversal* ulink = static_cast<ChLinkUniversal*>(link);
+        chrono::ChFrame<> frA_abs = ulink->GetFrame1Abs();
+        chrono::ChFrame<> frB_abs = ulink->GetFrame2Abs();
+
+        PushVector(frame.link_params, frA_abs.GetPos());
+        PushVector(frame.link_params, frA_abs.GetA().Get_A_Xaxis());
+        PushVector(frame.link_params, frB_abs.GetA().Get_A_Yaxis());
+      }
+      break;
+    case LINK_DISTANCE:
+      {
+        ChLinkDistance* dlink = static_cast<ChLinkDistance*>(link);
+
+        PushVector(frame.link_params, dlink->GetEndPoint1Abs());
+        PushVector(frame.link_params, dlink->GetEndPoint2Abs());
+      }
+      break;
+    }
+
+    frame.link_type.push_back(link->GetType());
+    frame.link_num_params.push_back((unsigned int)(frame.link_params.size() - num_params));
+  }
+}
+
+
+// -----------------------------------------------------------------------------
+// WriteShapesPovray
+//
+// Write CSV output file for PovRay.
+// First line contains the number of visual assets and links to follow.
+// A line with information about a visualization asset contains:
+//    bodyId, bodyActive, x, y, z, e0, e1, e2, e3, shapeType, [shape Data]
+// A line with information about a link contains:
+//    linkType, [linkData]
+// -----------------------------------------------------------------------------
+bool WriteShapesPovray(ChSystem*          system,
+                       const std::string& filename,
+                       bool               body_info,
+                       const std::string& delim)
+{
+  ShapesFrame frame;
+  CaptureShapes(system, frame, body_info);
+  return WriteShapesPovray(frame, filename, delim);
+}
+
+bool WriteShapesPovray(const ShapesFrame&  frame,
+                       const std::string&  filename,
+                       const std::string&  delim)
+{
+  CSV_writer csv(delim);
+  if (!csv.open(filename))
+    return false;
+
+  // Write a first line with the number of bodies, visual assets, and links.
+  size_t b_count = frame.GetNumBodies();
+  size_t a_count = frame.GetNumAssets();
+  size_t l_count = frame.GetNumLinks();
+
+  csv.stream() << b_count << delim << a_count << delim << l_count << delim;
+  if (!frame.static_ref.empty())
+    csv.stream() << "\"" << frame.static_ref << "\"" << delim;
+  csv.stream() << '\n';
+
+  for (size_t i = 0; i < b_count; i++) {
+    const double* pos = &frame.body_pos[3 * i];
+    const double* rot = &frame.body_rot[4 * i];
+
+    csv << frame.body_id[i] << (frame.body_active[i] != 0);
+    csv << pos[0] << pos[1] << pos[2] << rot[0] << rot[1] << rot[2] << rot[3] << std::endl;
+  }
+
+  const double* params = frame.asset_params.data();
+  size_t mesh_count = 0;
+
+  for (size_t i = 0; i < a_count; i++) {
+    const double* pos = &frame.asset_pos[3 * i];
+    const double* rot = &frame.asset_rot[4 * i];
+    const float*  col = &frame.asset_color[3 * i];
+
+    csv << frame.asset_body_id[i] << (frame.asset_active[i] != 0);
+    csv << pos[0] << pos[1] << pos[2] << rot[0] << rot[1] << rot[2] << rot[3];
+    csv << col[0] << col[1] << col[2];
+    csv << frame.asset_type[i];
+
+    if (frame.asset_type[i] == collision::TRIANGLEMESH)
+      csv << "\"" + frame.mesh_names[mesh_count++] + "\"";
+
+    for (unsigned int j = 0; j < frame.asset_num_params[i]; j++)
+      csv << *params++;
+
+    csv << std::endl;
+  }
+
+  params = frame.link_params.data();
+
+  for (size_t i = 0; i < l_count; i++) {
+    csv << frame.link_type[i];
+    for (unsigned int j = 0; j < frame.link_num_params[i]; j++)
+      csv << *params++;
+    csv << std::endl;
+  }
+
+  return csv.close();
+}
+
+
+// -----------------------------------------------------------------------------
+// WriteStaticShapesPovray
+// WriteMovingShapesPovray
+//
+// Split the PovRay output into a static scene file (written once) with all
+// fixed bodies, and per-frame files with only the non-fixed bodies and links.
+// -----------------------------------------------------------------------------
+bool WriteStaticShapesPovray(ChSystem*          system,
+                             const std::string& filename,
+                             bool               body_info,
+                             const std::string& delim)
+{
+  ShapesFrame frame;
+  CaptureShapes(system, frame, body_info, FIXED_BODIES);
+  return WriteShapesPovray(frame, filename, delim);
+}
 
-      csv << type << frA_abs.GetPos() << frB_abs.GetPos() << std::endl;
-      l_count++;
+bool WriteMovingShapesPovray(ChSystem*          system,
+                             const std::string& filename,
+                             const std::string& static_filename,
+                             bool               body_info,
+                             const std::string& delim)
+{
+  ShapesFrame frame;
+  CaptureShapes(system, frame, body_info, MOVING_BODIES);
+  frame.static_ref = static_filename;
+  return WriteShapesPovray(frame, filename, delim);
+}
+
+
+// -----------------------------------------------------------------------------
+// Binary frame format
+//
+// All values are stored little-endian. The file starts with a header:
+//    magic "CHSF", version,
+//    numBodies, numAssets, numLinks, numAssetParams, numLinkParams, numNameBytes
+// (all 32-bit unsigned integers), the length of the name of the static scene
+// file (32-bit unsigned integer) and its characters (version 2 and later),
+// followed by the data blocks, in this order:
+//    body ids (int32), body active flags (uint8), body positions (3 x float64),
+//    body rotations (4 x float64),
+//    asset body ids (int32), asset active flags (uint8), asset positions
+//    (3 x float64), asset rotations (4 x float64), asset colors (3 x float32),
+//    asset shape types (int32), asset data counts (uint32), asset data
+//    (float64), mesh names (NUL-terminated characters),
+//    link types (int32), link data counts (uint32), link data (float64).
+// -----------------------------------------------------------------------------
+static const char     SHAPES_BINARY_MAGIC[4] = { 'C', 'H', 'S', 'F' };
+static const uint32_t SHAPES_BINARY_VERSION = 2;
+
+static bool HostIsLittleEndian()
+{
+  const uint16_t one = 1;
+  return *reinterpret_cast<const unsigned char*>(&one) == 1;
+}
+
+static void SwapBytes(char* data, size_t size, size_t n)
+{
+  for (size_t i = 0; i < n; i++, data += size)
+    std::reverse(data, data + size);
+}
+
+template <typename T>
+static void PutArray(std::vector<char>& buffer, const T* data, size_t n)
+{
+  if (n == 0)
+    return;
+
+  size_t offset = buffer.size();
+  buffer.resize(offset + n * sizeof(T));
+  std::memcpy(&buffer[offset], data, n * sizeof(T));
+
+  if (!HostIsLittleEndian())
+    SwapBytes(&buffer[offset], sizeof(T), n);
+}
+
+template <typename T>
+static void PutValue(std::vector<char>& buffer, T value)
+{
+  PutArray(buffer, &value, 1);
+}
+
+template <typename T>
+static bool GetArray(const char*& cur, const char* end, std::vector<T>& v, size_t n)
+{
+  if ((size_t)(end - cur) < n * sizeof(T))
+    return false;
+
+  v.resize(n);
+  if (n == 0)
+    return true;
+
+  std::memcpy(v.data(), cur, n * sizeof(T));
+  cur += n * sizeof(T);
+
+  if (!HostIsLittleEndian())
+    SwapBytes(reinterpret_cast<char*>(v.data()), sizeof(T), n);
+
+  return true;
+}
+
+template <typename T>
+static bool GetValue(const char*& cur, const char* end, T& value)
+{
+  std::vector<T> v;
+  if (!GetArray(cur, end, v, 1))
+    return false;
+  value = v[0];
+  return true;
+}
+
+void PackShapesBinary(const ShapesFrame& frame,
+                      std::vector<char>& buffer)
+{
+  uint32_t nb = (uint32_t) frame.GetNumBodies();
+  uint32_t na = (uint32_t) frame.GetNumAssets();
+  uint32_t nl = (uint32_t) frame.GetNumLinks();
+
+  std::string names;
+  for (size_t i = 0; i < frame.mesh_names.size(); i++) {
+    names += frame.mesh_names[i];
+    names += '\0';
+  }
+
+  // Reserve space for the entire frame, so that the buffer is grown only once.
+  buffer.reserve(buffer.size() + 9 * sizeof(uint32_t) + frame.static_ref.size() +
+                 nb * (sizeof(int32_t) + 1 + 7 * sizeof(double)) +
+                 na * (3 * sizeof(int32_t) + 1 + 7 * sizeof(double) + 3 * sizeof(float)) +
+                 nl * 2 * sizeof(int32_t) +
+                 (frame.asset_params.size() + frame.link_params.size()) * sizeof(double) +
+                 names.size());
+
+  // Header
+  PutArray(buffer, SHAPES_BINARY_MAGIC, 4);
+  PutValue(buffer, SHAPES_BINARY_VERSION);
+  PutValue(buffer, nb);
+  PutValue(buffer, na);
+  PutValue(buffer, nl);
+  PutValue(buffer, (uint32_t) frame.asset_params.size());
+  PutValue(buffer, (uint32_t) frame.link_params.size());
+  PutValue(buffer, (uint32_t) names.size());
+  PutValue(buffer, (uint32_t) frame.static_ref.size());
+  PutArray(buffer, frame.static_ref.data(), frame.static_ref.size());
+
+  // Bodies
+  PutArray(buffer, frame.body_id.data(), nb);
+  PutArray(buffer, frame.body_active.data(), nb);
+  PutArray(buffer, frame.body_pos.data(), 3 * nb);
+  PutArray(buffer, frame.body_rot.data(), 4 * nb);
+
+  // Assets
+  PutArray(buffer, frame.asset_body_id.data(), na);
+  PutArray(buffer, frame.asset_active.data(), na);
+  PutArray(buffer, frame.asset_pos.data(), 3 * na);
+  PutArray(buffer, frame.asset_rot.data(), 4 * na);
+  PutArray(buffer, frame.asset_color.data(), 3 * na);
+  PutArray(buffer, frame.asset_type.data(), na);
+  PutArray(buffer, frame.asset_num_params.data(), na);
+  PutArray(buffer, frame.asset_params.data(), frame.asset_params.size());
+  PutArray(buffer, names.data(), names.size());
+
+  // Links
+  PutArray(buffer, frame.link_type.data(), nl);
+  PutArray(buffer, frame.link_num_params.data(), nl);
+  PutArray(buffer, frame.link_params.data(), frame.link_params.size());
+}
+
+bool UnpackShapesBinary(const char*  data,
+                        size_t       size,
+                        ShapesFrame& frame)
+{
+  const char* cur = data;
+  const char* end = data + size;
+
+  // Header
+  if (size < 4 || std::memcmp(cur, SHAPES_BINARY_MAGIC, 4) != 0)
+    return false;
+  cur += 4;
+
+  uint32_t version, nb, na, nl, nap, nlp, nnb;
+  if (!GetValue(cur, end, version) || version < 1 || version > SHAPES_BINARY_VERSION)
+    return false;
+  if (!GetValue(cur, end, nb) || !GetValue(cur, end, na) || !GetValue(cur, end, nl))
+    return false;
+  if (!GetValue(cur, end, nap) || !GetValue(cur, end, nlp) || !GetValue(cur, end, nnb))
+    return false;
+
+  frame.static_ref.clear();
+  if (version >= 2) {
+    uint32_t nsb;
+    std::vector<char> ref;
+    if (!GetValue(cur, end, nsb) || !GetArray(cur, end, ref, nsb))
+      return false;
+    frame.static_ref.assign(ref.begin(), ref.end());
+  }
+
+  // Bodies
+  bool ok = GetArray(cur, end, frame.body_id, nb) &&
+            GetArray(cur, end, frame.body_active, nb) &&
+            GetArray(cur, end, frame.body_pos, 3 * (size_t) nb) &&
+            GetArray(cur, end, frame.body_rot, 4 * (size_t) nb);
+
+  // Assets
+  std::vector<char> names;
+  ok = ok && GetArray(cur, end, frame.asset_body_id, na) &&
+             GetArray(cur, end, frame.asset_active, na) &&
+             GetArray(cur, end, frame.asset_pos, 3 * (size_t) na) &&
+             GetArray(cur, end, frame.asset_rot, 4 * (size_t) na) &&
+             GetArray(cur, end, frame.asset_color, 3 * (size_t) na) &&
+             GetArray(cur, end, frame.asset_type, na) &&
+             GetArray(cur, end, frame.asset_num_params, na) &&
+             GetArray(cur, end, frame.asset_params, nap) &&
+             GetArray(cur, end, names, nnb);
+
+  // Links
+  ok = ok && GetArray(cur, end, frame.link_type, nl) &&
+             GetArray(cur, end, frame.link_num_params, nl) &&
+             GetArray(cur, end, frame.link_params, nlp);
+
+  if (!ok)
+    return false;
+
+  // Split the mesh names.
+  frame.mesh_names.clear();
+  std::vector<char>::const_iterator start = names.begin();
+  for (std::vector<char>::const_iterator it = names.begin(); it != names.end(); ++it) {
+    if (*it == '\0') {
+      frame.mesh_names.push_back(std::string(start, it));
+      start = it + 1;
     }
-    else if (ChLinkDistance* link = dynamic_cast<ChLinkDistance*>(*ilink))
+  }
+
+  return true;
+}
+
+
+// -----------------------------------------------------------------------------
+// WriteShapesBinary
+// ReadShapesBinary
+//
+// Write and read binary output files with the same content as the CSV files
+// created by WriteShapesPovray. The frame is serialized in memory and written
+// to disk with a single call.
+// -----------------------------------------------------------------------------
+bool WriteShapesBinary(ChSystem*          system,
+                       const std::string& filename,
+                       bool               body_info)
+{
+  ShapesFrame frame;
+  CaptureShapes(system, frame, body_info);
+  return WriteShapesBinary(frame, filename);
+}
+
+bool WriteShapesBinary(const ShapesFrame& frame,
+                       const std::string& filename)
+{
+  std::vector<char> buffer;
+  PackShapesBinary(frame, buffer);
+
+  std::ofstream ofile(filename.c_str(), std::ios::binary);
+  if (!ofile.is_open())
+    return false;
+
+  ofile.write(buffer.data(), buffer.size());
+  ofile.close();
+
+  return ofile.good();
+}
+
+bool ReadShapesBinary(const std::string& filename,
+                      ShapesFrame&       frame)
+{
+  std::ifstream ifile(filename.c_str(), std::ios::binary);
+  if (!ifile.is_open())
+    return false;
+
+  std::vector<char> buffer((std::istreambuf_iterator<char>(ifile)),
+                           std::istreambuf_iterator<char>());
+
+  return UnpackShapesBinary(buffer.data(), buffer.size(), frame);
+}
+
+// -----------------------------------------------------------------------------
+// Binary checkpoint format
+//
+// All values are stored little-endian, using the same conventions as the
+// binary frame format. The file starts with the magic "CHCP" and a version
+// (uint32), followed by:
+//    system settings: time, step, tolerance, force tolerance, maximum
+//    penetration recovery speed, minimum bounce speed, SOR omega, SOR
+//    sharpness, gravity (3) (float64), solver type, integrator type, speed and
+//    stabilization solver iterations, assembly iterations (int32), warm
+//    starting flag (uint8);
+//    number of bodies (uint32) and, for each body:
+//       contact method, identifier (int32), fixed and collide flags (uint8),
+//       mass, inertia XX (3), inertia XY (3), position (3), rotation (4), and
+//       their first (3+4) and second (3+4) time derivatives (float64), all
+//       for the centroidal frame,
+//       auxiliary reference flag (uint8) and, for a ChBodyAuxRef, the frame of
+//       its reference (3+4) and of its centroid relative to the reference
+//       (3+4) (float64),
+//       material properties (float64, 11 for DVI or 6 for DEM),
+//       collision family (int32), family mask (uint16), envelope and safe
+//       margin (float64), color flag (uint8) and color (3 x float32),
+//       number of shapes (uint32) and, for each shape, its relative position
+//       (3) and rotation (4) (float64), shape type (int32), number of shape
+//       data values (uint32) and shape data (float64);
+//    number of links (uint32) and, for each link:
+//       link kind (int32), indices of the two connected bodies (uint32), and
+//       kind-specific data (marker frames relative to their bodies, motor
+//       modes, offsets, and motion functions).
+// A motion function is stored as its type (int32) followed by its parameters
+// (float64).
+// -----------------------------------------------------------------------------
+static const char     CHECKPOINT_BINARY_MAGIC[4] = { 'C', 'H', 'C', 'P' };
+static const uint32_t CHECKPOINT_BINARY_VERSION = 2;
+
+// Kinds of links supported in binary checkpoints.
+enum CheckpointLinkKind {
+  CKPT_LINK_LOCK,
+  CKPT_LINK_REVOLUTE,
+  CKPT_LINK_SPHERICAL,
+  CKPT_LINK_PRISMATIC,
+  CKPT_LINK_ENGINE,
+  CKPT_LINK_LINACTUATOR,
+  CKPT_LINK_DISTANCE
+};
+
+// Types of motion functions supported in binary checkpoints.
+enum CheckpointFunctionType {
+  CKPT_FUNCTION_CONST,
+  CKPT_FUNCTION_RAMP,
+  CKPT_FUNCTION_SINE
+};
+
+static const int CHECKPOINT_NUM_FAMILIES = 16;
+
+static void PutVector(std::vector<char>& buffer, const ChVector<>& v)
+{
+  double data[3] = { v.x, v.y, v.z };
+  PutArray(buffer, data, 3);
+}
+
+static void PutQuaternion(std::vector<char>& buffer, const ChQuaternion<>& q)
+{
+  double data[4] = { q.e0, q.e1, q.e2, q.e3 };
+  PutArray(buffer, data, 4);
+}
+
+static void PutCoordsys(std::vector<char>& buffer, const ChCoordsys<>& csys)
+{
+  PutVector(buffer, csys.pos);
+  PutQuaternion(buffer, csys.rot);
+}
+
+static bool GetVector(const char*& cur, const char* end, ChVector<>& v)
+{
+  std::vector<double> data;
+  if (!GetArray(cur, end, data, 3))
+    return false;
+  v = ChVector<>(data[0], data[1], data[2]);
+  return true;
+}
+
+static bool GetQuaternion(const char*& cur, const char* end, ChQuaternion<>& q)
+{
+  std::vector<double> data;
+  if (!GetArray(cur, end, data, 4))
+    return false;
+  q = ChQuaternion<>(data[0], data[1], data[2], data[3]);
+  return true;
+}
+
+static bool GetCoordsys(const char*& cur, const char* end, ChCoordsys<>& csys)
+{
+  return GetVector(cur, end, csys.pos) && GetQuaternion(cur, end, csys.rot);
+}
+
+// Write a motion function. Return false if its type is not supported.
+static bool PutFunction(std::vector<char>& buffer, const ChSharedPtr<ChFunction>& fun)
+{
+  if (ChSharedPtr<ChFunction_Const> fconst = fun.DynamicCastTo<ChFunction_Const>())
+  {
+    PutValue(buffer, (int32_t) CKPT_FUNCTION_CONST);
+    PutValue(buffer, fconst->Get_yconst());
+  }
+  else if (ChSharedPtr<ChFunction_Ramp> framp = fun.DynamicCastTo<ChFunction_Ramp>())
+  {
+    PutValue(buffer, (int32_t) CKPT_FUNCTION_RAMP);
+    PutValue(buffer, framp->Get_y0());
+    PutValue(buffer, framp->Get_ang());
+  }
+  else if (ChSharedPtr<ChFunction_Sine> fsine = fun.DynamicCastTo<ChFunction_Sine>())
+  {
+    PutValue(buffer, (int32_t) CKPT_FUNCTION_SINE);
+    PutValue(buffer, fsine->Get_phase());
+    PutValue(buffer, fsine->Get_freq());
+    PutValue(buffer, fsine->Get_amp());
+  }
+  else
+  {
+    return false;
+  }
+
+  return true;
+}
+
+// Read a motion function. Return an empty pointer on error.
+static ChSharedPtr<ChFunction> GetFunction(const char*& cur, const char* end)
+{
+  int32_t type;
+  std::vector<double> p;
+  if (!GetValue(cur, end, type))
+    return ChSharedPtr<ChFunction>();
+
+  switch (type) {
+  case CKPT_FUNCTION_CONST:
+    if (GetArray(cur, end, p, 1))
+      return ChSharedPtr<ChFunction>(new ChFunction_Const(p[0]));
+    break;
+  case CKPT_FUNCTION_RAMP:
+    if (GetArray(cur, end, p, 2))
+      return ChSharedPtr<ChFunction>(new ChFunction_Ramp(p[0], p[1]));
+    break;
+  case CKPT_FUNCTION_SINE:
+    if (GetArray(cur, end, p, 3))
+      return ChSharedPtr<ChFunction>(new ChFunction_Sine(p[0], p[1], p[2]));
+    break;
+  }
+
+  return ChSharedPtr<ChFunction>();
+}
+
+// Add contact and asset geometry of the given type to a body.
+// Return false if the shape type or its data is not valid.
+static bool AddShapeGeometry(ChBody*               body,
+                             int                   type,
+                             const double*         p,
+                             size_t                n,
+                             const ChVector<>&     pos,
+                             const ChQuaternion<>& rot)
+{
+  switch (type) {
+  case collision::SPHERE:
+    if (n != 1) return false;
+    AddSphereGeometry(body, p[0], pos, rot);
+    break;
+  case collision::ELLIPSOID:
+    if (n != 3) return false;
+    AddEllipsoidGeometry(body, ChVector<>(p[0], p[1], p[2]), pos, rot);
+    break;
+  case collision::BOX:
+    if (n != 3) return false;
+    AddBoxGeometry(body, ChVector<>(p[0], p[1], p[2]), pos, rot);
+    break;
+  case collision::CAPSULE:
+    if (n != 2) return false;
+    AddCapsuleGeometry(body, p[0], p[1], pos, rot);
+    break;
+  case collision::CYLINDER:
+    if (n != 2) return false;
+    AddCylinderGeometry(body, p[0], p[1], pos, rot);
+    break;
+  case collision::CONE:
+    if (n != 2) return false;
+    AddConeGeometry(body, p[0], p[1], pos, rot);
+    break;
+  case collision::ROUNDEDBOX:
+    if (n != 4) return false;
+    AddRoundedBoxGeometry(body, ChVector<>(p[0], p[1], p[2]), p[3], pos, rot);
+    break;
+  case collision::ROUNDEDCYL:
+    if (n != 3) return false;
+    AddRoundedCylinderGeometry(body, p[0], p[1], p[2], pos, rot);
+    break;
+  default:
+    return false;
+  }
+
+  return true;
+}
+
+static ChBody* GetLinkBody(ChBodyFrame* body)
+{
+  return dynamic_cast<ChBody*>(body);
+}
+
+// -----------------------------------------------------------------------------
+// WriteCheckpointBinary
+//
+// Create a binary file with a complete checkpoint of the system. Visual assets
+// are resolved through an output plan; the collision model of each body is
+// assumed to match its visual shapes (as for the ChBodyEasy* bodies and the
+// Add*Geometry functions).
+// Cylinders must have their axis along the Y direction of the asset frame.
+// The checkpoint is refused (no file is written) if the system holds state
+// that cannot be restored exactly: solver warm starting (the multipliers from
+// the previous step are not saved) and motors whose imposed rotation is
+// integrated internally (all ChLinkEngine modes other than rotation and torque,
+// e.g. speed mode).
+// -----------------------------------------------------------------------------
+static bool IsCheckpointEngineMode(int eng_mode)
+{
+  return eng_mode == ChLinkEngine::ENG_MODE_ROTATION || eng_mode == ChLinkEngine::ENG_MODE_TORQUE;
+}
+
+bool WriteCheckpointBinary(ChSystem*          system,
+                           const std::string& filename)
+{
+  if (system->GetIterLCPwarmStarting())
+    return false;
+
+  std::vector<char> buffer;
+
+  // Header
+  PutArray(buffer, CHECKPOINT_BINARY_MAGIC, 4);
+  PutValue(buffer, CHECKPOINT_BINARY_VERSION);
+
+  // System settings
+  PutValue(buffer, system->GetChTime());
+  PutValue(buffer, system->GetStep());
+  PutValue(buffer, system->GetTol());
+  PutValue(buffer, system->GetTolForce());
+  PutValue(buffer, system->GetMaxPenetrationRecoverySpeed());
+  PutValue(buffer, system->GetMinBounceSpeed());
+  PutValue(buffer, system->GetIterLCPomega());
+  PutValue(buffer, system->GetIterLCPsharpnessLambda());
+  PutVector(buffer, system->Get_G_acc());
+  PutValue(buffer, (int32_t) system->GetLcpSolverType());
+  PutValue(buffer, (int32_t) system->GetIntegrationType());
+  PutValue(buffer, (int32_t) system->GetIterLCPmaxItersSpeed());
+  PutValue(buffer, (int32_t) system->GetIterLCPmaxItersStab());
+  PutValue(buffer, (int32_t) system->GetMaxiter());
+  PutValue(buffer, (uint8_t) system->GetIterLCPwarmStarting());
+
+  // Bodies (the visual assets are resolved once, through an output plan)
+  ShapesPlan plan;
+  BuildShapesPlan(system, plan, ALL_BODIES);
+
+  std::map<ChBody*, uint32_t> body_index;
+
+  PutValue(buffer, (uint32_t) plan.GetNumBodies());
+
+  for (size_t ib = 0; ib < plan.GetNumBodies(); ib++)
+  {
+    ChBody* body = plan.bodies[ib];
+    body_index[body] = (uint32_t) ib;
+
+    int btype = (body->GetContactMethod() == ChBody::DVI) ? 0 : 1;
+
+    PutValue(buffer, (int32_t) btype);
+    PutValue(buffer, (int32_t) body->GetIdentifier());
+    PutValue(buffer, (uint8_t) body->GetBodyFixed());
+    PutValue(buffer, (uint8_t) body->GetCollide());
+
+    PutValue(buffer, body->GetMass());
+    PutVector(buffer, body->GetInertiaXX());
+    PutVector(buffer, body->GetInertiaXY());
+
+    PutVector(buffer, body->GetPos());
+    PutQuaternion(buffer, body->GetRot());
+    PutVector(buffer, body->GetPos_dt());
+    PutQuaternion(buffer, body->GetRot_dt());
+    PutVector(buffer, body->GetPos_dtdt());
+    PutQuaternion(buffer, body->GetRot_dtdt());
+
+    // The shapes in the plan are relative to the body reference frame, which
+    // for a ChBodyAuxRef is not its centroidal frame.
+    ChBodyAuxRef* auxref = dynamic_cast<ChBodyAuxRef*>(body);
+    PutValue(buffer, (uint8_t) (auxref != NULL));
+    if (auxref) {
+      PutCoordsys(buffer, auxref->GetFrame_REF_to_abs().GetCoord());
+      PutCoordsys(buffer, auxref->GetFrame_COG_to_REF().GetCoord());
+    }
+
+    if (btype == 0) {
+      ChSharedPtr<ChMaterialSurface> mat = body->GetMaterialSurface();
+      double data[11] = { mat->static_friction, mat->sliding_friction, mat->rolling_friction, mat->spinning_friction,
+                          mat->restitution, mat->cohesion, mat->dampingf,
+                          mat->compliance, mat->complianceT, mat->complianceRoll, mat->complianceSpin };
+      PutArray(buffer, data, 11);
+    } else {
+      ChSharedPtr<ChMaterialSurfaceDEM> mat = body->GetMaterialSurfaceDEM();
+      double data[6] = { mat->young_modulus, mat->poisson_ratio,
+                         mat->static_friction, mat->sliding_friction,
+                         mat->restitution, mat->cohesion };
+      PutArray(buffer, data, 6);
+    }
+
+    collision::ChCollisionModel* model = body->GetCollisionModel();
+    uint16_t mask = 0;
+    for (int f = 0; f < CHECKPOINT_NUM_FAMILIES; f++) {
+      if (model->GetFamilyMaskDoesCollisionWithFamily(f))
+        mask |= (uint16_t) (1 << f);
+    }
+    PutValue(buffer, (int32_t) model->GetFamily());
+    PutValue(buffer, mask);
+    PutValue(buffer, (double) model->GetEnvelope());
+    PutValue(buffer, (double) model->GetSafeMargin());
+
+    // Color asset, if any.
+    ChSharedPtr<ChColorAsset> color_asset;
+    std::vector<ChSharedPtr<ChAsset> >::iterator iasset = body->GetAssets().begin();
+    for (; iasset != body->GetAssets().end(); ++iasset)
     {
-      csv << type << link->GetEndPoint1Abs() << link->GetEndPoint2Abs() << std::endl;
-      l_count++;
+      if (ChSharedPtr<ChColorAsset> casset = (*iasset).DynamicCastTo<ChColorAsset>())
+        color_asset = casset;
+    }
+    float color[3] = { 0, 0, 0 };
+    if (!color_asset.IsNull()) {
+      color[0] = color_asset->GetColor().R;
+      color[1] = color_asset->GetColor().G;
+      color[2] = color_asset->GetColor().B;
     }
-    else if (ChLinkEngine* link = dynamic_cast<ChLinkEngine*>(*ilink))
+    PutValue(buffer, (uint8_t) !color_asset.IsNull());
+    PutArray(buffer, color, 3);
+
+    // Shapes. All visual assets must be supported.
+    unsigned int begin = plan.body_asset_start[ib];
+    unsigned int end = plan.body_asset_start[ib + 1];
+    if (end - begin != plan.body_num_visual[ib])
+      return false;
+
+    PutValue(buffer, (uint32_t) (end - begin));
+
+    for (unsigned int i = begin; i < end; i++)
     {
-      chrono::ChFrame<> frA_abs = *(link->GetMarker1()) >> *(link->GetBody1());
-      chrono::ChFrame<> frB_abs = *(link->GetMarker2()) >> *(link->GetBody2());
+      const double* params = plan.asset_params.data() + plan.asset_params_start[i];
+      ChVector<>    pos = plan.asset_pos[i];
 
-      csv << type << frA_abs.GetPos() << frA_abs.GetA().Get_A_Zaxis() << std::endl;
-      l_count++;
+      switch (plan.asset_type[i]) {
+      case collision::TRIANGLEMESH:
+        return false;
+      case collision::CYLINDER:
+        {
+          // Convert to radius and half-length, about the cylinder center.
+          ChVector<> p1(params[1], params[2], params[3]);
+          ChVector<> p2(params[4], params[5], params[6]);
+          double     cyl[2] = { params[0], (p1 - p2).Length() / 2 };
+
+          pos += plan.asset_rot[i].Rotate((p1 + p2) / 2);
+
+          PutVector(buffer, pos);
+          PutQuaternion(buffer, plan.asset_rot[i]);
+          PutValue(buffer, (int32_t) collision::CYLINDER);
+          PutValue(buffer, (uint32_t) 2);
+          PutArray(buffer, cyl, 2);
+        }
+        break;
+      default:
+        PutVector(buffer, pos);
+        PutQuaternion(buffer, plan.asset_rot[i]);
+        PutValue(buffer, (int32_t) plan.asset_type[i]);
+        PutValue(buffer, (uint32_t) plan.asset_num_params[i]);
+        PutArray(buffer, params, plan.asset_num_params[i]);
+        break;
+      }
     }
   }
 
-  // Write the output file, including a first line with number of bodies, visual
-  // assets, and links.
-  std::stringstream header;
-  header << b_count << delim << a_count << delim << l_count << delim << std::endl;
+  // Links
+  PutValue(buffer, (uint32_t) system->Get_linklist()->size());
+
+  std::vector<ChLink*>::iterator ilink = system->Get_linklist()->begin();
+  for (; ilink != system->Get_linklist()->end(); ++ilink)
+  {
+    ChLink* link = *ilink;
+
+    int32_t kind;
+    if (dynamic_cast<ChLinkEngine*>(link))
+      kind = CKPT_LINK_ENGINE;
+    else if (dynamic_cast<ChLinkLinActuator*>(link))
+      kind = CKPT_LINK_LINACTUATOR;
+    else if (dynamic_cast<ChLinkLockRevolute*>(link))
+      kind = CKPT_LINK_REVOLUTE;
+    else if (dynamic_cast<ChLinkLockSpherical*>(link))
+      kind = CKPT_LINK_SPHERICAL;
+    else if (dynamic_cast<ChLinkLockPrismatic*>(link))
+      kind = CKPT_LINK_PRISMATIC;
+    else if (dynamic_cast<ChLinkLockLock*>(link))
+      kind = CKPT_LINK_LOCK;
+    else if (dynamic_cast<ChLinkDistance*>(link))
+      kind = CKPT_LINK_DISTANCE;
+    else
+      return false;
+
+    ChBody* body1 = GetLinkBody(link->GetBody1());
+    ChBody* body2 = GetLinkBody(link->GetBody2());
+    if (!body1 || !body2 || !body_index.count(body1) || !body_index.count(body2))
+      return false;
+
+    PutValue(buffer, kind);
+    PutValue(buffer, body_index[body1]);
+    PutValue(buffer, body_index[body2]);
+
+    if (kind == CKPT_LINK_DISTANCE) {
+      ChLinkDistance* dlink = static_cast<ChLinkDistance*>(link);
+      PutVector(buffer, dlink->GetEndPoint1Rel());
+      PutVector(buffer, dlink->GetEndPoint2Rel());
+      PutValue(buffer, dlink->GetImposedDistance());
+      continue;
+    }
+
+    // All other supported links have markers.
+    ChLinkMarkers* mlink = static_cast<ChLinkMarkers*>(link);
+    PutCoordsys(buffer, mlink->GetMarker1()->GetCoord());
+    PutCoordsys(buffer, mlink->GetMarker2()->GetCoord());
+
+    if (kind == CKPT_LINK_ENGINE) {
+      ChLinkEngine* engine = static_cast<ChLinkEngine*>(link);
+      if (!IsCheckpointEngineMode(engine->Get_eng_mode()))
+        return false;
+      PutValue(buffer, (int32_t) engine->Get_eng_mode());
+      PutValue(buffer, (int32_t) engine->Get_shaft_mode());
+      if (!PutFunction(buffer, engine->Get_rot_funct()) ||
+          !PutFunction(buffer, engine->Get_spe_funct()) ||
+          !PutFunction(buffer, engine->Get_tor_funct()))
+        return false;
+    } else if (kind == CKPT_LINK_LINACTUATOR) {
+      ChLinkLinActuator* actuator = static_cast<ChLinkLinActuator*>(link);
+      PutValue(buffer, actuator->Get_lin_offset());
+      if (!PutFunction(buffer, actuator->Get_dist_funct()))
+        return false;
+    }
+  }
 
-  csv.write_to_file(filename, header.str());
+  std::ofstream ofile(filename.c_str(), std::ios::binary);
+  if (!ofile.is_open())
+    return false;
+  ofile.write(buffer.data(), buffer.size());
+
+  return ofile.good();
+}
+
+// -----------------------------------------------------------------------------
+// ReadCheckpointBinary
+//
+// Restore a checkpoint created with WriteCheckpointBinary. The whole file is
+// parsed first, into bodies and links that are not yet part of the system; the
+// system is modified only once the checkpoint is known to be valid. Bodies and
+// links are then added to the system in their original order. Bodies with an
+// auxiliary reference frame are restored as ChBodyAuxRef, with their shapes
+// relative to that frame.
+// -----------------------------------------------------------------------------
+
+// A body read from a checkpoint, with the collision family settings that can
+// only be applied once it is part of the system.
+struct CheckpointBody {
+  ChSharedPtr<ChBody> body;
+  int32_t             family;
+  uint16_t            mask;
+};
+
+static bool ReadCheckpointBody(const char*&                  cur,
+                               const char*                   end,
+                               std::vector<CheckpointBody>&  bodies)
+{
+  int32_t btype, bid;
+  uint8_t bfixed, bcollide;
+  double  mass;
+  ChVector<>     inertiaXX, inertiaXY, bpos, bpos_dt, bpos_dtdt;
+  ChQuaternion<> brot, brot_dt, brot_dtdt;
+
+  if (!GetValue(cur, end, btype) || !GetValue(cur, end, bid) ||
+      !GetValue(cur, end, bfixed) || !GetValue(cur, end, bcollide) ||
+      !GetValue(cur, end, mass) || !GetVector(cur, end, inertiaXX) || !GetVector(cur, end, inertiaXY) ||
+      !GetVector(cur, end, bpos) || !GetQuaternion(cur, end, brot) ||
+      !GetVector(cur, end, bpos_dt) || !GetQuaternion(cur, end, brot_dt) ||
+      !GetVector(cur, end, bpos_dtdt) || !GetQuaternion(cur, end, brot_dtdt))
+    return false;
+
+  uint8_t      bauxref;
+  ChCoordsys<> ref_to_abs, cog_to_ref;
+  if (!GetValue(cur, end, bauxref))
+    return false;
+  if (bauxref && (!GetCoordsys(cur, end, ref_to_abs) || !GetCoordsys(cur, end, cog_to_ref)))
+    return false;
+
+  // Create a body of the appropriate type and apply material properties
+  ChBody::ContactMethod contact_method = (btype == 0) ? ChBody::DVI : ChBody::DEM;
+  ChSharedPtr<ChBody> body;
+  if (bauxref)
+    body = ChSharedPtr<ChBody>(new ChBodyAuxRef(contact_method));
+  else
+    body = ChSharedPtr<ChBody>(new ChBody(contact_method));
+
+  std::vector<double> m;
+  if (btype == 0) {
+    if (!GetArray(cur, end, m, 11))
+      return false;
+    ChSharedPtr<ChMaterialSurface> mat = body->GetMaterialSurface();
+    mat->static_friction = m[0];  mat->sliding_friction = m[1];
+    mat->rolling_friction = m[2]; mat->spinning_friction = m[3];
+    mat->restitution = m[4];      mat->cohesion = m[5];        mat->dampingf = m[6];
+    mat->compliance = m[7];       mat->complianceT = m[8];
+    mat->complianceRoll = m[9];   mat->complianceSpin = m[10];
+  } else {
+    if (!GetArray(cur, end, m, 6))
+      return false;
+    ChSharedPtr<ChMaterialSurfaceDEM> mat = body->GetMaterialSurfaceDEM();
+    mat->young_modulus = m[0];    mat->poisson_ratio = m[1];
+    mat->static_friction = m[2];  mat->sliding_friction = m[3];
+    mat->restitution = m[4];      mat->cohesion = m[5];
+  }
+
+  // Set body properties and state
+  body->SetIdentifier(bid);
+  body->SetBodyFixed(bfixed != 0);
+  body->SetCollide(bcollide != 0);
+
+  body->SetMass(mass);
+  body->SetInertiaXX(inertiaXX);
+  body->SetInertiaXY(inertiaXY);
+
+  if (bauxref) {
+    // Place the centroid relative to the reference first, then the reference,
+    // so that the centroidal frame and the cached reference frame agree.
+    ChBodyAuxRef* auxref = static_cast<ChBodyAuxRef*>(body.get_ptr());
+    auxref->SetFrame_COG_to_REF(ChFrame<>(cog_to_ref));
+    auxref->SetFrame_REF_to_abs(ChFrame<>(ref_to_abs));
+  } else {
+    body->SetPos(bpos);
+    body->SetRot(brot);
+  }
+  body->SetPos_dt(bpos_dt);
+  body->SetRot_dt(brot_dt);
+  body->SetPos_dtdt(bpos_dtdt);
+  body->SetRot_dtdt(brot_dtdt);
+
+  // Collision settings and color
+  int32_t  family;
+  uint16_t mask;
+  double   envelope, margin;
+  uint8_t  has_color;
+  std::vector<float> color;
+  if (!GetValue(cur, end, family) || !GetValue(cur, end, mask) ||
+      !GetValue(cur, end, envelope) || !GetValue(cur, end, margin) ||
+      !GetValue(cur, end, has_color) || !GetArray(cur, end, color, 3))
+    return false;
+
+  if (has_color) {
+    ChSharedPtr<ChColorAsset> color_asset(new ChColorAsset);
+    color_asset->SetColor(ChColor(color[0], color[1], color[2]));
+    body->AddAsset(color_asset);
+  }
+
+  // Shapes
+  uint32_t num_shapes;
+  if (!GetValue(cur, end, num_shapes))
+    return false;
+
+  collision::ChCollisionModel* model = body->GetCollisionModel();
+  model->ClearModel();
+  model->SetEnvelope(envelope);
+  model->SetSafeMargin(margin);
+
+  for (uint32_t j = 0; j < num_shapes; j++) {
+    ChVector<>     apos;
+    ChQuaternion<> arot;
+    int32_t        atype;
+    uint32_t       nparams;
+    std::vector<double> params;
+
+    if (!GetVector(cur, end, apos) || !GetQuaternion(cur, end, arot) ||
+        !GetValue(cur, end, atype) || !GetValue(cur, end, nparams) ||
+        !GetArray(cur, end, params, nparams))
+      return false;
+
+    if (!AddShapeGeometry(body.get_ptr(), atype, params.data(), nparams, apos, arot))
+      return false;
+  }
+
+  model->BuildModel();
+
+  if (family < 0 || family >= CHECKPOINT_NUM_FAMILIES)
+    return false;
+
+  CheckpointBody cbody;
+  cbody.body = body;
+  cbody.family = family;
+  cbody.mask = mask;
+  bodies.push_back(cbody);
+
+  return true;
+}
+
+static bool ReadCheckpointLink(const char*&                       cur,
+                               const char*                        end,
+                               const std::vector<CheckpointBody>& bodies,
+                               std::vector<ChSharedPtr<ChLink> >& links)
+{
+  int32_t  kind;
+  uint32_t b1, b2;
+  if (!GetValue(cur, end, kind) || !GetValue(cur, end, b1) || !GetValue(cur, end, b2))
+    return false;
+  if (b1 >= bodies.size() || b2 >= bodies.size())
+    return false;
+
+  ChSharedPtr<ChBody> body1 = bodies[b1].body;
+  ChSharedPtr<ChBody> body2 = bodies[b2].body;
+
+  if (kind == CKPT_LINK_DISTANCE) {
+    ChVector<> p1, p2;
+    double     distance;
+    if (!GetVector(cur, end, p1) || !GetVector(cur, end, p2) || !GetValue(cur, end, distance))
+      return false;
+
+    ChSharedPtr<ChLinkDistance> link(new ChLinkDistance);
+    link->Initialize(body1, body2, true, p1, p2, false, distance);
+    links.push_back(link);
+    return true;
+  }
+
+  ChCoordsys<> csys1, csys2;
+  if (!GetCoordsys(cur, end, csys1) || !GetCoordsys(cur, end, csys2))
+    return false;
+
+  switch (kind) {
+  case CKPT_LINK_LOCK:
+    {
+      ChSharedPtr<ChLinkLockLock> link(new ChLinkLockLock);
+      link->Initialize(body1, body2, true, csys1, csys2);
+      links.push_back(link);
+    }
+    break;
+  case CKPT_LINK_REVOLUTE:
+    {
+      ChSharedPtr<ChLinkLockRevolute> link(new ChLinkLockRevolute);
+      link->Initialize(body1, body2, true, csys1, csys2);
+      links.push_back(link);
+    }
+    break;
+  case CKPT_LINK_SPHERICAL:
+    {
+      ChSharedPtr<ChLinkLockSpherical> link(new ChLinkLockSpherical);
+      link->Initialize(body1, body2, true, csys1, csys2);
+      links.push_back(link);
+    }
+    break;
+  case CKPT_LINK_PRISMATIC:
+    {
+      ChSharedPtr<ChLinkLockPrismatic> link(new ChLinkLockPrismatic);
+      link->Initialize(body1, body2, true, csys1, csys2);
+      links.push_back(link);
+    }
+    break;
+  case CKPT_LINK_ENGINE:
+    {
+      int32_t eng_mode, shaft_mode;
+      if (!GetValue(cur, end, eng_mode) || !GetValue(cur, end, shaft_mode))
+        return false;
+      if (!IsCheckpointEngineMode(eng_mode))
+        return false;
+      ChSharedPtr<ChFunction> rot_funct = GetFunction(cur, end);
+      ChSharedPtr<ChFunction> spe_funct = GetFunction(cur, end);
+      ChSharedPtr<ChFunction> tor_funct = GetFunction(cur, end);
+      if (rot_funct.IsNull() || spe_funct.IsNull() || tor_funct.IsNull())
+        return false;
+
+      ChSharedPtr<ChLinkEngine> link(new ChLinkEngine);
+      link->Initialize(body1, body2, true, csys1, csys2);
+      link->Set_shaft_mode(shaft_mode);
+      link->Set_eng_mode(eng_mode);
+      link->Set_rot_funct(rot_funct);
+      link->Set_spe_funct(spe_funct);
+      link->Set_tor_funct(tor_funct);
+      links.push_back(link);
+    }
+    break;
+  case CKPT_LINK_LINACTUATOR:
+    {
+      double offset;
+      if (!GetValue(cur, end, offset))
+        return false;
+      ChSharedPtr<ChFunction> dist_funct = GetFunction(cur, end);
+      if (dist_funct.IsNull())
+        return false;
+
+      ChSharedPtr<ChLinkLinActuator> link(new ChLinkLinActuator);
+      link->Initialize(body1, body2, true, csys1, csys2);
+      link->Set_lin_offset(offset);
+      link->Set_dist_funct(dist_funct);
+      links.push_back(link);
+    }
+    break;
+  default:
+    return false;
+  }
+
+  return true;
+}
+
+bool ReadCheckpointBinary(ChSystem*          system,
+                          const std::string& filename)
+{
+  std::ifstream ifile(filename.c_str(), std::ios::binary);
+  if (!ifile.is_open())
+    return false;
+
+  std::vector<char> buffer((std::istreambuf_iterator<char>(ifile)),
+                           std::istreambuf_iterator<char>());
+
+  const char* cur = buffer.data();
+  const char* end = buffer.data() + buffer.size();
+
+  // Header
+  if (buffer.size() < 4 || std::memcmp(cur, CHECKPOINT_BINARY_MAGIC, 4) != 0)
+    return false;
+  cur += 4;
+
+  uint32_t version;
+  if (!GetValue(cur, end, version) || version != CHECKPOINT_BINARY_VERSION)
+    return false;
+
+  // System settings
+  std::vector<double>  dvals;
+  std::vector<int32_t> ivals;
+  uint8_t              warm_start;
+  if (!GetArray(cur, end, dvals, 11) || !GetArray(cur, end, ivals, 5) || !GetValue(cur, end, warm_start))
+    return false;
+
+  // Bodies
+  uint32_t num_bodies;
+  if (!GetValue(cur, end, num_bodies))
+    return false;
+
+  std::vector<CheckpointBody> bodies;
+  for (uint32_t i = 0; i < num_bodies; i++) {
+    if (!ReadCheckpointBody(cur, end, bodies))
+      return false;
+  }
+
+  // Links
+  uint32_t num_links;
+  if (!GetValue(cur, end, num_links))
+    return false;
+
+  std::vector<ChSharedPtr<ChLink> > links;
+  for (uint32_t i = 0; i < num_links; i++) {
+    if (!ReadCheckpointLink(cur, end, bodies, links))
+      return false;
+  }
+
+  if (cur != end)
+    return false;
+
+  // The checkpoint is valid: apply it to the system.
+  system->SetChTime(dvals[0]);
+  system->SetStep(dvals[1]);
+  system->SetTol(dvals[2]);
+  system->SetTolForce(dvals[3]);
+  system->SetMaxPenetrationRecoverySpeed(dvals[4]);
+  system->SetMinBounceSpeed(dvals[5]);
+  system->SetIterLCPomega(dvals[6]);
+  system->SetIterLCPsharpnessLambda(dvals[7]);
+  system->Set_G_acc(ChVector<>(dvals[8], dvals[9], dvals[10]));
+  system->SetLcpSolverType((ChSystem::eCh_lcpSolver) ivals[0]);
+  system->SetIntegrationType((ChSystem::eCh_integrationType) ivals[1]);
+  system->SetIterLCPmaxItersSpeed(ivals[2]);
+  system->SetIterLCPmaxItersStab(ivals[3]);
+  system->SetMaxiter(ivals[4]);
+  system->SetIterLCPwarmStarting(warm_start != 0);
+
+  // The collision family can only be set once the collision model is part of
+  // the system.
+  for (size_t i = 0; i < bodies.size(); i++) {
+    system->AddBody(bodies[i].body);
+
+    collision::ChCollisionModel* model = bodies[i].body->GetCollisionModel();
+    model->SetFamily(bodies[i].family);
+    for (int f = 0; f < CHECKPOINT_NUM_FAMILIES; f++) {
+      if (bodies[i].mask & (1 << f))
+        model->SetFamilyMaskDoCollisionWithFamily(f);
+      else
+        model->SetFamilyMaskNoCollisionWithFamily(f);
+    }
+  }
+
+  for (size_t i = 0; i < links.size(); i++)
+    system->AddLink(links[i]);
+
+  return true;
 }
 
 
@@ -547,7 +2154,88 @@ void WriteShapesPovray(ChSystem*          system,
 //
 // Write the triangular mesh from the specified OBJ file as a macro in a PovRay
 // include file.
+// The first line of the include file records a key computed from the contents
+// of the OBJ file and from all conversion arguments. If an include file with
+// the same key already exists, the mesh is not converted again. Otherwise, the
+// vertex and face lists of large meshes are formatted in parallel and the file
+// is written with a single call.
 // -----------------------------------------------------------------------------
+static const size_t MESH_CHUNK_SIZE = 16384;
+
+static uint64_t HashBytes(uint64_t hash, const void* data, size_t size)
+{
+  // 64-bit FNV-1a
+  const unsigned char* p = (const unsigned char*) data;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= p[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+static void FormatMeshVertices(const std::vector<ChVector<> >& vertices,
+                               size_t                          begin,
+                               size_t                          end,
+                               std::string*                    out)
+{
+  char buf[128];
+  out->reserve(out->size() + 40 * (end - begin));
+  for (size_t i = begin; i < end; i++) {
+    const ChVector<>& v = vertices[i];
+    int n = std::snprintf(buf, sizeof(buf), ",\n<%g, %g, %g>", v.x, v.z, v.y);
+    out->append(buf, n);
+  }
+}
+
+static void FormatMeshFaces(const std::vector<ChVector<int> >& faces,
+                            size_t                             begin,
+                            size_t                             end,
+                            std::string*                       out)
+{
+  char buf[128];
+  out->reserve(out->size() + 24 * (end - begin));
+  for (size_t i = begin; i < end; i++) {
+    const ChVector<int>& f = faces[i];
+    int n = std::snprintf(buf, sizeof(buf), ",\n<%d, %d, %d>", f.x, f.y, f.z);
+    out->append(buf, n);
+  }
+}
+
+// Format the given items in chunks, on as many threads as useful, and append
+// the result (in order) to the output string.
+template <typename T>
+static void FormatMeshChunks(const std::vector<T>& items,
+                             void (*format)(const std::vector<T>&, size_t, size_t, std::string*),
+                             std::string& out)
+{
+  size_t num_items = items.size();
+  size_t num_chunks = (num_items + MESH_CHUNK_SIZE - 1) / MESH_CHUNK_SIZE;
+  size_t num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  num_chunks = std::min(num_chunks, num_threads);
+
+  if (num_chunks <= 1) {
+    format(items, 0, num_items, &out);
+    return;
+  }
+
+  size_t chunk_size = (num_items + num_chunks - 1) / num_chunks;
+  std::vector<std::string> parts(num_chunks);
+  std::vector<std::thread> threads;
+
+  for (size_t c = 1; c < num_chunks; c++) {
+    size_t begin = std::min(c * chunk_size, num_items);
+    size_t end = std::min(begin + chunk_size, num_items);
+    threads.push_back(std::thread(format, std::cref(items), begin, end, &parts[c]));
+  }
+  format(items, 0, std::min(chunk_size, num_items), &parts[0]);
+
+  for (size_t c = 0; c < threads.size(); c++)
+    threads[c].join();
+
+  for (size_t c = 0; c < num_chunks; c++)
+    out.append(parts[c]);
+}
+
 void WriteMeshPovray(const std::string&    obj_filename,
                      const std::string&    mesh_name,
                      const std::string&    out_dir,
@@ -555,49 +2243,79 @@ void WriteMeshPovray(const std::string&    obj_filename,
                      const ChVector<>&     pos,
                      const ChQuaternion<>& rot)
 {
+  std::string pov_filename = out_dir + "/" + mesh_name + ".inc";
+
+  // Calculate the cache key from the OBJ file contents and the conversion
+  // arguments, and skip the conversion if the include file is up to date.
+  char key_line[64] = "";
+  ChMappedFile obj_file;
+  if (obj_file.Open(obj_filename)) {
+    uint64_t hash = 14695981039346656037ULL;
+    hash = HashBytes(hash, obj_file.GetData(), obj_file.GetSize());
+    hash = HashBytes(hash, mesh_name.data(), mesh_name.size());
+    float  c[3] = {col.R, col.G, col.B};
+    double x[7] = {pos.x, pos.y, pos.z, rot.e0, rot.e1, rot.e2, rot.e3};
+    hash = HashBytes(hash, c, sizeof(c));
+    hash = HashBytes(hash, x, sizeof(x));
+    obj_file.Close();
+
+    std::snprintf(key_line, sizeof(key_line), "// mesh key %016llx", (unsigned long long) hash);
+
+    std::ifstream ifile(pov_filename.c_str());
+    std::string line;
+    if (ifile && std::getline(ifile, line) && line == key_line)
+      return;
+  }
+
   // Read trimesh from OBJ file
   geometry::ChTriangleMeshConnected trimesh;
-  trimesh.LoadWavefrontMesh(obj_filename, false, false);
+  if (!LoadObjMesh(obj_filename, trimesh))
+    trimesh.LoadWavefrontMesh(obj_filename, false, false);
 
   // Transform vertices.
   for (int i = 0; i < trimesh.m_vertices.size(); i++)
     trimesh.m_vertices[i] = pos + rot.Rotate(trimesh.m_vertices[i]);
 
-  // Open output file.
-  std::string pov_filename = out_dir + "/" + mesh_name + ".inc";
-  std::ofstream  ofile(pov_filename.c_str());
+  // Format the include file in memory.
+  std::string text;
+  std::stringstream header;
 
-  ofile << "#declare " << mesh_name << "_mesh = mesh2 {" << std::endl;
+  if (key_line[0])
+    header << key_line << "\n";
+  header << "#declare " << mesh_name << "_mesh = mesh2 {\n";
+  header << "vertex_vectors {\n";
+  header << trimesh.m_vertices.size();
+  text.append(header.str());
 
   // Write vertices.
-  ofile << "vertex_vectors {" << std::endl;
-  ofile << trimesh.m_vertices.size();
-  for (int i = 0; i < trimesh.m_vertices.size(); i++) {
-    ChVector<> v = trimesh.m_vertices[i];
-    ofile << ",\n<" << v.x << ", " << v.z << ", " << v.y << ">";
-  }
-  ofile << "\n}" << std::endl;
+  FormatMeshChunks(trimesh.m_vertices, FormatMeshVertices, text);
+  text.append("\n}\n");
 
   // Write face connectivity.
-  ofile << "face_indices {" << std::endl;
-  ofile << trimesh.m_face_v_indices.size();
-  for (int i = 0; i < trimesh.m_face_v_indices.size(); i++) {
-    ChVector<int> face = trimesh.m_face_v_indices[i];
-    ofile << ",\n<" << face.x << ", " << face.y << ", " << face.z << ">";
-  }
-  ofile << "\n}" << std::endl;
+  std::stringstream faces;
+  faces << "face_indices {\n";
+  faces << trimesh.m_face_v_indices.size();
+  text.append(faces.str());
+
+  FormatMeshChunks(trimesh.m_face_v_indices, FormatMeshFaces, text);
+  text.append("\n}\n");
 
-  ofile << "\n}" << std::endl;
+  text.append("\n}\n");
 
   // Write the object
-  ofile << "#declare " << mesh_name << " = object {" << std::endl;
-
-  ofile << "   " << mesh_name << "_mesh" << std::endl;
-  ofile << "   texture {" << std::endl;
-  ofile << "      pigment {color rgb<" << col.R << ", " << col.G << ", " << col.B << ">}" << std::endl;
-  ofile << "      finish  {phong 0.2  diffuse 0.6}" << std::endl;
-  ofile << "    }" << std::endl;
-  ofile << "}" << std::endl;
+  std::stringstream object;
+  object << "#declare " << mesh_name << " = object {\n";
+
+  object << "   " << mesh_name << "_mesh\n";
+  object << "   texture {\n";
+  object << "      pigment {color rgb<" << col.R << ", " << col.G << ", " << col.B << ">}\n";
+  object << "      finish  {phong 0.2  diffuse 0.6}\n";
+  object << "    }\n";
+  object << "}\n";
+  text.append(object.str());
+
+  std::ofstream ofile(pov_filename.c_str());
+  ofile.write(text.data(), text.size());
 }
 
 
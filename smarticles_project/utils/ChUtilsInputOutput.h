@@ -23,11 +23,13 @@
 #include <iostream>
 #include <sstream>
 #include <fstream>
+#include <vector>
 
 #include "physics/ChSystem.h"
 #include "assets/ChColor.h"
 
 #include "utils/ChApiUtils.h"
+#include "utils/ChUtilsFormat.h"
 #include "utils/ChUtilsCreators.h"
 
 
@@ -39,19 +41,26 @@ namespace utils {
 // CSV_writer
 //
 // Simple class to output to a Comma-Separated Values file.
+// By default, all output is accumulated in memory and written to disk with
+// write_to_file(). Alternatively, in streaming mode (see open() and close()),
+// the output file is opened up front and a fixed-size buffer is flushed to it
+// as it fills. In streaming mode, a region at the beginning of the file can be
+// reserved for a header which is only known once all data was written.
 // -----------------------------------------------------------------------------
 class CH_UTILS_API CSV_writer {
 public:
-  explicit CSV_writer(const std::string& delim = ",") : m_delim(delim) {}
+  explicit CSV_writer(const std::string& delim = ",")
+  : m_delim(delim), m_header_size(0), m_out(&m_ss) {}
 
-  CSV_writer(const CSV_writer& source) : m_delim(source.m_delim)
+  CSV_writer(const CSV_writer& source)
+  : m_delim(source.m_delim), m_header_size(0), m_out(&m_ss)
   {
     // Note that we do not copy the stream buffer (as then it would be shared!)
     m_ss.copyfmt(source.m_ss);          // copy all data
     m_ss.clear(source.m_ss.rdstate());  // copy the error state
   }
 
-  ~CSV_writer() {}
+  ~CSV_writer() { if (m_file.is_open()) close(); }
 
   void write_to_file(const std::string& filename,
                      const std::string& header = "")
@@ -62,48 +71,215 @@ public:
     ofile.close();
   }
 
+  // Switch to streaming mode: open the specified output file and write all
+  // subsequent data through a user-space buffer of the given size. The first
+  // 'header_size' bytes of the file are reserved for a header provided to
+  // close(). Any data already accumulated in memory is written first.
+  bool open(const std::string& filename,
+            size_t             header_size = 0,
+            size_t             buffer_size = 65536);
+
+  // Finish streaming output: back-patch the header (padded with blanks to the
+  // reserved size) and close the file. If the header does not fit in the
+  // reserved region, the file contents are shifted to make room for it.
+  bool close(const std::string& header = "");
+
+  bool is_streaming() const { return m_file.is_open(); }
+
   const std::string&  delim() const { return m_delim; }
-  std::ostringstream& stream() { return m_ss; }
+  std::ostream&       stream() { return *m_out; }
 
   template <typename T>
-  CSV_writer& operator<< (const T& t)                          { m_ss << t << m_delim; return *this; }
+  CSV_writer& operator<< (const T& t)                          { *m_out << t << m_delim; return *this; }
 
-  CSV_writer& operator<<(std::ostream& (*t)(std::ostream&))    { m_ss << t; return *this; }
-  CSV_writer& operator<<(std::ios& (*t)(std::ios&))            { m_ss << t; return *this; }
-  CSV_writer& operator<<(std::ios_base& (*t)(std::ios_base&))  { m_ss << t; return *this; }
+  // Floating point values are written in their shortest round-trip exact form
+  // (see FormatDouble), independent of the stream precision and locale.
+  CSV_writer& operator<<(double t)                             { return write(&t, 1); }
+  CSV_writer& operator<<(float t)                              { return write(&t, 1); }
+
+  // Write the given values, each followed by the delimiter.
+  CSV_writer& write(const double* vals, size_t n);
+  CSV_writer& write(const float* vals, size_t n);
+
+  CSV_writer& operator<<(std::ostream& (*t)(std::ostream&))
+  {
+    // Do not let std::endl flush the file after every line in streaming mode.
+    if (t == static_cast<std::ostream& (*)(std::ostream&)>(std::endl))
+      m_out->put('\n');
+    else
+      *m_out << t;
+    return *this;
+  }
+
+  CSV_writer& operator<<(std::ios& (*t)(std::ios&))            { *m_out << t; return *this; }
+  CSV_writer& operator<<(std::ios_base& (*t)(std::ios_base&))  { *m_out << t; return *this; }
 
 private:
-  std::string m_delim;
-  std::ostringstream m_ss;
+  std::string         m_delim;
+  std::ostringstream  m_ss;
+
+  std::ofstream       m_file;
+  std::string         m_filename;
+  std::vector<char>   m_buffer;
+  size_t              m_header_size;
+
+  std::ostream*       m_out;
 };
 
 inline CSV_writer& operator<< (CSV_writer& out, const ChVector<>& v)
 {
-  out << v.x << v.y << v.z;
-  return out;
+  double vals[3] = {v.x, v.y, v.z};
+  return out.write(vals, 3);
 }
 
 inline CSV_writer& operator<< (CSV_writer& out, const ChQuaternion<>& q)
 {
-  out << q.e0 << q.e1 << q.e2 << q.e3;
-  return out;
+  double vals[4] = {q.e0, q.e1, q.e2, q.e3};
+  return out.write(vals, 4);
 }
 
 inline CSV_writer& operator<< (CSV_writer& out, const ChColor& c)
 {
-  out << c.R << c.G << c.B;
-  return out;
+  float vals[3] = {c.R, c.G, c.B};
+  return out.write(vals, 3);
 }
 
 
+// -----------------------------------------------------------------------------
+// ShapesFilter
+//
+// Selection of the bodies processed when capturing an output frame. Fixed
+// bodies never move, so they can be output once, in a separate static scene
+// file, while every frame contains only the non-fixed bodies.
+// -----------------------------------------------------------------------------
+enum ShapesFilter {
+  ALL_BODIES,       // all bodies and links
+  FIXED_BODIES,     // fixed bodies only, no links (static scene)
+  MOVING_BODIES     // non-fixed bodies and all links
+};
+
+
+// -----------------------------------------------------------------------------
+// ShapesFrame
+//
+// Structure-of-arrays snapshot of the information output by WriteShapesPovray:
+// body poses, visual asset poses, colors and shape data, and link frames.
+// Shape and link data have a variable number of values; these counts are kept
+// per entry and the values themselves are packed, in order, in a single array.
+// Names of triangle mesh assets are kept separately, in asset order.
+// A frame containing only the moving bodies can refer to the static scene file
+// holding the fixed bodies.
+// -----------------------------------------------------------------------------
+struct CH_UTILS_API ShapesFrame {
+  // Name of the static scene file (empty if none)
+  std::string                 static_ref;
+
+  // Bodies (3 position and 4 rotation values per body)
+  std::vector<int>            body_id;
+  std::vector<unsigned char>  body_active;
+  std::vector<double>         body_pos;
+  std::vector<double>         body_rot;
+
+  // Visual assets (absolute pose, 3 color values per asset)
+  std::vector<int>            asset_body_id;
+  std::vector<unsigned char>  asset_active;
+  std::vector<double>         asset_pos;
+  std::vector<double>         asset_rot;
+  std::vector<float>          asset_color;
+  std::vector<int>            asset_type;
+  std::vector<unsigned int>   asset_num_params;
+  std::vector<double>         asset_params;
+  std::vector<std::string>    mesh_names;
+
+  // Links
+  std::vector<int>            link_type;
+  std::vector<unsigned int>   link_num_params;
+  std::vector<double>         link_params;
+
+  size_t GetNumBodies() const { return body_id.size(); }
+  size_t GetNumAssets() const { return asset_body_id.size(); }
+  size_t GetNumLinks() const  { return link_type.size(); }
+
+  // Empty all arrays, but keep their capacity (so that a frame object can be
+  // reused without further memory allocation).
+  void Clear();
+};
+
+
+// -----------------------------------------------------------------------------
+// ShapesPlan
+//
+// Output plan for the bodies, visual assets, and links of a system, built once
+// per topology change. For each supported visual asset, the plan caches the
+// resolved color, shape type, pose relative to its body, and geometry data, so
+// that capturing a frame only requires composing the current body poses with
+// these relative transforms. Links are classified once, so that no run-time
+// type checks are needed per frame.
+// The plan records the identity (address and identifier) and the fixed flag of
+// every body, and the identity of every link in the system. It is invalidated
+// when bodies or links are added, removed, or replaced, when a body is fixed or
+// released, or when visual assets are added to or removed from a body; it must
+// be rebuilt (with BuildShapesPlan) if asset properties are modified.
+// -----------------------------------------------------------------------------
+struct CH_UTILS_API ShapesPlan {
+  ShapesPlan() : system(0), filter(ALL_BODIES) {}
+
+  ChSystem*                   system;
+  ShapesFilter                filter;
+
+  // All bodies and links of the system when the plan was built (for validation)
+  std::vector<ChBody*>        sys_bodies;
+  std::vector<int>            sys_body_ids;
+  std::vector<bool>           sys_body_fixed;
+  std::vector<ChLink*>        sys_links;
+  std::vector<int>            sys_link_ids;
+
+  // Selected bodies, with the number of all their assets (for validation), the
+  // number of all their visual assets, and the range of their supported assets
+  // (body i owns the assets body_asset_start[i] to body_asset_start[i+1]-1).
+  std::vector<ChBody*>        bodies;
+  std::vector<unsigned int>   body_num_assets;
+  std::vector<unsigned int>   body_num_visual;
+  std::vector<unsigned int>   body_asset_start;
+
+  // Supported visual assets (pose relative to the body, 3 color values per
+  // asset, variable number of shape data values)
+  std::vector<unsigned int>   asset_body;
+  std::vector<ChVector<> >    asset_pos;
+  std::vector<ChQuaternion<> > asset_rot;
+  std::vector<float>          asset_color;
+  std::vector<int>            asset_type;
+  std::vector<unsigned int>   asset_num_params;
+  std::vector<double>         asset_params;
+  std::vector<unsigned int>   asset_params_start;
+  std::vector<std::string>    mesh_names;
+
+  // Supported links and the category of data output for each of them
+  std::vector<ChLink*>        links;
+  std::vector<int>            link_kind;
+
+  size_t GetNumBodies() const { return bodies.size(); }
+  size_t GetNumAssets() const { return asset_body.size(); }
+  size_t GetNumLinks() const  { return links.size(); }
+
+  // Return true if the plan was built for the specified system and filter and
+  // the topology of the system did not change since.
+  bool IsValid(ChSystem* sys, ShapesFilter flt) const;
+
+  // Empty all arrays, but keep their capacity.
+  void Clear();
+};
+
+
 // -----------------------------------------------------------------------------
 // Free function declarations
 // -----------------------------------------------------------------------------
 
 // Write to a CSV file pody position, orientation, and (optionally) linear and
 // angular velocity. Optionally, only active bodies are processed.
+// Return false if the file cannot be created or written.
 CH_UTILS_API
-void WriteBodies(ChSystem*          system,
+bool WriteBodies(ChSystem*          system,
                  const std::string& filename,
                  bool               active_only = false,
                  bool               dump_vel = false,
@@ -115,25 +291,141 @@ bool WriteCheckpoint(ChSystem*          system,
                      const std::string& filename);
 
 // Read a CSV file with a checkpoint...
+// The file is memory-mapped and parsed in a single pass. Bodies with identical
+// shapes share their collision shapes and visual assets.
 CH_UTILS_API
 void ReadCheckpoint(ChSystem*          system,
                     const std::string& filename);
 
+// Create a binary file with a complete checkpoint of the system: simulation
+// time, integrator and solver settings, all bodies (state, mass properties,
+// material, collision settings, color, and shapes), and all links (constraint
+// topology, marker frames, motor modes and motion functions).
+// Only systems whose state is fully captured are checkpointed, so that stepping
+// the restored system reproduces the original run. Return false (in which case
+// no file is created) if the system contains an unsupported visual asset, link,
+// or motion function type, uses solver warm starting, or contains a
+// ChLinkEngine in a mode other than rotation or torque (e.g. speed mode, whose
+// imposed rotation is integrated internally).
+CH_UTILS_API
+bool WriteCheckpointBinary(ChSystem*          system,
+                           const std::string& filename);
+
+// Restore, in the specified (empty) system, a checkpoint created with
+// WriteCheckpointBinary. The system settings are overwritten.
+// Bodies with an auxiliary reference frame are restored as ChBodyAuxRef.
+// Return false if the file cannot be opened or is not a valid checkpoint; the
+// file is validated completely before the system is modified, so in that case
+// the system is left unchanged.
+CH_UTILS_API
+bool ReadCheckpointBinary(ChSystem*          system,
+                          const std::string& filename);
+
 // Write CSV output file for PovRay.
 // Each line contains information about one visualization asset shape, as
 // follows:
 //    index, x, y, z, e0, e1, e2, e3, type, geometry
 // where 'geometry' depends on 'type' (an enum).
+// Return false if the file cannot be created or written.
 CH_UTILS_API
-void WriteShapesPovray(ChSystem*          system,
+bool WriteShapesPovray(ChSystem*          system,
                        const std::string& filename,
                        bool               body_info = true,
                        const std::string& delim = ",");
 
+// Write CSV output file for PovRay from a previously captured frame.
+CH_UTILS_API
+bool WriteShapesPovray(const ShapesFrame&  frame,
+                       const std::string&  filename,
+                       const std::string&  delim = ",");
+
+// Capture the current body, visual asset, and link information in the given
+// frame object (the same data that is output by WriteShapesPovray).
+CH_UTILS_API
+void CaptureShapes(ChSystem*    system,
+                   ShapesFrame& frame,
+                   bool         body_info = true,
+                   ShapesFilter filter = ALL_BODIES);
+
+// Build (or rebuild) the output plan for the bodies selected with the given
+// filter, their visual assets, and (unless only fixed bodies are selected) the
+// system links.
+CH_UTILS_API
+void BuildShapesPlan(ChSystem*    system,
+                     ShapesPlan&  plan,
+                     ShapesFilter filter = ALL_BODIES);
+
+// Rebuild the output plan only if it is not valid for the specified system and
+// filter. Return true if the plan was rebuilt.
+CH_UTILS_API
+bool UpdateShapesPlan(ChSystem*    system,
+                      ShapesPlan&  plan,
+                      ShapesFilter filter = ALL_BODIES);
+
+// Capture the current body, visual asset, and link information in the given
+// frame object, using a previously built output plan.
+CH_UTILS_API
+void CaptureShapes(const ShapesPlan& plan,
+                   ShapesFrame&      frame,
+                   bool              body_info = true);
+
+// Write CSV output file for PovRay with the static part of the scene, i.e. all
+// fixed bodies and their visual assets (no links). This file must be written
+// only once and is referenced by the frames written with
+// WriteMovingShapesPovray.
+CH_UTILS_API
+bool WriteStaticShapesPovray(ChSystem*          system,
+                             const std::string& filename,
+                             bool               body_info = true,
+                             const std::string& delim = ",");
+
+// Write CSV output file for PovRay with only the non-fixed bodies and all links.
+// The first line contains, after the number of bodies, visual assets, and
+// links, the (quoted) name of the static scene file.
+CH_UTILS_API
+bool WriteMovingShapesPovray(ChSystem*          system,
+                             const std::string& filename,
+                             const std::string& static_filename,
+                             bool               body_info = true,
+                             const std::string& delim = ",");
+
+// Write binary output file with the same content as WriteShapesPovray.
+// The file is versioned and little-endian. It contains a header with the
+// number of bodies, assets, and links, followed by packed blocks of body ids,
+// active flags, positions, rotations, colors, shape types and shape data.
+// Return false if the file cannot be created or written.
+CH_UTILS_API
+bool WriteShapesBinary(ChSystem*          system,
+                       const std::string& filename,
+                       bool               body_info = true);
+
+CH_UTILS_API
+bool WriteShapesBinary(const ShapesFrame& frame,
+                       const std::string& filename);
+
+// Read a binary output file created with WriteShapesBinary.
+// Return false if the file cannot be opened or is not a valid frame file.
+CH_UTILS_API
+bool ReadShapesBinary(const std::string& filename,
+                      ShapesFrame&       frame);
+
+// Append the binary representation of a frame to the given buffer.
+CH_UTILS_API
+void PackShapesBinary(const ShapesFrame& frame,
+                      std::vector<char>& buffer);
+
+// Extract a frame from its binary representation.
+// Return false if the buffer does not contain a valid frame.
+CH_UTILS_API
+bool UnpackShapesBinary(const char*  data,
+                        size_t       size,
+                        ShapesFrame& frame);
+
 // Write the triangular mesh from the specified OBJ file as a macro in a PovRay
 // include file. The output file will be "[out_dir]/[mesh_name].inc". The mesh
 // vertices will be tramsformed to the frame with specified offset and
-// orientation.
+// orientation. The include file is not rewritten if it was already created
+// from the same OBJ file contents and with the same arguments.
 CH_UTILS_API
 void WriteMeshPovray(const std::string&    obj_filename,
                      const std::string&    mesh_name,
@@ -0,0 +1,580 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Radu Serban
+// =============================================================================
+//
+// Read-only memory-mapped files and a scanner for numbers in text buffers.
+//
+// =============================================================================
+
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "utils/ChUtilsMappedFile.h"
+
+namespace chrono {
+namespace utils {
+
+
+// -----------------------------------------------------------------------------
+// ChMappedFile
+// -----------------------------------------------------------------------------
+ChMappedFile::ChMappedFile()
+: m_data(0),
+  m_size(0),
+  m_open(false)
+#ifdef _WIN32
+  , m_file(INVALID_HANDLE_VALUE),
+  m_mapping(0)
+#endif
+{
+}
+
+ChMappedFile::~ChMappedFile()
+{
+  Close();
+}
+
+#ifdef _WIN32
+
+bool ChMappedFile::Open(const std::string& filename, bool sequential)
+{
+  Close();
+
+  HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                            OPEN_EXISTING,
+                            sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS, NULL);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size)) {
+    CloseHandle(file);
+    return false;
+  }
+
+  m_file = file;
+  m_size = (size_t) size.QuadPart;
+  m_open = true;
+
+  // A zero-length file cannot be mapped.
+  if (m_size == 0)
+    return true;
+
+  HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (!mapping) {
+    Close();
+    return false;
+  }
+  m_mapping = mapping;
+
+  m_data = (const char*) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (!m_data) {
+    Close();
+    return false;
+  }
+
+  return true;
+}
+
+void ChMappedFile::Close()
+{
+  if (m_data)
+    UnmapViewOfFile(m_data);
+  if (m_mapping)
+    CloseHandle((HANDLE) m_mapping);
+  if (m_file != INVALID_HANDLE_VALUE)
+    CloseHandle((HANDLE) m_file);
+
+  m_data = 0;
+  m_size = 0;
+  m_open = false;
+  m_file = INVALID_HANDLE_VALUE;
+  m_mapping = 0;
+}
+
+#else
+
+bool ChMappedFile::Open(const std::string& filename, bool sequential)
+{
+  Close();
+
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return false;
+  }
+
+  m_size = (size_t) st.st_size;
+  m_open = true;
+
+  // A zero-length file cannot be mapped.
+  if (m_size == 0) {
+    close(fd);
+    return true;
+  }
+
+  void* data = mmap(0, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if (data == MAP_FAILED) {
+    m_size = 0;
+    m_open = false;
+    return false;
+  }
+
+  madvise(data, m_size, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+  m_data = (const char*) data;
+
+  return true;
+}
+
+void ChMappedFile::Close()
+{
+  if (m_data)
+    munmap((void*) m_data, m_size);
+
+  m_data = 0;
+  m_size = 0;
+  m_open = false;
+}
+
+#endif
+
+
+// -----------------------------------------------------------------------------
+// ChTextScanner::ParseInt
+// ChTextScanner::ParseDouble
+// -----------------------------------------------------------------------------
+const char* ChTextScanner::ParseInt(const char* begin, const char* end, long long& val)
+{
+  const char* p = begin;
+  bool neg = false;
+
+  if (p < end && (*p == '-' || *p == '+'))
+    neg = (*p++ == '-');
+
+  const char* digits = p;
+  unsigned long long v = 0;
+  while (p < end && *p >= '0' && *p <= '9')
+    v = 10 * v + (*p++ - '0');
+
+  if (p == digits)
+    return begin;
+
+  val = neg ? -(long long) v : (long long) v;
+  return p;
+}
+
+// Powers of 10 exactly representable as doubles.
+static const double s_pow10[] = {
+  1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Truncated 128-bit normalized powers of five, 5^q for q = -64, ..., 64 (high
+// and low 64-bit words), for the Eisel-Lemire algorithm.
+static const int s_min_pow5 = -64;
+static const int s_max_pow5 = 64;
+
+static const uint64_t s_pow5_128[] = {
+  0xa87fea27a539e9a5ULL, 0x3f2398d747b36224ULL,
+  0xd29fe4b18e88640eULL, 0x8eec7f0d19a03aadULL,
+  0x83a3eeeef9153e89ULL, 0x1953cf68300424acULL,
+  0xa48ceaaab75a8e2bULL, 0x5fa8c3423c052dd7ULL,
+  0xcdb02555653131b6ULL, 0x3792f412cb06794dULL,
+  0x808e17555f3ebf11ULL, 0xe2bbd88bbee40bd0ULL,
+  0xa0b19d2ab70e6ed6ULL, 0x5b6aceaeae9d0ec4ULL,
+  0xc8de047564d20a8bULL, 0xf245825a5a445275ULL,
+  0xfb158592be068d2eULL, 0xeed6e2f0f0d56712ULL,
+  0x9ced737bb6c4183dULL, 0x55464dd69685606bULL,
+  0xc428d05aa4751e4cULL, 0xaa97e14c3c26b886ULL,
+  0xf53304714d9265dfULL, 0xd53dd99f4b3066a8ULL,
+  0x993fe2c6d07b7fabULL, 0xe546a8038efe4029ULL,
+  0xbf8fdb78849a5f96ULL, 0xde98520472bdd033ULL,
+  0xef73d256a5c0f77cULL, 0x963e66858f6d4440ULL,
+  0x95a8637627989aadULL, 0xdde7001379a44aa8ULL,
+  0xbb127c53b17ec159ULL, 0x5560c018580d5d52ULL,
+  0xe9d71b689dde71afULL, 0xaab8f01e6e10b4a6ULL,
+  0x9226712162ab070dULL, 0xcab3961304ca70e8ULL,
+  0xb6b00d69bb55c8d1ULL, 0x3d607b97c5fd0d22ULL,
+  0xe45c10c42a2b3b05ULL, 0x8cb89a7db77c506aULL,
+  0x8eb98a7a9a5b04e3ULL, 0x77f3608e92adb242ULL,
+  0xb267ed1940f1c61cULL, 0x55f038b237591ed3ULL,
+  0xdf01e85f912e37a3ULL, 0x6b6c46dec52f6688ULL,
+  0x8b61313bbabce2c6ULL, 0x2323ac4b3b3da015ULL,
+  0xae397d8aa96c1b77ULL, 0xabec975e0a0d081aULL,
+  0xd9c7dced53c72255ULL, 0x96e7bd358c904a21ULL,
+  0x881cea14545c7575ULL, 0x7e50d64177da2e54ULL,
+  0xaa242499697392d2ULL, 0xdde50bd1d5d0b9e9ULL,
+  0xd4ad2dbfc3d07787ULL, 0x955e4ec64b44e864ULL,
+  0x84ec3c97da624ab4ULL, 0xbd5af13bef0b113eULL,
+  0xa6274bbdd0fadd61ULL, 0xecb1ad8aeacdd58eULL,
+  0xcfb11ead453994baULL, 0x67de18eda5814af2ULL,
+  0x81ceb32c4b43fcf4ULL, 0x80eacf948770ced7ULL,
+  0xa2425ff75e14fc31ULL, 0xa1258379a94d028dULL,
+  0xcad2f7f5359a3b3eULL, 0x096ee45813a04330ULL,
+  0xfd87b5f28300ca0dULL, 0x8bca9d6e188853fcULL,
+  0x9e74d1b791e07e48ULL, 0x775ea264cf55347eULL,
+  0xc612062576589ddaULL, 0x95364afe032a819eULL,
+  0xf79687aed3eec551ULL, 0x3a83ddbd83f52205ULL,
+  0x9abe14cd44753b52ULL, 0xc4926a9672793543ULL,
+  0xc16d9a0095928a27ULL, 0x75b7053c0f178294ULL,
+  0xf1c90080baf72cb1ULL, 0x5324c68b12dd6339ULL,
+  0x971da05074da7beeULL, 0xd3f6fc16ebca5e04ULL,
+  0xbce5086492111aeaULL, 0x88f4bb1ca6bcf585ULL,
+  0xec1e4a7db69561a5ULL, 0x2b31e9e3d06c32e6ULL,
+  0x9392ee8e921d5d07ULL, 0x3aff322e62439fd0ULL,
+  0xb877aa3236a4b449ULL, 0x09befeb9fad487c3ULL,
+  0xe69594bec44de15bULL, 0x4c2ebe687989a9b4ULL,
+  0x901d7cf73ab0acd9ULL, 0x0f9d37014bf60a11ULL,
+  0xb424dc35095cd80fULL, 0x538484c19ef38c95ULL,
+  0xe12e13424bb40e13ULL, 0x2865a5f206b06fbaULL,
+  0x8cbccc096f5088cbULL, 0xf93f87b7442e45d4ULL,
+  0xafebff0bcb24aafeULL, 0xf78f69a51539d749ULL,
+  0xdbe6fecebdedd5beULL, 0xb573440e5a884d1cULL,
+  0x89705f4136b4a597ULL, 0x31680a88f8953031ULL,
+  0xabcc77118461cefcULL, 0xfdc20d2b36ba7c3eULL,
+  0xd6bf94d5e57a42bcULL, 0x3d32907604691b4dULL,
+  0x8637bd05af6c69b5ULL, 0xa63f9a49c2c1b110ULL,
+  0xa7c5ac471b478423ULL, 0x0fcf80dc33721d54ULL,
+  0xd1b71758e219652bULL, 0xd3c36113404ea4a9ULL,
+  0x83126e978d4fdf3bULL, 0x645a1cac083126eaULL,
+  0xa3d70a3d70a3d70aULL, 0x3d70a3d70a3d70a4ULL,
+  0xccccccccccccccccULL, 0xcccccccccccccccdULL,
+  0x8000000000000000ULL, 0x0000000000000000ULL,
+  0xa000000000000000ULL, 0x0000000000000000ULL,
+  0xc800000000000000ULL, 0x0000000000000000ULL,
+  0xfa00000000000000ULL, 0x0000000000000000ULL,
+  0x9c40000000000000ULL, 0x0000000000000000ULL,
+  0xc350000000000000ULL, 0x0000000000000000ULL,
+  0xf424000000000000ULL, 0x0000000000000000ULL,
+  0x9896800000000000ULL, 0x0000000000000000ULL,
+  0xbebc200000000000ULL, 0x0000000000000000ULL,
+  0xee6b280000000000ULL, 0x0000000000000000ULL,
+  0x9502f90000000000ULL, 0x0000000000000000ULL,
+  0xba43b74000000000ULL, 0x0000000000000000ULL,
+  0xe8d4a51000000000ULL, 0x0000000000000000ULL,
+  0x9184e72a00000000ULL, 0x0000000000000000ULL,
+  0xb5e620f480000000ULL, 0x0000000000000000ULL,
+  0xe35fa931a0000000ULL, 0x0000000000000000ULL,
+  0x8e1bc9bf04000000ULL, 0x0000000000000000ULL,
+  0xb1a2bc2ec5000000ULL, 0x0000000000000000ULL,
+  0xde0b6b3a76400000ULL, 0x0000000000000000ULL,
+  0x8ac7230489e80000ULL, 0x0000000000000000ULL,
+  0xad78ebc5ac620000ULL, 0x0000000000000000ULL,
+  0xd8d726b7177a8000ULL, 0x0000000000000000ULL,
+  0x878678326eac9000ULL, 0x0000000000000000ULL,
+  0xa968163f0a57b400ULL, 0x0000000000000000ULL,
+  0xd3c21bcecceda100ULL, 0x0000000000000000ULL,
+  0x84595161401484a0ULL, 0x0000000000000000ULL,
+  0xa56fa5b99019a5c8ULL, 0x0000000000000000ULL,
+  0xcecb8f27f4200f3aULL, 0x0000000000000000ULL,
+  0x813f3978f8940984ULL, 0x4000000000000000ULL,
+  0xa18f07d736b90be5ULL, 0x5000000000000000ULL,
+  0xc9f2c9cd04674edeULL, 0xa400000000000000ULL,
+  0xfc6f7c4045812296ULL, 0x4d00000000000000ULL,
+  0x9dc5ada82b70b59dULL, 0xf020000000000000ULL,
+  0xc5371912364ce305ULL, 0x6c28000000000000ULL,
+  0xf684df56c3e01bc6ULL, 0xc732000000000000ULL,
+  0x9a130b963a6c115cULL, 0x3c7f400000000000ULL,
+  0xc097ce7bc90715b3ULL, 0x4b9f100000000000ULL,
+  0xf0bdc21abb48db20ULL, 0x1e86d40000000000ULL,
+  0x96769950b50d88f4ULL, 0x1314448000000000ULL,
+  0xbc143fa4e250eb31ULL, 0x17d955a000000000ULL,
+  0xeb194f8e1ae525fdULL, 0x5dcfab0800000000ULL,
+  0x92efd1b8d0cf37beULL, 0x5aa1cae500000000ULL,
+  0xb7abc627050305adULL, 0xf14a3d9e40000000ULL,
+  0xe596b7b0c643c719ULL, 0x6d9ccd05d0000000ULL,
+  0x8f7e32ce7bea5c6fULL, 0xe4820023a2000000ULL,
+  0xb35dbf821ae4f38bULL, 0xdda2802c8a800000ULL,
+  0xe0352f62a19e306eULL, 0xd50b2037ad200000ULL,
+  0x8c213d9da502de45ULL, 0x4526f422cc340000ULL,
+  0xaf298d050e4395d6ULL, 0x9670b12b7f410000ULL,
+  0xdaf3f04651d47b4cULL, 0x3c0cdd765f114000ULL,
+  0x88d8762bf324cd0fULL, 0xa5880a69fb6ac800ULL,
+  0xab0e93b6efee0053ULL, 0x8eea0d047a457a00ULL,
+  0xd5d238a4abe98068ULL, 0x72a4904598d6d880ULL,
+  0x85a36366eb71f041ULL, 0x47a6da2b7f864750ULL,
+  0xa70c3c40a64e6c51ULL, 0x999090b65f67d924ULL,
+  0xd0cf4b50cfe20765ULL, 0xfff4b4e3f741cf6dULL,
+  0x82818f1281ed449fULL, 0xbff8f10e7a8921a4ULL,
+  0xa321f2d7226895c7ULL, 0xaff72d52192b6a0dULL,
+  0xcbea6f8ceb02bb39ULL, 0x9bf4f8a69f764490ULL,
+  0xfee50b7025c36a08ULL, 0x02f236d04753d5b4ULL,
+  0x9f4f2726179a2245ULL, 0x01d762422c946590ULL,
+  0xc722f0ef9d80aad6ULL, 0x424d3ad2b7b97ef5ULL,
+  0xf8ebad2b84e0d58bULL, 0xd2e0898765a7deb2ULL,
+  0x9b934c3b330c8577ULL, 0x63cc55f49f88eb2fULL,
+  0xc2781f49ffcfa6d5ULL, 0x3cbf6b71c76b25fbULL
+};
+
+// Upper and lower 64 bits of the 128-bit product of a and b.
+static void Multiply128(uint64_t a, uint64_t b, uint64_t& hi, uint64_t& lo)
+{
+  const uint64_t M32 = 0xFFFFFFFFULL;
+  uint64_t a1 = a >> 32, a0 = a & M32;
+  uint64_t b1 = b >> 32, b0 = b & M32;
+  uint64_t p11 = a1 * b1, p01 = a0 * b1, p10 = a1 * b0, p00 = a0 * b0;
+  uint64_t mid = (p00 >> 32) + (p10 & M32) + (p01 & M32);
+  hi = p11 + (p10 >> 32) + (p01 >> 32) + (mid >> 32);
+  lo = (mid << 32) | (p00 & M32);
+}
+
+// Convert w * 10^q to the nearest double with the Eisel-Lemire algorithm
+// (D. Lemire, "Number parsing at a gigabyte per second", 2021). Return false
+// in the rare cases which cannot be decided this way (and for subnormal or
+// overflowing results).
+static bool EiselLemire(uint64_t w, int q, double& val)
+{
+  if (w == 0 || q < s_min_pow5 || q > s_max_pow5)
+    return false;
+
+  int lz = 0;
+  while (!(w & (1ULL << 63))) {
+    w <<= 1;
+    lz++;
+  }
+
+  const uint64_t* pow5 = &s_pow5_128[2 * (q - s_min_pow5)];
+  uint64_t hi, lo;
+  Multiply128(w, pow5[0], hi, lo);
+
+  // If the leading bits are not sufficient, use the full 128-bit power.
+  const uint64_t precision_mask = 0xFFFFFFFFFFFFFFFFULL >> 55;
+  if ((hi & precision_mask) == precision_mask) {
+    uint64_t hi2, lo2;
+    Multiply128(w, pow5[1], hi2, lo2);
+    lo += hi2;
+    if (hi2 > lo)
+      hi++;
+    if (lo == 0xFFFFFFFFFFFFFFFFULL)
+      return false;
+  }
+
+  int upperbit = (int) (hi >> 63);
+  uint64_t mantissa = hi >> (upperbit + 9);
+  int power2 = ((217706 * q) >> 16) + 63 + upperbit - lz + 1023;
+
+  if (power2 <= 0)
+    return false;
+
+  // Ties to even: the product is exact and halfway between two doubles.
+  if (lo <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1) {
+    if ((mantissa << (upperbit + 9)) == hi)
+      mantissa &= ~1ULL;
+  }
+
+  mantissa += (mantissa & 1);
+  mantissa >>= 1;
+  if (mantissa >= (2ULL << 52)) {
+    mantissa = 1ULL << 52;
+    power2++;
+  }
+  mantissa &= ~(1ULL << 52);
+
+  if (power2 >= 0x7FF)
+    return false;
+
+  uint64_t bits = mantissa | ((uint64_t) power2 << 52);
+  std::memcpy(&val, &bits, sizeof(val));
+  return true;
+}
+
+const char* ChTextScanner::ParseDouble(const char* begin, const char* end, double& val)
+{
+  const char* p = begin;
+  bool neg = false;
+
+  if (p < end && (*p == '-' || *p == '+'))
+    neg = (*p++ == '-');
+
+  // Accumulate the significant digits of the integer and fractional parts.
+  unsigned long long mantissa = 0;
+  int  num_digits = 0;
+  int  exp10 = 0;
+  bool any_digit = false;
+
+  while (p < end && *p >= '0' && *p <= '9') {
+    any_digit = true;
+    if (num_digits < 19) {
+      mantissa = 10 * mantissa + (*p - '0');
+      if (mantissa != 0)
+        num_digits++;
+    } else {
+      exp10++;
+      if (*p != '0')
+        num_digits++;
+    }
+    p++;
+  }
+
+  if (p < end && *p == '.') {
+    p++;
+    while (p < end && *p >= '0' && *p <= '9') {
+      any_digit = true;
+      if (num_digits < 19) {
+        mantissa = 10 * mantissa + (*p - '0');
+        exp10--;
+        if (mantissa != 0)
+          num_digits++;
+      } else if (*p != '0') {
+        num_digits++;
+      }
+      p++;
+    }
+  }
+
+  if (any_digit && p < end && (*p == 'e' || *p == 'E')) {
+    long long e;
+    const char* q = ParseInt(p + 1, end, e);
+    if (q != p + 1) {
+      if (e > 100000) e = 100000;
+      if (e < -100000) e = -100000;
+      exp10 += (int) e;
+      p = q;
+    }
+  }
+
+  // Fast path: the mantissa is exactly representable and so is the power of
+  // ten, so a single (correctly rounded) operation gives the exact result.
+  if (any_digit && num_digits <= 19 && mantissa <= (1ULL << 53) && exp10 >= -22 && exp10 <= 22) {
+    double v = (double) mantissa;
+    v = (exp10 >= 0) ? v * s_pow10[exp10] : v / s_pow10[-exp10];
+    val = neg ? -v : v;
+    return p;
+  }
+
+  // Up to 19 significant digits and a moderate exponent: the mantissa is exact
+  // and the correctly rounded result is obtained with 128-bit arithmetic.
+  if (any_digit && num_digits <= 19) {
+    double v;
+    if (EiselLemire(mantissa, exp10, v)) {
+      val = neg ? -v : v;
+      return p;
+    }
+  }
+
+  // Slow path: copy the candidate characters and let strtod do the work (this
+  // also handles infinities and NaNs).
+  const char* q = begin;
+  while (q < end && q - begin < 511 && *q && std::strchr("0123456789+-.eEinfatyINFATY", *q))
+    q++;
+
+  char buf[512];
+  size_t n = q - begin;
+  std::memcpy(buf, begin, n);
+  buf[n] = '\0';
+
+  char* stop;
+  double v = std::strtod(buf, &stop);
+  if (stop == buf)
+    return begin;
+
+  val = v;
+  return begin + (stop - buf);
+}
+
+
+// -----------------------------------------------------------------------------
+// ChTextScanner
+// -----------------------------------------------------------------------------
+bool ChTextScanner::SkipSpace(bool skip_eol)
+{
+  while (m_cur < m_end && (IsSpace(*m_cur) || (skip_eol && *m_cur == '\n')))
+    m_cur++;
+  return m_cur < m_end;
+}
+
+bool ChTextScanner::AtEndOfLine()
+{
+  SkipSpace(false);
+  return m_cur >= m_end || *m_cur == '\n';
+}
+
+void ChTextScanner::SkipLine()
+{
+  while (m_cur < m_end && *m_cur != '\n')
+    m_cur++;
+  if (m_cur < m_end)
+    m_cur++;
+}
+
+ChTextScanner& ChTextScanner::operator>>(double& val)
+{
+  val = 0;
+  SkipSpace();
+  const char* next = ParseDouble(m_cur, m_end, val);
+  if (next == m_cur)
+    m_ok = false;
+  m_cur = next;
+  return *this;
+}
+
+ChTextScanner& ChTextScanner::operator>>(float& val)
+{
+  double v;
+  *this >> v;
+  val = (float) v;
+  return *this;
+}
+
+ChTextScanner& ChTextScanner::operator>>(int& val)
+{
+  long long v = 0;
+  SkipSpace();
+  const char* next = ParseInt(m_cur, m_end, v);
+  if (next == m_cur)
+    m_ok = false;
+  m_cur = next;
+  val = (int) v;
+  return *this;
+}
+
+ChTextScanner& ChTextScanner::operator>>(bool& val)
+{
+  int v;
+  *this >> v;
+  val = (v != 0);
+  return *this;
+}
+
+ChTextScanner& ChTextScanner::operator>>(std::string& val)
+{
+  SkipSpace();
+  const char* start = m_cur;
+  while (m_cur < m_end && !IsSpace(*m_cur) && *m_cur != '\n')
+    m_cur++;
+  if (m_cur == start)
+    m_ok = false;
+  val.assign(start, m_cur);
+  return *this;
+}
+
+
+}  // namespace utils
+}  // namespace chrono
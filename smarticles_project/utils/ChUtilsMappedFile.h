@@ -0,0 +1,146 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Radu Serban
+// =============================================================================
+//
+// Read-only memory-mapped files and a scanner for numbers in text buffers.
+//
+// =============================================================================
+
+#ifndef CH_UTILS_MAPPED_FILE_H
+#define CH_UTILS_MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+
+#include "utils/ChApiUtils.h"
+
+
+namespace chrono {
+namespace utils {
+
+
+///
+/// Read-only view of an entire file mapped in memory.
+/// Empty files are opened successfully, but have no data.
+///
+class CH_UTILS_API ChMappedFile
+{
+public:
+
+  ChMappedFile();
+  ~ChMappedFile();
+
+  /// Map the specified file in memory (any previously mapped file is closed).
+  /// If 'sequential' is false, the file is expected to be accessed randomly and
+  /// the operating system is advised not to read ahead.
+  /// Return false if the file cannot be opened or mapped.
+  bool Open(const std::string& filename, bool sequential = true);
+
+  /// Unmap the file.
+  void Close();
+
+  bool IsOpen() const { return m_open; }
+
+  /// Return a pointer to the first byte of the file (NULL if empty).
+  const char* GetData() const { return m_data; }
+  /// Return the size of the file in bytes.
+  size_t GetSize() const { return m_size; }
+
+private:
+
+  const char*  m_data;
+  size_t       m_size;
+  bool         m_open;
+
+#ifdef _WIN32
+  void*        m_file;
+  void*        m_mapping;
+#endif
+
+  // Not copyable
+  ChMappedFile(const ChMappedFile&);
+  ChMappedFile& operator=(const ChMappedFile&);
+};
+
+
+///
+/// Sequential scanner for whitespace- or delimiter-separated numbers in a text
+/// buffer (which need not be NUL-terminated).
+/// Integers are parsed directly. Floating point values with at most 19
+/// significant digits and a small decimal exponent are converted exactly with a
+/// single multiplication or division; all other values fall back to strtod, so
+/// that the result is always correctly rounded.
+///
+class CH_UTILS_API ChTextScanner
+{
+public:
+
+  ChTextScanner(const char* data, size_t size, char delim = ' ')
+  : m_cur(data), m_end(data + size), m_delim(delim), m_ok(true) {}
+
+  /// Skip blanks and delimiters (and, optionally, line ends).
+  /// Return false if the end of the buffer was reached.
+  bool SkipSpace(bool skip_eol = true);
+
+  /// Return true if the scanner is positioned at the end of a line or at the
+  /// end of the buffer (after skipping blanks and delimiters).
+  bool AtEndOfLine();
+
+  /// Move past the end of the current line.
+  void SkipLine();
+
+  /// Read the next value. On error, the value is set to 0 and the scanner
+  /// fail flag is set.
+  ChTextScanner& operator>>(double& val);
+  ChTextScanner& operator>>(float& val);
+  ChTextScanner& operator>>(int& val);
+  ChTextScanner& operator>>(bool& val);
+
+  /// Read the next token (delimited by blanks, delimiters, or line ends).
+  ChTextScanner& operator>>(std::string& val);
+
+  /// Return false if any read failed.
+  bool Ok() const { return m_ok; }
+  /// Return true if the end of the buffer was reached.
+  bool Eof() const { return m_cur >= m_end; }
+
+  /// Current position in the buffer.
+  const char* GetPos() const { return m_cur; }
+  void SetPos(const char* pos) { m_cur = pos; }
+
+  /// Parse a floating point value from the given character range.
+  /// Return the position past the parsed characters (equal to 'begin' if no
+  /// number could be parsed).
+  static const char* ParseDouble(const char* begin, const char* end, double& val);
+
+  /// Parse an integer value from the given character range.
+  /// Return the position past the parsed characters (equal to 'begin' if no
+  /// number could be parsed).
+  static const char* ParseInt(const char* begin, const char* end, long long& val);
+
+private:
+
+  bool IsSpace(char c) const { return c == ' ' || c == '\t' || c == '\r' || c == m_delim; }
+
+  const char*  m_cur;
+  const char*  m_end;
+  char         m_delim;
+  bool         m_ok;
+};
+
+
+} // namespace utils
+} // namespace chrono
+
+
+#endif
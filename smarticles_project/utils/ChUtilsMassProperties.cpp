@@ -0,0 +1,298 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Radu Serban
+// =============================================================================
+//
+// Mass properties of bodies composed of several primitive shapes.
+//
+// =============================================================================
+
+#include "core/ChFrame.h"
+
+#include "utils/ChUtilsMassProperties.h"
+
+namespace chrono {
+namespace utils {
+
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+ChCompositeInertia::ChCompositeInertia()
+: m_dirty(false),
+  m_total_mass(0),
+  m_com(0, 0, 0)
+{
+}
+
+void ChCompositeInertia::Clear()
+{
+  m_mass.clear();
+  for (int i = 0; i < 3; i++) {
+    m_pos[i].clear();
+    m_gyr[i].clear();
+  }
+  for (int i = 0; i < 4; i++)
+    m_rot[i].clear();
+
+  m_dirty = true;
+}
+
+void ChCompositeInertia::Reserve(size_t num_components)
+{
+  m_mass.reserve(num_components);
+  for (int i = 0; i < 3; i++) {
+    m_pos[i].reserve(num_components);
+    m_gyr[i].reserve(num_components);
+  }
+  for (int i = 0; i < 4; i++)
+    m_rot[i].reserve(num_components);
+}
+
+
+// -----------------------------------------------------------------------------
+// Adding components
+// -----------------------------------------------------------------------------
+void ChCompositeInertia::AddComponent(double                mass,
+                                      const ChVector<>&     gyration,
+                                      const ChVector<>&     pos,
+                                      const ChQuaternion<>& rot)
+{
+  m_mass.push_back(mass);
+
+  m_pos[0].push_back(pos.x);
+  m_pos[1].push_back(pos.y);
+  m_pos[2].push_back(pos.z);
+
+  m_rot[0].push_back(rot.e0);
+  m_rot[1].push_back(rot.e1);
+  m_rot[2].push_back(rot.e2);
+  m_rot[3].push_back(rot.e3);
+
+  m_gyr[0].push_back(gyration.x);
+  m_gyr[1].push_back(gyration.y);
+  m_gyr[2].push_back(gyration.z);
+
+  m_dirty = true;
+}
+
+// The gyration tensors of all primitive shapes are diagonal in the shape frame.
+void ChCompositeInertia::AddShape(double                mass,
+                                  const ChMatrix33<>&   gyration,
+                                  const ChVector<>&     pos,
+                                  const ChQuaternion<>& rot)
+{
+  AddComponent(mass,
+               ChVector<>(gyration.GetElement(0, 0), gyration.GetElement(1, 1), gyration.GetElement(2, 2)),
+               pos, rot);
+}
+
+void ChCompositeInertia::AddSphere(double radius, double density, const ChVector<>& pos, const ChQuaternion<>& rot)
+{
+  AddShape(density * CalcSphereVolume(radius), CalcSphereGyration(radius), pos, rot);
+}
+
+void ChCompositeInertia::AddEllipsoid(const ChVector<>& hdims, double density, const ChVector<>& pos, const ChQuaternion<>& rot)
+{
+  AddShape(density * CalcEllipsoidVolume(hdims), CalcEllipsoidGyration(hdims), pos, rot);
+}
+
+void ChCompositeInertia::AddBox(const ChVector<>& hdims, double density, const ChVector<>& pos, const ChQuaternion<>& rot)
+{
+  AddShape(density * CalcBoxVolume(hdims), CalcBoxGyration(hdims), pos, rot);
+}
+
+void ChCompositeInertia::AddCapsule(double radius, double hlen, double density, const ChVector<>& pos, const ChQuaternion<>& rot)
+{
+  AddShape(density * CalcCapsuleVolume(radius, hlen), CalcCapsuleGyration(radius, hlen), pos, rot);
+}
+
+void ChCompositeInertia::AddCylinder(double radius, double hlen, double density, const ChVector<>& pos, const ChQuaternion<>& rot)
+{
+  AddShape(density * CalcCylinderVolume(radius, hlen), CalcCylinderGyration(radius, hlen), pos, rot);
+}
+
+void ChCompositeInertia::AddRoundedBox(const ChVector<>& hdims, double srad, double density, const ChVector<>& pos, const ChQuaternion<>& rot)
+{
+  AddShape(density * CalcRoundedBoxVolume(hdims, srad), CalcRoundedBoxGyration(hdims, srad), pos, rot);
+}
+
+void ChCompositeInertia::AddRoundedCylinder(double radius, double hlen, double srad, double density, const ChVector<>& pos, const ChQuaternion<>& rot)
+{
+  AddShape(density * CalcRoundedCylinderVolume(radius, hlen, srad), CalcRoundedCylinderGyration(radius, hlen, srad), pos, rot);
+}
+
+size_t ChCompositeInertia::AddShapes(const ChShape*        shapes,
+                                     const ChVector<>*     pos,
+                                     const ChQuaternion<>* rot,
+                                     size_t                num_shapes,
+                                     double                density)
+{
+  std::vector<double> volumes(num_shapes);
+  std::vector<double> gyrations(3 * num_shapes);
+
+  size_t num_unsupported = 0;
+  if (num_shapes > 0) {
+    num_unsupported = CalcShapeVolumes(shapes, num_shapes, &volumes[0]);
+    CalcShapeGyrations(shapes, num_shapes, &gyrations[0]);
+  }
+
+  Reserve(m_mass.size() + num_shapes);
+
+  for (size_t i = 0; i < num_shapes; i++) {
+    AddComponent(density * volumes[i],
+                 ChVector<>(gyrations[3 * i], gyrations[3 * i + 1], gyrations[3 * i + 2]),
+                 pos[i], rot[i]);
+  }
+
+  return num_unsupported;
+}
+
+
+// -----------------------------------------------------------------------------
+// ChCompositeInertia::Update
+//
+// For each component with mass m, position p, rotation matrix A, and principal
+// gyration G, the contribution to the inertia about the reference frame origin
+// is m * (A G A^T + (p.p) I - p p^T) (see TransformGyration). The loop over
+// components is branch-free and accumulates into independent lanes, so that it
+// can be vectorized without reassociating floating point sums. The inertia is
+// finally shifted to the center of mass.
+// -----------------------------------------------------------------------------
+static const int NUM_LANES = 4;
+
+enum {
+  ACC_MASS, ACC_MX, ACC_MY, ACC_MZ,
+  ACC_JXX, ACC_JYY, ACC_JZZ, ACC_JXY, ACC_JXZ, ACC_JYZ,
+  NUM_ACC
+};
+
+static inline void AccumulateComponent(double m,
+                                       double px, double py, double pz,
+                                       double e0, double e1, double e2, double e3,
+                                       double gx, double gy, double gz,
+                                       double* acc)
+{
+  // Rotation matrix of the (normalized) quaternion.
+  double s = 2 / (e0 * e0 + e1 * e1 + e2 * e2 + e3 * e3);
+  double a00 = 1 - s * (e2 * e2 + e3 * e3);
+  double a01 = s * (e1 * e2 - e0 * e3);
+  double a02 = s * (e1 * e3 + e0 * e2);
+  double a10 = s * (e1 * e2 + e0 * e3);
+  double a11 = 1 - s * (e1 * e1 + e3 * e3);
+  double a12 = s * (e2 * e3 - e0 * e1);
+  double a20 = s * (e1 * e3 - e0 * e2);
+  double a21 = s * (e2 * e3 + e0 * e1);
+  double a22 = 1 - s * (e1 * e1 + e2 * e2);
+
+  double pp = px * px + py * py + pz * pz;
+
+  acc[ACC_MASS] += m;
+  acc[ACC_MX] += m * px;
+  acc[ACC_MY] += m * py;
+  acc[ACC_MZ] += m * pz;
+
+  acc[ACC_JXX] += m * (a00 * a00 * gx + a01 * a01 * gy + a02 * a02 * gz + pp - px * px);
+  acc[ACC_JYY] += m * (a10 * a10 * gx + a11 * a11 * gy + a12 * a12 * gz + pp - py * py);
+  acc[ACC_JZZ] += m * (a20 * a20 * gx + a21 * a21 * gy + a22 * a22 * gz + pp - pz * pz);
+  acc[ACC_JXY] += m * (a00 * a10 * gx + a01 * a11 * gy + a02 * a12 * gz - px * py);
+  acc[ACC_JXZ] += m * (a00 * a20 * gx + a01 * a21 * gy + a02 * a22 * gz - px * pz);
+  acc[ACC_JYZ] += m * (a10 * a20 * gx + a11 * a21 * gy + a12 * a22 * gz - py * pz);
+}
+
+void ChCompositeInertia::Update() const
+{
+  if (!m_dirty)
+    return;
+
+  size_t n = m_mass.size();
+
+  const double* m = n ? &m_mass[0] : NULL;
+  const double* px = n ? &m_pos[0][0] : NULL;
+  const double* py = n ? &m_pos[1][0] : NULL;
+  const double* pz = n ? &m_pos[2][0] : NULL;
+  const double* e0 = n ? &m_rot[0][0] : NULL;
+  const double* e1 = n ? &m_rot[1][0] : NULL;
+  const double* e2 = n ? &m_rot[2][0] : NULL;
+  const double* e3 = n ? &m_rot[3][0] : NULL;
+  const double* gx = n ? &m_gyr[0][0] : NULL;
+  const double* gy = n ? &m_gyr[1][0] : NULL;
+  const double* gz = n ? &m_gyr[2][0] : NULL;
+
+  double lanes[NUM_LANES][NUM_ACC] = {{0}};
+
+  size_t i = 0;
+  for (; i + NUM_LANES <= n; i += NUM_LANES) {
+    for (int k = 0; k < NUM_LANES; k++) {
+      size_t j = i + k;
+      AccumulateComponent(m[j], px[j], py[j], pz[j], e0[j], e1[j], e2[j], e3[j], gx[j], gy[j], gz[j], lanes[k]);
+    }
+  }
+  for (; i < n; i++)
+    AccumulateComponent(m[i], px[i], py[i], pz[i], e0[i], e1[i], e2[i], e3[i], gx[i], gy[i], gz[i], lanes[0]);
+
+  double acc[NUM_ACC];
+  for (int a = 0; a < NUM_ACC; a++)
+    acc[a] = (lanes[0][a] + lanes[1][a]) + (lanes[2][a] + lanes[3][a]);
+
+  // Total mass and center of mass.
+  m_total_mass = acc[ACC_MASS];
+  if (m_total_mass != 0)
+    m_com = ChVector<>(acc[ACC_MX], acc[ACC_MY], acc[ACC_MZ]) / m_total_mass;
+  else
+    m_com = ChVector<>(0, 0, 0);
+
+  // Shift the inertia from the reference frame origin to the center of mass.
+  double c[3] = {m_com.x, m_com.y, m_com.z};
+  double cc = m_com.Length2();
+  double J[3][3] = {{acc[ACC_JXX], acc[ACC_JXY], acc[ACC_JXZ]},
+                    {acc[ACC_JXY], acc[ACC_JYY], acc[ACC_JYZ]},
+                    {acc[ACC_JXZ], acc[ACC_JYZ], acc[ACC_JZZ]}};
+
+  for (int r = 0; r < 3; r++) {
+    for (int k = 0; k < 3; k++)
+      m_inertia.SetElement(r, k, J[r][k] - m_total_mass * ((r == k ? cc : 0.0) - c[r] * c[k]));
+  }
+
+  m_dirty = false;
+}
+
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+ChVector<> ChCompositeInertia::GetInertiaXX() const
+{
+  Update();
+  return ChVector<>(m_inertia.GetElement(0, 0), m_inertia.GetElement(1, 1), m_inertia.GetElement(2, 2));
+}
+
+ChVector<> ChCompositeInertia::GetInertiaXY() const
+{
+  Update();
+  return ChVector<>(m_inertia.GetElement(0, 1), m_inertia.GetElement(0, 2), m_inertia.GetElement(1, 2));
+}
+
+void ChCompositeInertia::ApplyTo(ChBodyAuxRef* body) const
+{
+  ApplyTo((ChBody*) body);
+  body->SetFrame_COG_to_REF(ChFrame<>(GetCOM(), QUNIT));
+}
+
+void ChCompositeInertia::ApplyTo(ChBody* body) const
+{
+  body->SetMass(GetMass());
+  body->SetInertiaXX(GetInertiaXX());
+  body->SetInertiaXY(GetInertiaXY());
+}
+
+
+}  // namespace utils
+}  // namespace chrono
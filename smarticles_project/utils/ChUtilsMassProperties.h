@@ -0,0 +1,170 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Radu Serban
+// =============================================================================
+//
+// Mass properties of bodies composed of several primitive shapes.
+//
+// =============================================================================
+
+#ifndef CH_UTILS_MASS_PROPERTIES_H
+#define CH_UTILS_MASS_PROPERTIES_H
+
+#include <vector>
+
+#include "core/ChVector.h"
+#include "core/ChQuaternion.h"
+#include "core/ChMatrix33.h"
+
+#include "physics/ChBody.h"
+#include "physics/ChBodyAuxRef.h"
+
+#include "utils/ChApiUtils.h"
+#include "utils/ChUtilsGeometry.h"
+#include "utils/ChUtilsShapeTraits.h"
+
+
+namespace chrono {
+namespace utils {
+
+
+///
+/// Builder for the mass properties (mass, center of mass, and inertia tensor)
+/// of a composite body.
+/// Each component is a primitive shape with uniform density, placed at the
+/// given position and orientation relative to the body reference frame. The
+/// volume and centroidal gyration of each shape are obtained with the Calc*
+/// functions in ChUtilsGeometry; components are stored in structure-of-arrays
+/// form and the composite properties are evaluated in a single batched pass
+/// over all components (when first queried after a change). A negative density
+/// can be used to subtract a hole from a solid shape.
+///
+class CH_UTILS_API ChCompositeInertia
+{
+public:
+
+  ChCompositeInertia();
+
+  /// Remove all components.
+  void Clear();
+
+  /// Reserve storage for the specified number of components.
+  void Reserve(size_t num_components);
+
+  /// Return the number of components.
+  size_t GetNumComponents() const { return m_mass.size(); }
+
+  /// Add a component with the specified mass and principal centroidal gyration
+  /// (moments of inertia per unit mass, about the axes of the component frame).
+  void AddComponent(double                mass,
+                    const ChVector<>&     gyration,
+                    const ChVector<>&     pos = ChVector<>(0,0,0),
+                    const ChQuaternion<>& rot = ChQuaternion<>(1,0,0,0));
+
+  /// Add primitive shapes with the specified density.
+  void AddSphere(double                radius,
+                 double                density,
+                 const ChVector<>&     pos = ChVector<>(0,0,0),
+                 const ChQuaternion<>& rot = ChQuaternion<>(1,0,0,0));
+  void AddEllipsoid(const ChVector<>&     hdims,
+                    double                density,
+                    const ChVector<>&     pos = ChVector<>(0,0,0),
+                    const ChQuaternion<>& rot = ChQuaternion<>(1,0,0,0));
+  void AddBox(const ChVector<>&     hdims,
+              double                density,
+              const ChVector<>&     pos = ChVector<>(0,0,0),
+              const ChQuaternion<>& rot = ChQuaternion<>(1,0,0,0));
+  void AddCapsule(double                radius,
+                  double                hlen,
+                  double                density,
+                  const ChVector<>&     pos = ChVector<>(0,0,0),
+                  const ChQuaternion<>& rot = ChQuaternion<>(1,0,0,0));
+  void AddCylinder(double                radius,
+                   double                hlen,
+                   double                density,
+                   const ChVector<>&     pos = ChVector<>(0,0,0),
+                   const ChQuaternion<>& rot = ChQuaternion<>(1,0,0,0));
+  void AddRoundedBox(const ChVector<>&     hdims,
+                     double                srad,
+                     double                density,
+                     const ChVector<>&     pos = ChVector<>(0,0,0),
+                     const ChQuaternion<>& rot = ChQuaternion<>(1,0,0,0));
+  void AddRoundedCylinder(double                radius,
+                          double                hlen,
+                          double                srad,
+                          double                density,
+                          const ChVector<>&     pos = ChVector<>(0,0,0),
+                          const ChQuaternion<>& rot = ChQuaternion<>(1,0,0,0));
+
+  /// Add an array of shapes with the specified density, at the given
+  /// positions and orientations. Volumes and gyrations are evaluated in
+  /// batches (see ChShapeTraits). Shapes of unsupported types are added with
+  /// zero mass; the return value is their number.
+  size_t AddShapes(const ChShape*        shapes,
+                   const ChVector<>*     pos,
+                   const ChQuaternion<>* rot,
+                   size_t                num_shapes,
+                   double                density);
+
+  /// Return the total mass.
+  double GetMass() const { Update(); return m_total_mass; }
+
+  /// Return the center of mass, relative to the body reference frame.
+  const ChVector<>& GetCOM() const { Update(); return m_com; }
+
+  /// Return the inertia tensor about the center of mass (with axes parallel
+  /// to those of the body reference frame).
+  const ChMatrix33<>& GetInertia() const { Update(); return m_inertia; }
+
+  /// Return the moments of inertia about the center of mass.
+  ChVector<> GetInertiaXX() const;
+  /// Return the products of inertia (XY, XZ, YZ elements of the inertia
+  /// tensor) about the center of mass.
+  ChVector<> GetInertiaXY() const;
+
+  /// Set the mass, inertia, and center of mass of the specified body (the
+  /// components are assumed to be given relative to its reference frame).
+  void ApplyTo(ChBodyAuxRef* body) const;
+
+  /// Set the mass and inertia of the specified body. Since the reference frame
+  /// of a ChBody is its centroidal frame, the components should be given
+  /// relative to the center of mass (see GetCOM).
+  void ApplyTo(ChBody* body) const;
+
+private:
+
+  void AddShape(double                mass,
+                const ChMatrix33<>&   gyration,
+                const ChVector<>&     pos,
+                const ChQuaternion<>& rot);
+
+  void Update() const;
+
+  // Components
+  std::vector<double>  m_mass;
+  std::vector<double>  m_pos[3];
+  std::vector<double>  m_rot[4];
+  std::vector<double>  m_gyr[3];
+
+  // Composite properties (evaluated on demand)
+  mutable bool          m_dirty;
+  mutable double        m_total_mass;
+  mutable ChVector<>    m_com;
+  mutable ChMatrix33<>  m_inertia;
+};
+
+
+} // end namespace utils
+} // end namespace chrono
+
+
+#endif
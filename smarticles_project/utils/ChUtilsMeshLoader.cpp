@@ -0,0 +1,249 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Radu Serban
+// =============================================================================
+//
+// Parallel loader for triangle meshes in Wavefront OBJ format.
+//
+// =============================================================================
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "utils/ChUtilsMeshLoader.h"
+#include "utils/ChUtilsMappedFile.h"
+
+namespace chrono {
+namespace utils {
+
+
+// Files smaller than this are not worth splitting across threads.
+static const size_t OBJ_MIN_CHUNK_SIZE = 1 << 20;
+
+
+// -----------------------------------------------------------------------------
+// Parsing of one chunk of the file (a range of complete lines).
+//
+// Vertex indices are converted to 0-based. Relative (negative) indices refer to
+// the vertices read so far, and can therefore only be resolved once the number
+// of vertices in all preceding chunks is known: they are stored relative to the
+// first vertex of the chunk and their locations are recorded.
+// -----------------------------------------------------------------------------
+struct ObjChunk {
+  const char*                 begin;
+  const char*                 end;
+  std::vector<ChVector<> >    vertices;
+  std::vector<ChVector<int> > faces;
+  std::vector<size_t>         relative;   // locations (3 * face + k) of relative indices
+  bool                        ok;
+};
+
+static inline bool IsBlank(char c)
+{
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline const char* SkipBlanks(const char* p, const char* end)
+{
+  while (p < end && IsBlank(*p))
+    p++;
+  return p;
+}
+
+// Parse a face vertex reference (v, v/vt, v//vn, or v/vt/vn) and return the
+// position past it, or NULL on error.
+static const char* ParseFaceVertex(const char* p, const char* end, int num_vertices, int& index, bool& relative)
+{
+  long long val;
+  const char* q = ChTextScanner::ParseInt(p, end, val);
+  if (q == p || val == 0)
+    return NULL;
+
+  relative = val < 0;
+  index = relative ? num_vertices + (int) val : (int) val - 1;
+
+  while (q < end && !IsBlank(*q))
+    q++;
+  return q;
+}
+
+static void ParseObjChunk(ObjChunk* chunk)
+{
+  const char* p = chunk->begin;
+  const char* end = chunk->end;
+
+  chunk->ok = true;
+
+  while (p < end) {
+    p = SkipBlanks(p, end);
+
+    const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+    if (!eol)
+      eol = end;
+
+    if (eol - p > 1 && p[0] == 'v' && IsBlank(p[1])) {
+      // Vertex position (any weight component is ignored).
+      double x[3];
+      const char* q = p + 1;
+      for (int k = 0; k < 3; k++) {
+        q = SkipBlanks(q, eol);
+        const char* r = ChTextScanner::ParseDouble(q, eol, x[k]);
+        if (r == q) {
+          chunk->ok = false;
+          return;
+        }
+        q = r;
+      }
+      chunk->vertices.push_back(ChVector<>(x[0], x[1], x[2]));
+    }
+    else if (eol - p > 1 && p[0] == 'f' && IsBlank(p[1])) {
+      // Polygonal face, split into a triangle fan.
+      int num_vertices = (int) chunk->vertices.size();
+      int idx[3];
+      bool rel[3];
+      int n = 0;
+
+      const char* q = SkipBlanks(p + 1, eol);
+      while (q < eol) {
+        int  k = std::min(n, 2);
+        q = ParseFaceVertex(q, eol, num_vertices, idx[k], rel[k]);
+        if (!q) {
+          chunk->ok = false;
+          return;
+        }
+        q = SkipBlanks(q, eol);
+
+        if (++n < 3)
+          continue;
+
+        size_t loc = 3 * chunk->faces.size();
+        chunk->faces.push_back(ChVector<int>(idx[0], idx[1], idx[2]));
+        for (int j = 0; j < 3; j++) {
+          if (rel[j])
+            chunk->relative.push_back(loc + j);
+        }
+
+        idx[1] = idx[2];
+        rel[1] = rel[2];
+      }
+
+      if (n < 3) {
+        chunk->ok = false;
+        return;
+      }
+    }
+
+    p = eol + 1;
+  }
+}
+
+
+// -----------------------------------------------------------------------------
+// LoadObjMesh
+// -----------------------------------------------------------------------------
+bool LoadObjMesh(const std::string&                  filename,
+                 geometry::ChTriangleMeshConnected&  mesh,
+                 int                                 num_threads)
+{
+  ChMappedFile file;
+  if (!file.Open(filename))
+    return false;
+
+  const char* data = file.GetData();
+  size_t      size = file.GetSize();
+
+  // Split the file at line boundaries.
+  if (num_threads <= 0)
+    num_threads = (int) std::max(std::thread::hardware_concurrency(), 1u);
+  size_t num_chunks = std::max<size_t>(1, std::min<size_t>(num_threads, size / OBJ_MIN_CHUNK_SIZE));
+
+  std::vector<ObjChunk> chunks(num_chunks);
+  const char* pos = data;
+  for (size_t c = 0; c < num_chunks; c++) {
+    const char* next = data + size;
+    if (c + 1 < num_chunks) {
+      next = std::max(pos, data + (c + 1) * (size / num_chunks));
+      const char* eol = static_cast<const char*>(std::memchr(next, '\n', data + size - next));
+      next = eol ? eol + 1 : data + size;
+    }
+    chunks[c].begin = pos;
+    chunks[c].end = next;
+    pos = next;
+  }
+
+  // Parse all chunks.
+  std::vector<std::thread> threads;
+  for (size_t c = 1; c < num_chunks; c++)
+    threads.push_back(std::thread(ParseObjChunk, &chunks[c]));
+  ParseObjChunk(&chunks[0]);
+
+  for (size_t c = 0; c < threads.size(); c++)
+    threads[c].join();
+
+  // Stitch the vertex and index buffers, resolving relative indices.
+  size_t num_vertices = 0;
+  size_t num_faces = 0;
+  for (size_t c = 0; c < num_chunks; c++) {
+    if (!chunks[c].ok)
+      return false;
+    num_vertices += chunks[c].vertices.size();
+    num_faces += chunks[c].faces.size();
+  }
+
+  mesh.m_vertices.resize(num_vertices);
+  mesh.m_face_v_indices.resize(num_faces);
+  mesh.m_normals.clear();
+  mesh.m_UV.clear();
+  mesh.m_face_n_indices.clear();
+  mesh.m_face_u_indices.clear();
+
+  int vertex_offset = 0;
+  size_t face_offset = 0;
+  for (size_t c = 0; c < num_chunks; c++) {
+    ObjChunk& chunk = chunks[c];
+
+    for (size_t i = 0; i < chunk.relative.size(); i++) {
+      ChVector<int>& face = chunk.faces[chunk.relative[i] / 3];
+      switch (chunk.relative[i] % 3) {
+      case 0: face.x += vertex_offset; break;
+      case 1: face.y += vertex_offset; break;
+      case 2: face.z += vertex_offset; break;
+      }
+    }
+
+    std::copy(chunk.vertices.begin(), chunk.vertices.end(), mesh.m_vertices.begin() + vertex_offset);
+    std::copy(chunk.faces.begin(), chunk.faces.end(), mesh.m_face_v_indices.begin() + face_offset);
+
+    vertex_offset += (int) chunk.vertices.size();
+    face_offset += chunk.faces.size();
+
+    // Release the chunk buffers as soon as they are copied.
+    std::vector<ChVector<> >().swap(chunk.vertices);
+    std::vector<ChVector<int> >().swap(chunk.faces);
+  }
+
+  // Validate the vertex indices.
+  int nv = (int) num_vertices;
+  for (size_t i = 0; i < num_faces; i++) {
+    const ChVector<int>& face = mesh.m_face_v_indices[i];
+    if (face.x < 0 || face.x >= nv || face.y < 0 || face.y >= nv || face.z < 0 || face.z >= nv)
+      return false;
+  }
+
+  return true;
+}
+
+
+}  // namespace utils
+}  // namespace chrono
@@ -0,0 +1,56 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Radu Serban
+// =============================================================================
+//
+// Parallel loader for triangle meshes in Wavefront OBJ format.
+//
+// =============================================================================
+
+#ifndef CH_UTILS_MESH_LOADER_H
+#define CH_UTILS_MESH_LOADER_H
+
+#include <string>
+
+#include "geometry/ChCTriangleMeshConnected.h"
+
+#include "utils/ChApiUtils.h"
+
+
+namespace chrono {
+namespace utils {
+
+
+// -----------------------------------------------------------------------------
+// LoadObjMesh
+//
+// Load the vertices and faces of a Wavefront OBJ file into the specified mesh
+// (any previous content is discarded). Only vertex positions and face vertex
+// indices are read, as with LoadWavefrontMesh(filename, false, false); polygons
+// are split into triangle fans, and relative (negative) indices are supported.
+// All other statements are ignored.
+// The file is mapped in memory and split at line boundaries into chunks that
+// are parsed concurrently, using up to 'num_threads' threads (0: one per
+// hardware thread). Return false if the file cannot be read or contains an
+// invalid vertex or face statement.
+// -----------------------------------------------------------------------------
+CH_UTILS_API
+bool LoadObjMesh(const std::string&                  filename,
+                 geometry::ChTriangleMeshConnected&  mesh,
+                 int                                 num_threads = 0);
+
+
+} // end namespace utils
+} // end namespace chrono
+
+
+#endif
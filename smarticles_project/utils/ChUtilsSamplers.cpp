@@ -0,0 +1,201 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Radu Serban
+// =============================================================================
+//
+// Samplers generating sets of points with a prescribed minimum separation,
+// used to lay out non-overlapping particles.
+//
+// =============================================================================
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include "core/ChMathematics.h"
+
+#include "utils/ChUtilsSamplers.h"
+
+namespace chrono {
+namespace utils {
+
+
+// -----------------------------------------------------------------------------
+// ChGridSampler
+// -----------------------------------------------------------------------------
+void ChGridSampler::SampleBox(const ChVector<>& center,
+                              const ChVector<>& hdims,
+                              PointVector&      points)
+{
+  double d = m_separation;
+  if (d <= 0 || hdims.x < 0 || hdims.y < 0 || hdims.z < 0)
+    return;
+
+  int nx = (int) std::floor(2 * hdims.x / d) + 1;
+  int ny = (int) std::floor(2 * hdims.y / d) + 1;
+  int nz = (int) std::floor(2 * hdims.z / d) + 1;
+
+  ChVector<> start = center - ChVector<>(nx - 1, ny - 1, nz - 1) * (d / 2);
+
+  points.reserve(points.size() + (size_t) nx * ny * nz);
+
+  for (int k = 0; k < nz; k++) {
+    for (int j = 0; j < ny; j++) {
+      for (int i = 0; i < nx; i++)
+        points.push_back(start + ChVector<>(i * d, j * d, k * d));
+    }
+  }
+}
+
+
+// -----------------------------------------------------------------------------
+// ChHCPSampler
+//
+// Within a layer, points form a triangular lattice (rows offset by half the
+// separation on alternate rows). Alternate layers are shifted so that their
+// points sit above the holes of the layer below (ABAB stacking).
+// -----------------------------------------------------------------------------
+void ChHCPSampler::SampleBox(const ChVector<>& center,
+                             const ChVector<>& hdims,
+                             PointVector&      points)
+{
+  double d = m_separation;
+  if (d <= 0 || hdims.x < 0 || hdims.y < 0 || hdims.z < 0)
+    return;
+
+  double dy = d * std::sqrt(3.0) / 2;
+  double dz = d * std::sqrt(2.0 / 3.0);
+
+  ChVector<> lo = center - hdims;
+  ChVector<> hi = center + hdims;
+
+  int nz = (int) std::floor(2 * hdims.z / dz) + 1;
+
+  for (int k = 0; k < nz; k++) {
+    double z = lo.z + k * dz;
+    double layer_x = (k % 2) * d / 2;
+    double layer_y = (k % 2) * dy / 3;
+
+    for (int j = 0; ; j++) {
+      double y = lo.y + layer_y + j * dy;
+      if (y > hi.y)
+        break;
+
+      for (int i = 0; ; i++) {
+        double x = lo.x + layer_x + (j % 2) * d / 2 + i * d;
+        if (x > hi.x)
+          break;
+        points.push_back(ChVector<>(x, y, z));
+      }
+    }
+  }
+}
+
+
+// -----------------------------------------------------------------------------
+// ChPDSampler
+// -----------------------------------------------------------------------------
+void ChPDSampler::SampleBox(const ChVector<>& center,
+                            const ChVector<>& hdims,
+                            PointVector&      points)
+{
+  double r = m_separation;
+  if (r <= 0 || hdims.x < 0 || hdims.y < 0 || hdims.z < 0)
+    return;
+
+  ChVector<> lo = center - hdims;
+  ChVector<> size = hdims * 2;
+
+  // Background grid (cell index of the point in each cell, or -1).
+  double cell = r / std::sqrt(3.0);
+  int nx = (int) std::floor(size.x / cell) + 1;
+  int ny = (int) std::floor(size.y / cell) + 1;
+  int nz = (int) std::floor(size.z / cell) + 1;
+  std::vector<int> grid((size_t) nx * ny * nz, -1);
+
+  std::mt19937 rng(m_seed);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+  size_t first = points.size();
+  std::vector<int> active;
+
+  // Insert a point in the output and in the grid. Return false if the point
+  // is outside the box or too close to an existing point.
+  struct Inserter {
+    PointVector&       points;
+    std::vector<int>&  grid;
+    std::vector<int>&  active;
+    size_t             first;
+    ChVector<>         lo;
+    ChVector<>         size;
+    double             r;
+    double             cell;
+    int                nx, ny, nz;
+
+    bool operator()(const ChVector<>& p) {
+      ChVector<> q = p - lo;
+      if (q.x < 0 || q.y < 0 || q.z < 0 || q.x > size.x || q.y > size.y || q.z > size.z)
+        return false;
+
+      int ix = std::min((int) (q.x / cell), nx - 1);
+      int iy = std::min((int) (q.y / cell), ny - 1);
+      int iz = std::min((int) (q.z / cell), nz - 1);
+
+      // Points closer than r are at most 2 cells away along each axis.
+      for (int k = std::max(iz - 2, 0); k <= std::min(iz + 2, nz - 1); k++) {
+        for (int j = std::max(iy - 2, 0); j <= std::min(iy + 2, ny - 1); j++) {
+          for (int i = std::max(ix - 2, 0); i <= std::min(ix + 2, nx - 1); i++) {
+            int n = grid[((size_t) k * ny + j) * nx + i];
+            if (n >= 0 && (points[first + n] - p).Length2() < r * r)
+              return false;
+          }
+        }
+      }
+
+      int n = (int) (points.size() - first);
+      grid[((size_t) iz * ny + iy) * nx + ix] = n;
+      points.push_back(p);
+      active.push_back(n);
+      return true;
+    }
+  } insert = {points, grid, active, first, lo, size, r, cell, nx, ny, nz};
+
+  insert(lo + ChVector<>(uniform(rng) * size.x, uniform(rng) * size.y, uniform(rng) * size.z));
+
+  // Try candidates in the spherical shell [r, 2r] around a random active point;
+  // retire the point once all attempts failed.
+  while (!active.empty()) {
+    size_t a = (size_t) (uniform(rng) * active.size());
+    if (a >= active.size())
+      a = active.size() - 1;
+    ChVector<> base = points[first + active[a]];
+
+    bool found = false;
+    for (int t = 0; t < m_max_attempts && !found; t++) {
+      double cos_theta = 2 * uniform(rng) - 1;
+      double sin_theta = std::sqrt(1 - cos_theta * cos_theta);
+      double phi = 2 * CH_C_PI * uniform(rng);
+      double dist = r * (1 + uniform(rng));
+      ChVector<> dir(sin_theta * std::cos(phi), sin_theta * std::sin(phi), cos_theta);
+      found = insert(base + dir * dist);
+    }
+
+    if (!found) {
+      active[a] = active.back();
+      active.pop_back();
+    }
+  }
+}
+
+
+} // end namespace utils
+} // end namespace chrono
@@ -0,0 +1,127 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Radu Serban
+// =============================================================================
+//
+// Samplers generating sets of points with a prescribed minimum separation,
+// used to lay out non-overlapping particles.
+//
+// =============================================================================
+
+#ifndef CH_UTILS_SAMPLERS_H
+#define CH_UTILS_SAMPLERS_H
+
+#include <vector>
+
+#include "core/ChVector.h"
+
+#include "utils/ChApiUtils.h"
+
+
+namespace chrono {
+namespace utils {
+
+
+typedef std::vector<ChVector<> > PointVector;
+
+
+///
+/// Base class for samplers generating points in a box (specified by its center
+/// and half-dimensions) such that any two points are at least 'separation'
+/// apart. Generated points are appended to the output vector.
+///
+class CH_UTILS_API ChSampler
+{
+public:
+
+  ChSampler(double separation) : m_separation(separation) {}
+  virtual ~ChSampler() {}
+
+  /// Set/get the minimum distance between two points.
+  void SetSeparation(double separation) { m_separation = separation; }
+  double GetSeparation() const { return m_separation; }
+
+  /// Append sampled points in the specified box.
+  virtual void SampleBox(const ChVector<>& center,
+                         const ChVector<>& hdims,
+                         PointVector&      points) = 0;
+
+protected:
+
+  double  m_separation;
+};
+
+
+///
+/// Sampler on a regular cubic grid with spacing equal to the separation. The
+/// grid is centered in the box.
+///
+class CH_UTILS_API ChGridSampler : public ChSampler
+{
+public:
+
+  ChGridSampler(double separation) : ChSampler(separation) {}
+
+  virtual void SampleBox(const ChVector<>& center,
+                         const ChVector<>& hdims,
+                         PointVector&      points);
+};
+
+
+///
+/// Sampler on a hexagonal close packed lattice with nearest-neighbor distance
+/// equal to the separation (the densest packing of equal spheres). Layers are
+/// stacked along the Z axis.
+///
+class CH_UTILS_API ChHCPSampler : public ChSampler
+{
+public:
+
+  ChHCPSampler(double separation) : ChSampler(separation) {}
+
+  virtual void SampleBox(const ChVector<>& center,
+                         const ChVector<>& hdims,
+                         PointVector&      points);
+};
+
+
+///
+/// Poisson-disk sampler: a random, maximal set of points with the specified
+/// minimum separation (Bridson's algorithm). A background grid with cells of
+/// size separation/sqrt(3) holds at most one point per cell, so that each
+/// acceptance test only inspects a fixed neighborhood and the sampling runs
+/// in time linear in the number of points. The sequence of points is
+/// determined by the seed.
+///
+class CH_UTILS_API ChPDSampler : public ChSampler
+{
+public:
+
+  ChPDSampler(double separation, unsigned int seed = 0, int max_attempts = 30)
+  : ChSampler(separation), m_seed(seed), m_max_attempts(max_attempts) {}
+
+  virtual void SampleBox(const ChVector<>& center,
+                         const ChVector<>& hdims,
+                         PointVector&      points);
+
+private:
+
+  unsigned int  m_seed;
+  int           m_max_attempts;
+};
+
+
+} // end namespace utils
+} // end namespace chrono
+
+
+#endif
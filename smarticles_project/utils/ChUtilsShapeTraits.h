@@ -0,0 +1,317 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Radu Serban
+// =============================================================================
+//
+// Compile-time traits of primitive shapes (bounding radius, volume, gyration)
+// and batch evaluators over arrays of shapes.
+//
+// The shape parameters are passed as an array of values, in the order used
+// throughout the utilities (half-dimensions, radii, and half-lengths):
+//   SPHERE:     radius
+//   ELLIPSOID:  hdims.x, hdims.y, hdims.z
+//   BOX:        hdims.x, hdims.y, hdims.z
+//   CAPSULE:    radius, hlen
+//   CYLINDER:   radius, hlen
+//   ROUNDEDBOX: hdims.x, hdims.y, hdims.z, srad
+//   ROUNDEDCYL: radius, hlen, srad
+//
+// =============================================================================
+
+#ifndef CH_UTILS_SHAPE_TRAITS_H
+#define CH_UTILS_SHAPE_TRAITS_H
+
+#include <cmath>
+#include <cstddef>
+
+#include "core/ChMathematics.h"
+
+#include "collision/ChCCollisionModel.h"
+
+
+namespace chrono {
+namespace utils {
+
+
+// Maximum number of parameters of a primitive shape.
+const int SHAPE_MAX_PARAMS = 4;
+
+
+// -----------------------------------------------------------------------------
+// ChShapeTraits<TYPE>
+//
+// For each supported collision::ShapeType:
+//   num_params           number of shape parameters
+//   Bradius(p)           bounding radius (about the shape frame origin)
+//   Volume(p)            volume
+//   GyrationXX/YY/ZZ(p)  principal moments of the centroidal gyration tensor
+//                        (inertia per unit mass) in the shape frame
+// Functions that do not need a square root are constexpr, so that they are
+// evaluated at compile time for constant parameters.
+// -----------------------------------------------------------------------------
+template <int TYPE>
+struct ChShapeTraits;
+
+template <>
+struct ChShapeTraits<collision::SPHERE> {
+  static const int num_params = 1;
+
+  static constexpr double Bradius(const double* p) { return p[0]; }
+  static constexpr double Volume(const double* p) { return (4.0/3.0) * CH_C_PI * p[0] * p[0] * p[0]; }
+  static constexpr double GyrationXX(const double* p) { return (2.0/5.0) * p[0] * p[0]; }
+  static constexpr double GyrationYY(const double* p) { return (2.0/5.0) * p[0] * p[0]; }
+  static constexpr double GyrationZZ(const double* p) { return (2.0/5.0) * p[0] * p[0]; }
+};
+
+template <>
+struct ChShapeTraits<collision::ELLIPSOID> {
+  static const int num_params = 3;
+
+  static constexpr double Bradius(const double* p) {
+    return (p[0] > p[1]) ? (p[0] > p[2] ? p[0] : p[2]) : (p[1] > p[2] ? p[1] : p[2]);
+  }
+  static constexpr double Volume(const double* p) { return (4.0/3.0) * CH_C_PI * p[0] * p[1] * p[2]; }
+  static constexpr double GyrationXX(const double* p) { return (1.0/5.0) * (p[1] * p[1] + p[2] * p[2]); }
+  static constexpr double GyrationYY(const double* p) { return (1.0/5.0) * (p[2] * p[2] + p[0] * p[0]); }
+  static constexpr double GyrationZZ(const double* p) { return (1.0/5.0) * (p[0] * p[0] + p[1] * p[1]); }
+};
+
+template <>
+struct ChShapeTraits<collision::BOX> {
+  static const int num_params = 3;
+
+  static double Bradius(const double* p) { return std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]); }
+  static constexpr double Volume(const double* p) { return 8.0 * p[0] * p[1] * p[2]; }
+  static constexpr double GyrationXX(const double* p) { return (1.0/3.0) * (p[1] * p[1] + p[2] * p[2]); }
+  static constexpr double GyrationYY(const double* p) { return (1.0/3.0) * (p[2] * p[2] + p[0] * p[0]); }
+  static constexpr double GyrationZZ(const double* p) { return (1.0/3.0) * (p[0] * p[0] + p[1] * p[1]); }
+};
+
+// The capsule gyration is, for now, that of the circumscribed cylinder.
+template <>
+struct ChShapeTraits<collision::CAPSULE> {
+  static const int num_params = 2;
+
+  static constexpr double Bradius(const double* p) { return p[1] + p[0]; }
+  static constexpr double Volume(const double* p) {
+    return 2.0 * CH_C_PI * (p[0] * p[0] * p[1] + (2.0/3.0) * p[0] * p[0] * p[0]);
+  }
+  static constexpr double GyrationXX(const double* p) {
+    return (1.0/12.0) * (3 * p[0] * p[0] + 4 * (p[1] + p[0]) * (p[1] + p[0]));
+  }
+  static constexpr double GyrationYY(const double* p) { return (1.0/2.0) * (p[0] * p[0]); }
+  static constexpr double GyrationZZ(const double* p) { return GyrationXX(p); }
+};
+
+template <>
+struct ChShapeTraits<collision::CYLINDER> {
+  static const int num_params = 2;
+
+  static double Bradius(const double* p) { return std::sqrt(p[1] * p[1] + p[0] * p[0]); }
+  static constexpr double Volume(const double* p) { return 2.0 * CH_C_PI * p[0] * p[0] * p[1]; }
+  static constexpr double GyrationXX(const double* p) { return (1.0/12.0) * (3 * p[0] * p[0] + 4 * p[1] * p[1]); }
+  static constexpr double GyrationYY(const double* p) { return (1.0/2.0) * (p[0] * p[0]); }
+  static constexpr double GyrationZZ(const double* p) { return GyrationXX(p); }
+};
+
+// The rounded box gyration is, for now, that of the skeleton box.
+template <>
+struct ChShapeTraits<collision::ROUNDEDBOX> {
+  static const int num_params = 4;
+
+  static double Bradius(const double* p) { return std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]) + p[3]; }
+  static constexpr double Volume(const double* p) {
+    return 8 * p[0] * p[1] * p[2] +
+           2 * p[3] * (p[0] * p[1] + p[1] * p[2] + p[2] * p[0]) +
+           (4.0 * CH_C_PI / 3.0) * p[3] * p[3] * p[3];
+  }
+  static constexpr double GyrationXX(const double* p) { return ChShapeTraits<collision::BOX>::GyrationXX(p); }
+  static constexpr double GyrationYY(const double* p) { return ChShapeTraits<collision::BOX>::GyrationYY(p); }
+  static constexpr double GyrationZZ(const double* p) { return ChShapeTraits<collision::BOX>::GyrationZZ(p); }
+};
+
+// The rounded cylinder gyration is, for now, that of the skeleton cylinder.
+template <>
+struct ChShapeTraits<collision::ROUNDEDCYL> {
+  static const int num_params = 3;
+
+  static double Bradius(const double* p) { return std::sqrt(p[1] * p[1] + p[0] * p[0]) + p[2]; }
+  static constexpr double Volume(const double* p) {
+    return 2.0 * CH_C_PI * ((p[0] + p[2]) * (p[0] + p[2]) * p[1] +
+                            p[2] * (p[0] * p[0] + (2.0/3.0) * p[2] * p[2]) +
+                            (CH_C_PI/2.0 - 1.0) * p[0] * p[2] * p[2]);
+  }
+  static constexpr double GyrationXX(const double* p) { return ChShapeTraits<collision::CYLINDER>::GyrationXX(p); }
+  static constexpr double GyrationYY(const double* p) { return ChShapeTraits<collision::CYLINDER>::GyrationYY(p); }
+  static constexpr double GyrationZZ(const double* p) { return ChShapeTraits<collision::CYLINDER>::GyrationZZ(p); }
+};
+
+
+// -----------------------------------------------------------------------------
+// Batch evaluators over arrays of shapes of the same type.
+// The parameters of the n shapes are packed in 'params' (num_params values per
+// shape). The loops contain no branches on the shape type, so that they can be
+// vectorized.
+// -----------------------------------------------------------------------------
+template <int TYPE>
+inline void CalcBradii(const double* params, size_t n, double* bradii)
+{
+  typedef ChShapeTraits<TYPE> Traits;
+  for (size_t i = 0; i < n; i++)
+    bradii[i] = Traits::Bradius(params + i * Traits::num_params);
+}
+
+template <int TYPE>
+inline void CalcVolumes(const double* params, size_t n, double* volumes)
+{
+  typedef ChShapeTraits<TYPE> Traits;
+  for (size_t i = 0; i < n; i++)
+    volumes[i] = Traits::Volume(params + i * Traits::num_params);
+}
+
+// The principal gyrations are returned in 3 consecutive values per shape.
+template <int TYPE>
+inline void CalcGyrations(const double* params, size_t n, double* gyrations)
+{
+  typedef ChShapeTraits<TYPE> Traits;
+  for (size_t i = 0; i < n; i++) {
+    const double* p = params + i * Traits::num_params;
+    gyrations[3 * i + 0] = Traits::GyrationXX(p);
+    gyrations[3 * i + 1] = Traits::GyrationYY(p);
+    gyrations[3 * i + 2] = Traits::GyrationZZ(p);
+  }
+}
+
+
+// -----------------------------------------------------------------------------
+// ChShape
+//
+// Tagged primitive shape: a shape type and its parameters. Arrays of shapes of
+// different types are evaluated run by run: the shape type is dispatched once
+// for each run of consecutive shapes of the same type, and the homogeneous
+// kernels are applied to the run (sort an array by type for best results).
+// -----------------------------------------------------------------------------
+struct ChShape {
+  int     type;                       ///< collision::ShapeType
+  double  params[SHAPE_MAX_PARAMS];
+
+  static ChShape Sphere(double radius)                                      { return Make(collision::SPHERE, radius); }
+  static ChShape Ellipsoid(double hx, double hy, double hz)                 { return Make(collision::ELLIPSOID, hx, hy, hz); }
+  static ChShape Box(double hx, double hy, double hz)                       { return Make(collision::BOX, hx, hy, hz); }
+  static ChShape Capsule(double radius, double hlen)                        { return Make(collision::CAPSULE, radius, hlen); }
+  static ChShape Cylinder(double radius, double hlen)                       { return Make(collision::CYLINDER, radius, hlen); }
+  static ChShape RoundedBox(double hx, double hy, double hz, double srad)   { return Make(collision::ROUNDEDBOX, hx, hy, hz, srad); }
+  static ChShape RoundedCylinder(double radius, double hlen, double srad)   { return Make(collision::ROUNDEDCYL, radius, hlen, srad); }
+
+  static ChShape Make(int type, double p0, double p1 = 0, double p2 = 0, double p3 = 0) {
+    ChShape shape = {type, {p0, p1, p2, p3}};
+    return shape;
+  }
+};
+
+// Kernels applied to runs of shapes of the same type, with 'num_out' output
+// values per shape.
+template <int TYPE>
+struct ChShapeBradiusKernel {
+  static const int num_out = 1;
+  static void Run(const ChShape* shapes, size_t n, double* out) {
+    for (size_t i = 0; i < n; i++)
+      out[i] = ChShapeTraits<TYPE>::Bradius(shapes[i].params);
+  }
+};
+
+template <int TYPE>
+struct ChShapeVolumeKernel {
+  static const int num_out = 1;
+  static void Run(const ChShape* shapes, size_t n, double* out) {
+    for (size_t i = 0; i < n; i++)
+      out[i] = ChShapeTraits<TYPE>::Volume(shapes[i].params);
+  }
+};
+
+template <int TYPE>
+struct ChShapeGyrationKernel {
+  static const int num_out = 3;
+  static void Run(const ChShape* shapes, size_t n, double* out) {
+    for (size_t i = 0; i < n; i++) {
+      out[3 * i + 0] = ChShapeTraits<TYPE>::GyrationXX(shapes[i].params);
+      out[3 * i + 1] = ChShapeTraits<TYPE>::GyrationYY(shapes[i].params);
+      out[3 * i + 2] = ChShapeTraits<TYPE>::GyrationZZ(shapes[i].params);
+    }
+  }
+};
+
+// Apply the specified kernel to a run of shapes of the given type.
+// Return false if the shape type is not supported.
+template <template <int> class KERNEL>
+inline bool DispatchShapeRun(int type, const ChShape* shapes, size_t n, double* out)
+{
+  switch (type) {
+  case collision::SPHERE:     KERNEL<collision::SPHERE>::Run(shapes, n, out); return true;
+  case collision::ELLIPSOID:  KERNEL<collision::ELLIPSOID>::Run(shapes, n, out); return true;
+  case collision::BOX:        KERNEL<collision::BOX>::Run(shapes, n, out); return true;
+  case collision::CAPSULE:    KERNEL<collision::CAPSULE>::Run(shapes, n, out); return true;
+  case collision::CYLINDER:   KERNEL<collision::CYLINDER>::Run(shapes, n, out); return true;
+  case collision::ROUNDEDBOX: KERNEL<collision::ROUNDEDBOX>::Run(shapes, n, out); return true;
+  case collision::ROUNDEDCYL: KERNEL<collision::ROUNDEDCYL>::Run(shapes, n, out); return true;
+  default:                    return false;
+  }
+}
+
+// Apply the specified kernel to an array of shapes, run by run. The outputs
+// of shapes of unsupported types are set to 0. Return the number of such
+// shapes.
+template <template <int> class KERNEL>
+inline size_t EvaluateShapes(const ChShape* shapes, size_t n, double* out)
+{
+  const int num_out = KERNEL<collision::SPHERE>::num_out;
+  size_t num_unsupported = 0;
+
+  size_t start = 0;
+  while (start < n) {
+    size_t end = start + 1;
+    while (end < n && shapes[end].type == shapes[start].type)
+      end++;
+
+    if (!DispatchShapeRun<KERNEL>(shapes[start].type, shapes + start, end - start, out + num_out * start)) {
+      for (size_t i = num_out * start; i < num_out * end; i++)
+        out[i] = 0;
+      num_unsupported += end - start;
+    }
+
+    start = end;
+  }
+
+  return num_unsupported;
+}
+
+inline size_t CalcShapeBradii(const ChShape* shapes, size_t n, double* bradii)
+{
+  return EvaluateShapes<ChShapeBradiusKernel>(shapes, n, bradii);
+}
+
+inline size_t CalcShapeVolumes(const ChShape* shapes, size_t n, double* volumes)
+{
+  return EvaluateShapes<ChShapeVolumeKernel>(shapes, n, volumes);
+}
+
+inline size_t CalcShapeGyrations(const ChShape* shapes, size_t n, double* gyrations)
+{
+  return EvaluateShapes<ChShapeGyrationKernel>(shapes, n, gyrations);
+}
+
+
+} // end namespace utils
+} // end namespace chrono
+
+
+#endif
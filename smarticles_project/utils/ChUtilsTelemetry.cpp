@@ -0,0 +1,438 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Radu Serban
+// =============================================================================
+//
+// Live telemetry of selected body states over a local socket or pipe.
+//
+// A telemetry packet consists of a header: magic "CHTM", sequence number
+// (u32), simulation time (f64), number of bodies (u32), size of a body state
+// (u32), followed by the body states (see ChTelemetryBodyState).
+//
+// =============================================================================
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "utils/ChUtilsTelemetry.h"
+
+namespace chrono {
+namespace utils {
+
+
+static const char   TELEMETRY_MAGIC[4] = {'C', 'H', 'T', 'M'};
+static const size_t TELEMETRY_HEADER_SIZE = 24;
+
+
+// -----------------------------------------------------------------------------
+// ChTelemetryPublisher
+// -----------------------------------------------------------------------------
+ChTelemetryPublisher::ChTelemetryPublisher()
+: m_seq(0),
+  m_num_sent(0),
+  m_num_dropped(0),
+#ifdef _WIN32
+  m_pipe(INVALID_HANDLE_VALUE),
+  m_connected(false)
+#else
+  m_socket(-1)
+#endif
+{
+}
+
+std::string ChTelemetryPublisher::GetEndpointPath(const std::string& name)
+{
+#ifdef _WIN32
+  return "\\\\.\\pipe\\" + name;
+#else
+  if (name.find('/') != std::string::npos)
+    return name;
+  return "/tmp/" + name + ".sock";
+#endif
+}
+
+bool ChTelemetryPublisher::AddBody(ChBody* body)
+{
+  size_t size = TELEMETRY_HEADER_SIZE + (m_bodies.size() + 1) * sizeof(ChTelemetryBodyState);
+  if (size > TELEMETRY_MAX_PACKET)
+    return false;
+
+  m_bodies.push_back(body);
+  return true;
+}
+
+bool ChTelemetryPublisher::Publish(double time)
+{
+  uint32_t num_bodies = (uint32_t) m_bodies.size();
+  uint32_t state_size = (uint32_t) sizeof(ChTelemetryBodyState);
+
+  m_buffer.resize(TELEMETRY_HEADER_SIZE + num_bodies * sizeof(ChTelemetryBodyState));
+  char* p = &m_buffer[0];
+
+  std::memcpy(p, TELEMETRY_MAGIC, 4);
+  std::memcpy(p + 4, &m_seq, 4);
+  std::memcpy(p + 8, &time, 8);
+  std::memcpy(p + 16, &num_bodies, 4);
+  std::memcpy(p + 20, &state_size, 4);
+
+  ChTelemetryBodyState* states = (ChTelemetryBodyState*) (p + TELEMETRY_HEADER_SIZE);
+
+  for (uint32_t i = 0; i < num_bodies; i++) {
+    ChBody* body = m_bodies[i];
+    const ChVector<>&     pos = body->GetPos();
+    const ChVector<>&     vel = body->GetPos_dt();
+    const ChVector<>&     acc = body->GetPos_dtdt();
+    const ChQuaternion<>& rot = body->GetRot();
+
+    ChTelemetryBodyState& s = states[i];
+    s.id = body->GetIdentifier();
+    s.pos[0] = (float) pos.x;  s.pos[1] = (float) pos.y;  s.pos[2] = (float) pos.z;
+    s.vel[0] = (float) vel.x;  s.vel[1] = (float) vel.y;  s.vel[2] = (float) vel.z;
+    s.acc[0] = (float) acc.x;  s.acc[1] = (float) acc.y;  s.acc[2] = (float) acc.z;
+    s.rot[0] = (float) rot.e0; s.rot[1] = (float) rot.e1; s.rot[2] = (float) rot.e2; s.rot[3] = (float) rot.e3;
+  }
+
+  // Sequence numbers advance also for dropped samples, so that the subscriber
+  // can detect them.
+  m_seq++;
+
+  if (Send()) {
+    m_num_sent++;
+    return true;
+  }
+
+  m_num_dropped++;
+  return false;
+}
+
+#ifdef _WIN32
+
+bool ChTelemetryPublisher::Open(const std::string& name)
+{
+  Close();
+
+  m_path = GetEndpointPath(name);
+
+  HANDLE pipe = CreateNamedPipeA(m_path.c_str(),
+                                 PIPE_ACCESS_OUTBOUND,
+                                 PIPE_TYPE_MESSAGE | PIPE_NOWAIT,
+                                 1,
+                                 4 * TELEMETRY_MAX_PACKET,
+                                 0,
+                                 0,
+                                 NULL);
+  if (pipe == INVALID_HANDLE_VALUE)
+    return false;
+
+  m_pipe = pipe;
+  m_connected = false;
+
+  return true;
+}
+
+void ChTelemetryPublisher::Close()
+{
+  if (m_pipe != INVALID_HANDLE_VALUE) {
+    if (m_connected)
+      DisconnectNamedPipe((HANDLE) m_pipe);
+    CloseHandle((HANDLE) m_pipe);
+  }
+
+  m_pipe = INVALID_HANDLE_VALUE;
+  m_connected = false;
+}
+
+bool ChTelemetryPublisher::Send()
+{
+  if (m_pipe == INVALID_HANDLE_VALUE)
+    return false;
+
+  // In non-blocking mode, this only checks for a connected subscriber.
+  if (!m_connected) {
+    if (ConnectNamedPipe((HANDLE) m_pipe, NULL) || GetLastError() == ERROR_PIPE_CONNECTED)
+      m_connected = true;
+    else
+      return false;
+  }
+
+  // With a full pipe buffer, nothing is written.
+  DWORD written = 0;
+  if (!WriteFile((HANDLE) m_pipe, &m_buffer[0], (DWORD) m_buffer.size(), &written, NULL)) {
+    // The subscriber went away; wait for a new one.
+    DisconnectNamedPipe((HANDLE) m_pipe);
+    m_connected = false;
+    return false;
+  }
+
+  return written == m_buffer.size();
+}
+
+#else
+
+bool ChTelemetryPublisher::Open(const std::string& name)
+{
+  Close();
+
+  m_path = GetEndpointPath(name);
+  if (m_path.size() >= sizeof(((sockaddr_un*) 0)->sun_path))
+    return false;
+
+  m_socket = socket(AF_UNIX, SOCK_DGRAM, 0);
+  if (m_socket < 0)
+    return false;
+
+  fcntl(m_socket, F_SETFL, fcntl(m_socket, F_GETFL, 0) | O_NONBLOCK);
+
+  return true;
+}
+
+void ChTelemetryPublisher::Close()
+{
+  if (m_socket >= 0)
+    close(m_socket);
+
+  m_socket = -1;
+}
+
+bool ChTelemetryPublisher::Send()
+{
+  if (m_socket < 0)
+    return false;
+
+  sockaddr_un addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  std::memcpy(addr.sun_path, m_path.c_str(), m_path.size());
+
+  // Fails immediately (EAGAIN, ENOBUFS) if the subscriber queue is full, or
+  // (ENOENT, ECONNREFUSED) if there is no subscriber.
+  ssize_t n = sendto(m_socket, &m_buffer[0], m_buffer.size(), 0, (const sockaddr*) &addr, sizeof(addr));
+
+  return n == (ssize_t) m_buffer.size();
+}
+
+#endif
+
+
+// -----------------------------------------------------------------------------
+// ChTelemetrySubscriber
+// -----------------------------------------------------------------------------
+ChTelemetrySubscriber::ChTelemetrySubscriber()
+: m_buffer(TELEMETRY_MAX_PACKET),
+  m_has_seq(false),
+  m_last_seq(0),
+  m_num_lost(0),
+  m_num_invalid(0),
+#ifdef _WIN32
+  m_pipe(INVALID_HANDLE_VALUE)
+#else
+  m_socket(-1)
+#endif
+{
+}
+
+#ifdef _WIN32
+
+bool ChTelemetrySubscriber::Open(const std::string& name)
+{
+  Close();
+
+  m_path = ChTelemetryPublisher::GetEndpointPath(name);
+
+  HANDLE pipe = CreateFileA(m_path.c_str(), GENERIC_READ | FILE_WRITE_ATTRIBUTES, 0, NULL, OPEN_EXISTING, 0, NULL);
+  if (pipe == INVALID_HANDLE_VALUE)
+    return false;
+
+  DWORD mode = PIPE_READMODE_MESSAGE;
+  SetNamedPipeHandleState(pipe, &mode, NULL, NULL);
+
+  m_pipe = pipe;
+  m_has_seq = false;
+  m_num_lost = 0;
+  m_num_invalid = 0;
+
+  return true;
+}
+
+void ChTelemetrySubscriber::Close()
+{
+  if (m_pipe != INVALID_HANDLE_VALUE)
+    CloseHandle((HANDLE) m_pipe);
+
+  m_pipe = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+bool ChTelemetrySubscriber::Open(const std::string& name)
+{
+  Close();
+
+  m_path = ChTelemetryPublisher::GetEndpointPath(name);
+  if (m_path.size() >= sizeof(((sockaddr_un*) 0)->sun_path))
+    return false;
+
+  m_socket = socket(AF_UNIX, SOCK_DGRAM, 0);
+  if (m_socket < 0)
+    return false;
+
+  // Remove a stale socket file left behind by a previous subscriber.
+  unlink(m_path.c_str());
+
+  sockaddr_un addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  std::memcpy(addr.sun_path, m_path.c_str(), m_path.size());
+
+  if (bind(m_socket, (const sockaddr*) &addr, sizeof(addr)) != 0) {
+    close(m_socket);
+    m_socket = -1;
+    return false;
+  }
+
+  m_has_seq = false;
+  m_num_lost = 0;
+  m_num_invalid = 0;
+
+  return true;
+}
+
+void ChTelemetrySubscriber::Close()
+{
+  if (m_socket >= 0) {
+    close(m_socket);
+    unlink(m_path.c_str());
+  }
+
+  m_socket = -1;
+}
+
+#endif
+
+// Wait at most 'timeout_ms' milliseconds for the next packet and read it into
+// the buffer. Return false on timeout or error.
+bool ChTelemetrySubscriber::ReadPacket(size_t& size, int timeout_ms)
+{
+#ifdef _WIN32
+  if (m_pipe == INVALID_HANDLE_VALUE)
+    return false;
+
+  // Poll the pipe until a message is available.
+  DWORD available = 0;
+  DWORD start = GetTickCount();
+  for (;;) {
+    if (!PeekNamedPipe((HANDLE) m_pipe, NULL, 0, NULL, &available, NULL))
+      return false;
+    if (available > 0)
+      break;
+    if ((int) (GetTickCount() - start) >= timeout_ms)
+      return false;
+    Sleep(1);
+  }
+
+  DWORD n = 0;
+  if (!ReadFile((HANDLE) m_pipe, &m_buffer[0], (DWORD) m_buffer.size(), &n, NULL))
+    return false;
+  size = n;
+#else
+  if (m_socket < 0)
+    return false;
+
+  pollfd pfd;
+  pfd.fd = m_socket;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+  if (poll(&pfd, 1, timeout_ms) <= 0)
+    return false;
+
+  ssize_t n = recv(m_socket, &m_buffer[0], m_buffer.size(), 0);
+  if (n < 0)
+    return false;
+  size = (size_t) n;
+#endif
+
+  return true;
+}
+
+// Decode the packet in the buffer. Return false if it is not a valid
+// telemetry packet.
+bool ChTelemetrySubscriber::ParsePacket(size_t size, ChTelemetrySample& sample)
+{
+  const char* p = &m_buffer[0];
+  if (size < TELEMETRY_HEADER_SIZE || std::memcmp(p, TELEMETRY_MAGIC, 4) != 0)
+    return false;
+
+  uint32_t num_bodies, state_size;
+  std::memcpy(&sample.seq, p + 4, 4);
+  std::memcpy(&sample.time, p + 8, 8);
+  std::memcpy(&num_bodies, p + 16, 4);
+  std::memcpy(&state_size, p + 20, 4);
+
+  if (state_size != sizeof(ChTelemetryBodyState) ||
+      size != TELEMETRY_HEADER_SIZE + (size_t) num_bodies * state_size)
+    return false;
+
+  sample.bodies.resize(num_bodies);
+  if (num_bodies > 0)
+    std::memcpy(&sample.bodies[0], p + TELEMETRY_HEADER_SIZE, num_bodies * state_size);
+
+  if (m_has_seq)
+    m_num_lost += sample.seq - m_last_seq - 1;
+  m_has_seq = true;
+  m_last_seq = sample.seq;
+
+  return true;
+}
+
+// Packets that are not valid telemetry samples (e.g. stray datagrams from
+// another sender) are counted and skipped; the subscriber keeps waiting for a
+// valid sample until the timeout expires.
+bool ChTelemetrySubscriber::Receive(ChTelemetrySample& sample, int timeout_ms)
+{
+  std::chrono::steady_clock::time_point deadline =
+    std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+
+  int remaining = timeout_ms;
+
+  for (;;) {
+    size_t size = 0;
+    if (!ReadPacket(size, remaining))
+      return false;
+
+    if (ParsePacket(size, sample))
+      return true;
+
+    m_num_invalid++;
+
+    if (timeout_ms >= 0) {
+      std::chrono::steady_clock::duration left = deadline - std::chrono::steady_clock::now();
+      remaining = std::max(0, (int) std::chrono::duration_cast<std::chrono::milliseconds>(left).count());
+    }
+  }
+}
+
+
+}  // namespace utils
+}  // namespace chrono
@@ -0,0 +1,177 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Radu Serban
+// =============================================================================
+//
+// Live telemetry of selected body states over a local socket or pipe.
+//
+// =============================================================================
+
+#ifndef CH_UTILS_TELEMETRY_H
+#define CH_UTILS_TELEMETRY_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "physics/ChSystem.h"
+
+#include "utils/ChApiUtils.h"
+
+
+namespace chrono {
+namespace utils {
+
+
+// Maximum size of a telemetry packet (a sample of all selected bodies).
+const size_t TELEMETRY_MAX_PACKET = 65536;
+
+
+///
+/// State of one body in a telemetry sample (single precision).
+///
+struct CH_UTILS_API ChTelemetryBodyState {
+  int32_t  id;
+  float    pos[3];
+  float    vel[3];
+  float    acc[3];
+  float    rot[4];
+};
+
+
+///
+/// Telemetry sample: states of the selected bodies at a given time.
+///
+struct CH_UTILS_API ChTelemetrySample {
+  uint32_t                           seq;      ///< sample sequence number
+  double                             time;     ///< simulation time
+  std::vector<ChTelemetryBodyState>  bodies;
+};
+
+
+///
+/// Publisher of telemetry samples.
+/// Each sample is sent as a single packet (a 24-byte header followed by the
+/// body states, in native byte order) to a local endpoint: a Unix domain
+/// datagram socket on POSIX systems, a message-mode named pipe on Windows.
+/// Sending never blocks: if no subscriber is listening, or if the subscriber
+/// does not keep up and the socket or pipe buffer is full, the sample is
+/// dropped. The cost of publishing is therefore bounded and independent of
+/// the subscriber.
+///
+class CH_UTILS_API ChTelemetryPublisher
+{
+public:
+
+  ChTelemetryPublisher();
+  ~ChTelemetryPublisher() { Close(); }
+
+  /// Open the endpoint with the specified name (see GetEndpointPath).
+  /// On Windows, the pipe is created by the publisher, so the publisher must
+  /// be started before the subscriber.
+  bool Open(const std::string& name);
+
+  /// Close the endpoint.
+  void Close();
+
+  /// Add a body to the set of published bodies.
+  /// Return false if the packet would exceed the maximum size.
+  bool AddBody(ChBody* body);
+
+  /// Send a sample of the selected bodies. Return false if it was dropped.
+  bool Publish(double time);
+
+  /// Return the number of samples sent so far.
+  size_t GetNumSent() const { return m_num_sent; }
+  /// Return the number of samples dropped so far.
+  size_t GetNumDropped() const { return m_num_dropped; }
+
+  /// Return the platform-specific path of the endpoint with the given name:
+  /// "/tmp/[name].sock" on POSIX systems (unless the name contains a '/', in
+  /// which case it is used as is), "\\.\pipe\[name]" on Windows.
+  static std::string GetEndpointPath(const std::string& name);
+
+private:
+
+  bool Send();
+
+  std::vector<ChBody*>  m_bodies;
+  std::vector<char>     m_buffer;
+  std::string           m_path;
+  uint32_t              m_seq;
+  size_t                m_num_sent;
+  size_t                m_num_dropped;
+
+#ifdef _WIN32
+  void*                 m_pipe;
+  bool                  m_connected;
+#else
+  int                   m_socket;
+#endif
+};
+
+
+///
+/// Subscriber for telemetry samples sent by a ChTelemetryPublisher.
+///
+class CH_UTILS_API ChTelemetrySubscriber
+{
+public:
+
+  ChTelemetrySubscriber();
+  ~ChTelemetrySubscriber() { Close(); }
+
+  /// Open the endpoint with the specified name (see
+  /// ChTelemetryPublisher::GetEndpointPath).
+  bool Open(const std::string& name);
+
+  /// Close the endpoint.
+  void Close();
+
+  /// Wait at most 'timeout_ms' milliseconds for the next valid sample.
+  /// Invalid packets received in the meantime are skipped (see
+  /// GetNumInvalid). Return false on timeout or if the endpoint fails.
+  bool Receive(ChTelemetrySample& sample, int timeout_ms);
+
+  /// Return the number of samples lost so far (dropped by the publisher),
+  /// as inferred from gaps in the sequence numbers.
+  size_t GetNumLost() const { return m_num_lost; }
+
+  /// Return the number of packets skipped so far because they were not valid
+  /// telemetry samples.
+  size_t GetNumInvalid() const { return m_num_invalid; }
+
+private:
+
+  bool ReadPacket(size_t& size, int timeout_ms);
+  bool ParsePacket(size_t size, ChTelemetrySample& sample);
+
+  std::vector<char>     m_buffer;
+  std::string           m_path;
+  bool                  m_has_seq;
+  uint32_t              m_last_seq;
+  size_t                m_num_lost;
+  size_t                m_num_invalid;
+
+#ifdef _WIN32
+  void*                 m_pipe;
+#else
+  int                   m_socket;
+#endif
+};
+
+
+} // namespace utils
+} // namespace chrono
+
+
+#endif
@@ -0,0 +1,536 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Radu Serban
+// =============================================================================
+//
+// Compressed trajectory streams of PovRay output frames.
+//
+// A trajectory is a sequence of records, each starting with its length (as a
+// variable-length integer) followed by its kind (one byte) and payload:
+//    keyframe:  the frame in the binary frame format (see PackShapesBinary)
+//    delta:     numbers of bodies, assets, and link data values (varints),
+//               bit-packed active flags of bodies and assets, then, as zig-zag
+//               varints, the differences between the quantized positions and
+//               the quantized keyframe positions (bodies, assets), the
+//               rotations (bodies, assets), and the link data differences.
+// A rotation is stored as the index of the dropped component (varint) followed
+// by the three other quantized components. If the index is the same as in the
+// keyframe, the components are stored as differences from the keyframe.
+//
+// =============================================================================
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <stdint.h>
+
+#include "utils/ChUtilsTrajectory.h"
+
+namespace chrono {
+namespace utils {
+
+
+static const char     TRAJECTORY_MAGIC[4] = { 'C', 'H', 'T', 'R' };
+static const uint32_t TRAJECTORY_VERSION = 1;
+
+enum TrajectoryRecordKind {
+  RECORD_KEYFRAME = 0,
+  RECORD_DELTA = 1
+};
+
+
+// -----------------------------------------------------------------------------
+// Variable-length and zig-zag integer encoding
+// -----------------------------------------------------------------------------
+static void PutVarint(std::vector<char>& buffer, uint64_t v)
+{
+  while (v >= 0x80) {
+    buffer.push_back((char) ((v & 0x7F) | 0x80));
+    v >>= 7;
+  }
+  buffer.push_back((char) v);
+}
+
+static bool GetVarint(const char*& cur, const char* end, uint64_t& v)
+{
+  v = 0;
+  for (int shift = 0; shift < 64 && cur < end; shift += 7) {
+    unsigned char b = (unsigned char) *cur++;
+    v |= (uint64_t) (b & 0x7F) << shift;
+    if (!(b & 0x80))
+      return true;
+  }
+  return false;
+}
+
+static void PutZigzag(std::vector<char>& buffer, long long v)
+{
+  PutVarint(buffer, ((uint64_t) v << 1) ^ (uint64_t) (v >> 63));
+}
+
+static bool GetZigzag(const char*& cur, const char* end, long long& v)
+{
+  uint64_t u;
+  if (!GetVarint(cur, end, u))
+    return false;
+  v = (long long) (u >> 1) ^ -(long long) (u & 1);
+  return true;
+}
+
+// Fixed-size little-endian values (file header only).
+template <typename T>
+static void PutRaw(std::vector<char>& buffer, T value)
+{
+  unsigned char bytes[sizeof(T)];
+  std::memcpy(bytes, &value, sizeof(T));
+  const uint16_t one = 1;
+  if (*reinterpret_cast<const unsigned char*>(&one) != 1)
+    std::reverse(bytes, bytes + sizeof(T));
+  buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+static bool GetRaw(const char*& cur, const char* end, T& value)
+{
+  if ((size_t) (end - cur) < sizeof(T))
+    return false;
+  unsigned char bytes[sizeof(T)];
+  std::memcpy(bytes, cur, sizeof(T));
+  const uint16_t one = 1;
+  if (*reinterpret_cast<const unsigned char*>(&one) != 1)
+    std::reverse(bytes, bytes + sizeof(T));
+  std::memcpy(&value, bytes, sizeof(T));
+  cur += sizeof(T);
+  return true;
+}
+
+
+// -----------------------------------------------------------------------------
+// Quantization
+//
+// The position quantization step is twice the tolerance, so that rounding to
+// the nearest step never exceeds the tolerance. The dropped quaternion component
+// (at least 0.5 in magnitude) is reconstructed from the other three, which
+// amplifies their error by up to a factor of 3 (plus second-order terms); the
+// rotation quantization step is therefore half the tolerance.
+// -----------------------------------------------------------------------------
+static long long Quantize(double v, double step)
+{
+  return (long long) std::floor(v / step + 0.5);
+}
+
+// Quantize a quaternion in smallest-three form. The dropped component is the
+// one with the given index 'hint' if it is large enough (so that consecutive
+// frames tend to use the same index), or the largest one otherwise. The sign
+// is chosen so that the dropped component is positive.
+static unsigned char QuantizeRotation(const double* q, double step, int hint, long long* c)
+{
+  double n = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+  double u[4] = { 1, 0, 0, 0 };
+  if (n > 0) {
+    for (int k = 0; k < 4; k++)
+      u[k] = q[k] / n;
+  }
+
+  int idx = hint;
+  if (idx < 0 || std::abs(u[idx]) < 0.5) {
+    idx = 0;
+    for (int k = 1; k < 4; k++) {
+      if (std::abs(u[k]) > std::abs(u[idx]))
+        idx = k;
+    }
+  }
+
+  double s = (u[idx] < 0) ? -1 : 1;
+  for (int k = 0, j = 0; k < 4; k++) {
+    if (k != idx)
+      c[j++] = Quantize(s * u[k], step);
+  }
+
+  return (unsigned char) idx;
+}
+
+static void DequantizeRotation(unsigned char idx, const long long* c, double step, double* q)
+{
+  double sum = 0;
+  for (int k = 0, j = 0; k < 4; k++) {
+    if (k == idx)
+      continue;
+    q[k] = c[j++] * step;
+    sum += q[k] * q[k];
+  }
+  q[idx] = std::sqrt(std::max(0.0, 1 - sum));
+}
+
+// Access all position values of a frame (body positions, asset positions, link
+// data) and all rotations (bodies, assets), in encoding order.
+static size_t NumPositions(const ShapesFrame& frame)
+{
+  return frame.body_pos.size() + frame.asset_pos.size() + frame.link_params.size();
+}
+
+static double GetPosition(const ShapesFrame& frame, size_t i)
+{
+  if (i < frame.body_pos.size())
+    return frame.body_pos[i];
+  i -= frame.body_pos.size();
+  if (i < frame.asset_pos.size())
+    return frame.asset_pos[i];
+  return frame.link_params[i - frame.asset_pos.size()];
+}
+
+static double* PositionRef(ShapesFrame& frame, size_t i)
+{
+  if (i < frame.body_pos.size())
+    return &frame.body_pos[i];
+  i -= frame.body_pos.size();
+  if (i < frame.asset_pos.size())
+    return &frame.asset_pos[i];
+  return &frame.link_params[i - frame.asset_pos.size()];
+}
+
+static size_t NumRotations(const ShapesFrame& frame)
+{
+  return frame.GetNumBodies() + frame.GetNumAssets();
+}
+
+static const double* GetRotation(const ShapesFrame& frame, size_t i)
+{
+  size_t nb = frame.GetNumBodies();
+  return (i < nb) ? &frame.body_rot[4 * i] : &frame.asset_rot[4 * (i - nb)];
+}
+
+static double* RotationRef(ShapesFrame& frame, size_t i)
+{
+  size_t nb = frame.GetNumBodies();
+  return (i < nb) ? &frame.body_rot[4 * i] : &frame.asset_rot[4 * (i - nb)];
+}
+
+
+// -----------------------------------------------------------------------------
+// ChTrajectoryKeyframe
+// -----------------------------------------------------------------------------
+void ChTrajectoryKeyframe::Set(const ShapesFrame& key, double pos_step, double rot_step)
+{
+  frame = key;
+
+  size_t np = NumPositions(frame);
+  pos.resize(np);
+  for (size_t i = 0; i < np; i++)
+    pos[i] = Quantize(GetPosition(frame, i), pos_step);
+
+  size_t nr = NumRotations(frame);
+  rot.resize(3 * nr);
+  rot_index.resize(nr);
+  for (size_t i = 0; i < nr; i++)
+    rot_index[i] = QuantizeRotation(GetRotation(frame, i), rot_step, -1, &rot[3 * i]);
+}
+
+bool ChTrajectoryKeyframe::Matches(const ShapesFrame& other) const
+{
+  return frame.static_ref == other.static_ref &&
+         frame.body_id == other.body_id &&
+         frame.asset_body_id == other.asset_body_id &&
+         frame.asset_type == other.asset_type &&
+         frame.asset_num_params == other.asset_num_params &&
+         frame.asset_params == other.asset_params &&
+         frame.asset_color == other.asset_color &&
+         frame.mesh_names == other.mesh_names &&
+         frame.link_type == other.link_type &&
+         frame.link_num_params == other.link_num_params;
+}
+
+
+// -----------------------------------------------------------------------------
+// ChTrajectoryEncoder
+// -----------------------------------------------------------------------------
+ChTrajectoryEncoder::ChTrajectoryEncoder(double       pos_tol,
+                                         double       rot_tol,
+                                         unsigned int keyframe_interval)
+: m_pos_tol(pos_tol),
+  m_rot_tol(rot_tol),
+  m_interval(keyframe_interval > 0 ? keyframe_interval : 1),
+  m_since_key(0),
+  m_has_key(false)
+{
+}
+
+bool ChTrajectoryEncoder::Encode(const ShapesFrame& frame, std::vector<char>& buffer)
+{
+  double pos_step = 2 * m_pos_tol;
+  double rot_step = m_rot_tol / 2;
+
+  bool keyframe = !m_has_key || m_since_key >= m_interval || !m_key.Matches(frame);
+
+  m_record.clear();
+
+  if (keyframe) {
+    m_record.push_back((char) RECORD_KEYFRAME);
+    PackShapesBinary(frame, m_record);
+
+    m_key.Set(frame, pos_step, rot_step);
+    m_has_key = true;
+    m_since_key = 1;
+  } else {
+    size_t nb = frame.GetNumBodies();
+    size_t na = frame.GetNumAssets();
+    size_t np = NumPositions(frame);
+    size_t nr = NumRotations(frame);
+
+    m_record.push_back((char) RECORD_DELTA);
+    PutVarint(m_record, nb);
+    PutVarint(m_record, na);
+    PutVarint(m_record, frame.link_params.size());
+
+    // Active flags, bit-packed.
+    size_t offset = m_record.size();
+    m_record.resize(offset + (nb + na + 7) / 8, 0);
+    for (size_t i = 0; i < nb + na; i++) {
+      bool active = (i < nb) ? frame.body_active[i] != 0 : frame.asset_active[i - nb] != 0;
+      if (active)
+        m_record[offset + i / 8] |= (char) (1 << (i % 8));
+    }
+
+    // Positions and link data, as fixed-point deltas from the keyframe.
+    for (size_t i = 0; i < np; i++)
+      PutZigzag(m_record, Quantize(GetPosition(frame, i), pos_step) - m_key.pos[i]);
+
+    // Rotations in smallest-three form.
+    for (size_t i = 0; i < nr; i++) {
+      long long c[3];
+      unsigned char idx = QuantizeRotation(GetRotation(frame, i), rot_step, m_key.rot_index[i], c);
+      PutVarint(m_record, idx);
+      for (int k = 0; k < 3; k++)
+        PutZigzag(m_record, (idx == m_key.rot_index[i]) ? c[k] - m_key.rot[3 * i + k] : c[k]);
+    }
+
+    m_since_key++;
+  }
+
+  PutVarint(buffer, m_record.size());
+  buffer.insert(buffer.end(), m_record.begin(), m_record.end());
+
+  return keyframe;
+}
+
+
+// -----------------------------------------------------------------------------
+// ChTrajectoryDecoder
+// -----------------------------------------------------------------------------
+ChTrajectoryDecoder::ChTrajectoryDecoder(double pos_tol, double rot_tol)
+: m_pos_tol(pos_tol),
+  m_rot_tol(rot_tol),
+  m_has_key(false)
+{
+}
+
+bool ChTrajectoryDecoder::IsKeyframe(const char* data, size_t size)
+{
+  const char* cur = data;
+  uint64_t length;
+  return GetVarint(cur, data + size, length) && length > 0 && cur < data + size &&
+         *cur == (char) RECORD_KEYFRAME;
+}
+
+size_t ChTrajectoryDecoder::Decode(const char* data, size_t size, ShapesFrame& frame)
+{
+  double pos_step = 2 * m_pos_tol;
+  double rot_step = m_rot_tol / 2;
+
+  const char* cur = data;
+  const char* end = data + size;
+
+  uint64_t length;
+  if (!GetVarint(cur, end, length) || length == 0 || length > (uint64_t) (end - cur))
+    return 0;
+
+  end = cur + length;
+  char kind = *cur++;
+
+  if (kind == (char) RECORD_KEYFRAME) {
+    if (!UnpackShapesBinary(cur, end - cur, frame))
+      return 0;
+    m_key.Set(frame, pos_step, rot_step);
+    m_has_key = true;
+    return end - data;
+  }
+
+  if (kind != (char) RECORD_DELTA || !m_has_key)
+    return 0;
+
+  uint64_t nb, na, nlp;
+  if (!GetVarint(cur, end, nb) || !GetVarint(cur, end, na) || !GetVarint(cur, end, nlp))
+    return 0;
+
+  const ShapesFrame& key = m_key.frame;
+  if (nb != key.GetNumBodies() || na != key.GetNumAssets() || nlp != key.link_params.size())
+    return 0;
+
+  // Start from the keyframe (topology, colors, and shape data).
+  frame = key;
+
+  // Active flags
+  size_t nflags = (size_t) ((nb + na + 7) / 8);
+  if ((size_t) (end - cur) < nflags)
+    return 0;
+  for (size_t i = 0; i < nb + na; i++) {
+    unsigned char active = (cur[i / 8] >> (i % 8)) & 1;
+    if (i < nb)
+      frame.body_active[i] = active;
+    else
+      frame.asset_active[i - nb] = active;
+  }
+  cur += nflags;
+
+  // Positions and link data
+  size_t np = NumPositions(frame);
+  for (size_t i = 0; i < np; i++) {
+    long long d;
+    if (!GetZigzag(cur, end, d))
+      return 0;
+    *PositionRef(frame, i) = (m_key.pos[i] + d) * pos_step;
+  }
+
+  // Rotations
+  size_t nr = NumRotations(frame);
+  for (size_t i = 0; i < nr; i++) {
+    uint64_t  idx;
+    long long c[3];
+    if (!GetVarint(cur, end, idx) || idx > 3)
+      return 0;
+    for (int k = 0; k < 3; k++) {
+      if (!GetZigzag(cur, end, c[k]))
+        return 0;
+      if (idx == m_key.rot_index[i])
+        c[k] += m_key.rot[3 * i + k];
+    }
+    DequantizeRotation((unsigned char) idx, c, rot_step, RotationRef(frame, i));
+  }
+
+  return (cur == end) ? (size_t) (end - data) : 0;
+}
+
+
+// -----------------------------------------------------------------------------
+// ChTrajectoryWriter
+// -----------------------------------------------------------------------------
+ChTrajectoryWriter::ChTrajectoryWriter(double       pos_tol,
+                                       double       rot_tol,
+                                       unsigned int keyframe_interval)
+: m_encoder(pos_tol, rot_tol, keyframe_interval),
+  m_num_frames(0),
+  m_num_bytes(0)
+{
+}
+
+bool ChTrajectoryWriter::Open(const std::string& filename)
+{
+  Close();
+
+  m_file.open(filename.c_str(), std::ios::binary | std::ios::trunc);
+  if (!m_file.is_open())
+    return false;
+
+  m_buffer.clear();
+  m_buffer.insert(m_buffer.end(), TRAJECTORY_MAGIC, TRAJECTORY_MAGIC + 4);
+  PutRaw(m_buffer, TRAJECTORY_VERSION);
+  PutRaw(m_buffer, m_encoder.GetPosTolerance());
+  PutRaw(m_buffer, m_encoder.GetRotTolerance());
+  m_file.write(m_buffer.data(), m_buffer.size());
+
+  m_encoder.Reset();
+  m_num_frames = 0;
+  m_num_bytes = m_buffer.size();
+
+  return m_file.good();
+}
+
+bool ChTrajectoryWriter::Close()
+{
+  if (!m_file.is_open())
+    return false;
+
+  m_file.close();
+
+  return m_file.good();
+}
+
+bool ChTrajectoryWriter::AddFrame(const ShapesFrame& frame)
+{
+  m_buffer.clear();
+  m_encoder.Encode(frame, m_buffer);
+  m_file.write(m_buffer.data(), m_buffer.size());
+
+  if (!m_file.good())
+    return false;
+
+  m_num_frames++;
+  m_num_bytes += m_buffer.size();
+
+  return true;
+}
+
+bool ChTrajectoryWriter::AddFrame(ChSystem* system, bool body_info)
+{
+  UpdateShapesPlan(system, m_plan, ALL_BODIES);
+  CaptureShapes(m_plan, m_frame, body_info);
+  return AddFrame(m_frame);
+}
+
+
+// -----------------------------------------------------------------------------
+// ChTrajectoryReader
+// -----------------------------------------------------------------------------
+ChTrajectoryReader::ChTrajectoryReader()
+: m_offset(0),
+  m_pos_tol(0),
+  m_rot_tol(0)
+{
+}
+
+bool ChTrajectoryReader::Open(const std::string& filename)
+{
+  if (!m_file.Open(filename))
+    return false;
+
+  const char* cur = m_file.GetData();
+  const char* end = cur + m_file.GetSize();
+
+  uint32_t version;
+  if (m_file.GetSize() < 4 || std::memcmp(cur, TRAJECTORY_MAGIC, 4) != 0)
+    return false;
+  cur += 4;
+  if (!GetRaw(cur, end, version) || version != TRAJECTORY_VERSION)
+    return false;
+  if (!GetRaw(cur, end, m_pos_tol) || !GetRaw(cur, end, m_rot_tol))
+    return false;
+
+  m_decoder = ChTrajectoryDecoder(m_pos_tol, m_rot_tol);
+  m_offset = cur - m_file.GetData();
+
+  return true;
+}
+
+bool ChTrajectoryReader::ReadFrame(ShapesFrame& frame)
+{
+  if (!m_file.IsOpen() || m_offset >= m_file.GetSize())
+    return false;
+
+  size_t n = m_decoder.Decode(m_file.GetData() + m_offset, m_file.GetSize() - m_offset, frame);
+  m_offset += n;
+
+  return n > 0;
+}
+
+
+}  // namespace utils
+}  // namespace chrono
@@ -0,0 +1,212 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Radu Serban
+// =============================================================================
+//
+// Compressed trajectory streams of PovRay output frames.
+//
+// =============================================================================
+
+#ifndef CH_UTILS_TRAJECTORY_H
+#define CH_UTILS_TRAJECTORY_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+
+#include "physics/ChSystem.h"
+
+#include "utils/ChApiUtils.h"
+#include "utils/ChUtilsInputOutput.h"
+#include "utils/ChUtilsMappedFile.h"
+
+
+namespace chrono {
+namespace utils {
+
+
+///
+/// Reference state for delta-encoded frames: the last keyframe and its
+/// quantized positions (body and asset positions, link data) and quantized
+/// rotations (smallest-three components and index of the dropped component).
+///
+struct CH_UTILS_API ChTrajectoryKeyframe
+{
+  ShapesFrame                frame;
+  std::vector<long long>     pos;
+  std::vector<long long>     rot;
+  std::vector<unsigned char> rot_index;
+
+  /// Set the keyframe and compute its quantized values.
+  void Set(const ShapesFrame& key, double pos_step, double rot_step);
+
+  /// Return true if the given frame has the same topology (bodies, assets,
+  /// shapes, colors, and links) as the keyframe, so that it can be encoded as
+  /// a delta from it.
+  bool Matches(const ShapesFrame& other) const;
+};
+
+
+///
+/// Encoder for a stream of output frames.
+/// Every frame is appended to a buffer as a separate record. A keyframe (stored
+/// losslessly, in the binary frame format) is written periodically and whenever
+/// the topology changes. All other frames are stored as deltas from the last
+/// keyframe: positions and link data are quantized to fixed point, rotations
+/// are quantized in "smallest-three" form, and all integers are stored as
+/// zig-zag variable-length integers. Active flags are bit-packed.
+/// The absolute error of every decoded position (and link data value) is at
+/// most 'pos_tol' and the error of every component of a decoded (normalized)
+/// quaternion is at most 'rot_tol' (decoded quaternions may have a flipped
+/// sign).
+///
+class CH_UTILS_API ChTrajectoryEncoder
+{
+public:
+
+  ChTrajectoryEncoder(
+    double       pos_tol = 1e-5,            ///< maximum position error
+    double       rot_tol = 1e-5,            ///< maximum error of a rotation component
+    unsigned int keyframe_interval = 100    ///< maximum number of frames between keyframes
+    );
+
+  /// Append the record for the given frame to the buffer.
+  /// Return true if the frame was encoded as a keyframe.
+  bool Encode(const ShapesFrame& frame, std::vector<char>& buffer);
+
+  /// Force the next frame to be encoded as a keyframe.
+  void Reset() { m_since_key = 0; m_has_key = false; }
+
+  double GetPosTolerance() const { return m_pos_tol; }
+  double GetRotTolerance() const { return m_rot_tol; }
+
+private:
+
+  double                m_pos_tol;
+  double                m_rot_tol;
+  unsigned int          m_interval;
+  unsigned int          m_since_key;
+  bool                  m_has_key;
+  ChTrajectoryKeyframe  m_key;
+  std::vector<char>     m_record;
+};
+
+
+///
+/// Decoder for the records created by ChTrajectoryEncoder.
+/// A delta record can only be decoded after the keyframe it refers to.
+///
+class CH_UTILS_API ChTrajectoryDecoder
+{
+public:
+
+  ChTrajectoryDecoder(double pos_tol = 1e-5, double rot_tol = 1e-5);
+
+  /// Decode the record starting at 'data' (of at most 'size' bytes).
+  /// Return the number of bytes consumed, or 0 if the record is not valid.
+  size_t Decode(const char* data, size_t size, ShapesFrame& frame);
+
+  /// Return true if the given record is a keyframe.
+  static bool IsKeyframe(const char* data, size_t size);
+
+private:
+
+  double                m_pos_tol;
+  double                m_rot_tol;
+  bool                  m_has_key;
+  ChTrajectoryKeyframe  m_key;
+};
+
+
+///
+/// Compressed trajectory file.
+/// The file contains a header (magic "CHTR", version, position and rotation
+/// tolerances) followed by the frame records.
+///
+class CH_UTILS_API ChTrajectoryWriter
+{
+public:
+
+  ChTrajectoryWriter(
+    double       pos_tol = 1e-5,            ///< maximum position error
+    double       rot_tol = 1e-5,            ///< maximum error of a rotation component
+    unsigned int keyframe_interval = 100    ///< maximum number of frames between keyframes
+    );
+
+  ~ChTrajectoryWriter() { Close(); }
+
+  /// Create the specified trajectory file.
+  bool Open(const std::string& filename);
+
+  /// Close the trajectory file. Return false if the file was not open or if
+  /// any write failed (in which case the file is truncated).
+  bool Close();
+
+  /// Append a frame to the trajectory. Return false if the file cannot be
+  /// written; frames are encoded relative to the previous ones, so all later
+  /// frames are then lost as well.
+  bool AddFrame(const ShapesFrame& frame);
+
+  /// Capture the current state of the system and append it to the trajectory.
+  bool AddFrame(ChSystem* system, bool body_info = true);
+
+  /// Return the number of frames written so far.
+  size_t GetNumFrames() const { return m_num_frames; }
+  /// Return the number of bytes written so far.
+  size_t GetNumBytes() const { return m_num_bytes; }
+
+private:
+
+  ChTrajectoryEncoder  m_encoder;
+  std::ofstream        m_file;
+  std::vector<char>    m_buffer;
+  ShapesPlan           m_plan;
+  ShapesFrame          m_frame;
+  size_t               m_num_frames;
+  size_t               m_num_bytes;
+};
+
+///
+/// Sequential reader for compressed trajectory files.
+///
+class CH_UTILS_API ChTrajectoryReader
+{
+public:
+
+  ChTrajectoryReader();
+
+  /// Open the specified trajectory file. Return false if the file cannot be
+  /// opened or is not a trajectory file.
+  bool Open(const std::string& filename);
+
+  /// Decode the next frame. Return false at the end of the trajectory (or if
+  /// the file is corrupt).
+  bool ReadFrame(ShapesFrame& frame);
+
+  double GetPosTolerance() const { return m_pos_tol; }
+  double GetRotTolerance() const { return m_rot_tol; }
+
+private:
+
+  ChMappedFile         m_file;
+  size_t               m_offset;
+  double               m_pos_tol;
+  double               m_rot_tol;
+  ChTrajectoryDecoder  m_decoder;
+};
+
+
+} // namespace utils
+} // namespace chrono
+
+
+#endif
@@ -16,13 +16,386 @@
 //
 // =============================================================================
 
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
 #include "utils/ChUtilsValidation.h"
+#include "utils/ChUtilsFormat.h"
+#include "utils/ChUtilsMappedFile.h"
 
 namespace chrono {
 namespace utils {
 
 
 
+// -----------------------------------------------------------------------------
+// ChValidation::ComputeNorms
+//
+// All three norms of a column are obtained in a single pass over the data
+// (and, if present, the reference data), with no temporary arrays. The kernel
+// is vectorized for the instruction set enabled at compile time (AVX-512 or
+// AVX2); otherwise, the scalar loop uses independent accumulators so that the
+// compiler can vectorize it. Columns are processed in parallel for large data
+// sets.
+// -----------------------------------------------------------------------------
+static const size_t NORMS_PARALLEL_SIZE = 1 << 20;
+
+// Number of threads for the given budget (0: one per hardware thread).
+static size_t NumThreads(int num_threads)
+{
+  if (num_threads > 0)
+    return (size_t) num_threads;
+  return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+// Compute the sum of squares and the maximum absolute value of a - b (if DIFF
+// is true) or of a (otherwise).
+template <bool DIFF>
+static void ColumnNorms(const double* a, const double* b, size_t n, double& sum_sq, double& max_abs)
+{
+  size_t i = 0;
+  double sum = 0;
+  double max = 0;
+
+#if defined(__AVX512F__)
+  __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd();
+  __m512d m0 = _mm512_setzero_pd(), m1 = _mm512_setzero_pd();
+  for (; i + 16 <= n; i += 16) {
+    __m512d d0 = _mm512_loadu_pd(a + i);
+    __m512d d1 = _mm512_loadu_pd(a + i + 8);
+    if (DIFF) {
+      d0 = _mm512_sub_pd(d0, _mm512_loadu_pd(b + i));
+      d1 = _mm512_sub_pd(d1, _mm512_loadu_pd(b + i + 8));
+    }
+    s0 = _mm512_fmadd_pd(d0, d0, s0);
+    s1 = _mm512_fmadd_pd(d1, d1, s1);
+    m0 = _mm512_max_pd(m0, _mm512_abs_pd(d0));
+    m1 = _mm512_max_pd(m1, _mm512_abs_pd(d1));
+  }
+  sum = _mm512_reduce_add_pd(_mm512_add_pd(s0, s1));
+  max = _mm512_reduce_max_pd(_mm512_max_pd(m0, m1));
+#elif defined(__AVX2__)
+  const __m256d sign = _mm256_set1_pd(-0.0);
+  __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+  __m256d m0 = _mm256_setzero_pd(), m1 = _mm256_setzero_pd();
+  for (; i + 8 <= n; i += 8) {
+    __m256d d0 = _mm256_loadu_pd(a + i);
+    __m256d d1 = _mm256_loadu_pd(a + i + 4);
+    if (DIFF) {
+      d0 = _mm256_sub_pd(d0, _mm256_loadu_pd(b + i));
+      d1 = _mm256_sub_pd(d1, _mm256_loadu_pd(b + i + 4));
+    }
+#if defined(__FMA__)
+    s0 = _mm256_fmadd_pd(d0, d0, s0);
+    s1 = _mm256_fmadd_pd(d1, d1, s1);
+#else
+    s0 = _mm256_add_pd(s0, _mm256_mul_pd(d0, d0));
+    s1 = _mm256_add_pd(s1, _mm256_mul_pd(d1, d1));
+#endif
+    m0 = _mm256_max_pd(m0, _mm256_andnot_pd(sign, d0));
+    m1 = _mm256_max_pd(m1, _mm256_andnot_pd(sign, d1));
+  }
+  double s[4], m[4];
+  _mm256_storeu_pd(s, _mm256_add_pd(s0, s1));
+  _mm256_storeu_pd(m, _mm256_max_pd(m0, m1));
+  sum = (s[0] + s[1]) + (s[2] + s[3]);
+  max = std::max(std::max(m[0], m[1]), std::max(m[2], m[3]));
+#else
+  double s[4] = {0, 0, 0, 0};
+  double m[4] = {0, 0, 0, 0};
+  for (; i + 4 <= n; i += 4) {
+    for (int k = 0; k < 4; k++) {
+      double d = DIFF ? a[i + k] - b[i + k] : a[i + k];
+      s[k] += d * d;
+      m[k] = std::max(m[k], std::abs(d));
+    }
+  }
+  sum = (s[0] + s[1]) + (s[2] + s[3]);
+  max = std::max(std::max(m[0], m[1]), std::max(m[2], m[3]));
+#endif
+
+  for (; i < n; i++) {
+    double d = DIFF ? a[i] - b[i] : a[i];
+    sum += d * d;
+    max = std::max(max, std::abs(d));
+  }
+
+  sum_sq = sum;
+  max_abs = max;
+}
+
+// Process the data columns first, first + stride, ... (the time column is
+// excluded).
+static void ColumnNormsWorker(size_t        first,
+                              size_t        stride,
+                              const Data*   sim_data,
+                              const Data*   ref_data,
+                              DataVector*   sum_sq,
+                              DataVector*   max_abs)
+{
+  size_t num_rows = (*sim_data)[0].size();
+
+  for (size_t col = first; col < sum_sq->size(); col += stride) {
+    const double* a = &(*sim_data)[col + 1][0];
+    if (ref_data)
+      ColumnNorms<true>(a, &(*ref_data)[col + 1][0], num_rows, (*sum_sq)[col], (*max_abs)[col]);
+    else
+      ColumnNorms<false>(a, NULL, num_rows, (*sum_sq)[col], (*max_abs)[col]);
+  }
+}
+
+void ChValidation::ComputeNorms(const Data* ref_data)
+{
+  size_t num_data_cols = m_num_cols - 1;
+
+  DataVector sum_sq(0.0, num_data_cols);
+  DataVector max_abs(0.0, num_data_cols);
+
+  if (m_num_rows > 0) {
+    size_t num_threads = NumThreads(m_num_threads);
+    num_threads = std::min(num_threads, num_data_cols);
+    num_threads = std::min(num_threads, num_data_cols * m_num_rows / NORMS_PARALLEL_SIZE + 1);
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < num_threads; i++)
+      threads.push_back(std::thread(ColumnNormsWorker, i, num_threads, &m_sim_data, ref_data, &sum_sq, &max_abs));
+    ColumnNormsWorker(0, num_threads, &m_sim_data, ref_data, &sum_sq, &max_abs);
+    for (size_t i = 0; i < threads.size(); i++)
+      threads[i].join();
+  }
+
+  SetNorms(sum_sq, max_abs);
+}
+
+void ChValidation::ReportError() const
+{
+  if (m_verbose)
+    std::cout << "ERROR: " << m_error << std::endl;
+}
+
+void ChValidation::SetNorms(const DataVector& sum_sq, const DataVector& max_abs)
+{
+  size_t num_data_cols = sum_sq.size();
+
+  m_L2_norms.resize(num_data_cols);
+  m_RMS_norms.resize(num_data_cols);
+  m_INF_norms.resize(num_data_cols);
+
+  for (size_t col = 0; col < num_data_cols; col++) {
+    m_L2_norms[col] = std::sqrt(sum_sq[col]);
+    m_RMS_norms[col] = std::sqrt(sum_sq[col] / m_num_rows);
+    m_INF_norms[col] = max_abs[col];
+  }
+}
+
+
+// -----------------------------------------------------------------------------
+// ChValidation::ComputeResampledNorms
+//
+// The merged time grid is built with a single sweep over the two (sorted) time
+// columns, recording for each merged time the interval of each data set that
+// contains it and the relative position within that interval. Each column is
+// then interpolated and compared in a single pass over the merged grid.
+// Cubic interpolation uses Hermite polynomials with slopes estimated by
+// (non-uniform) three-point finite differences.
+// -----------------------------------------------------------------------------
+static const double TIME_TOLERANCE = 1e-10;
+
+struct ResampleGrid {
+  size_t               num_points;
+  std::vector<size_t>  sim_index;    ///< interval in the simulation data
+  std::vector<double>  sim_frac;     ///< relative position in that interval
+  std::vector<size_t>  ref_index;    ///< interval in the reference data
+  std::vector<double>  ref_frac;     ///< relative position in that interval
+};
+
+// Find the interval [t[k], t[k+1]] containing 'time', starting the search at
+// 'k' (which is updated), and return the relative position within it.
+static double LocateTime(const DataVector& t, double time, size_t& k)
+{
+  size_t n = t.size();
+  while (k + 2 < n && t[k + 1] <= time)
+    k++;
+
+  double h = t[k + 1] - t[k];
+  if (h <= 0)
+    return 0;
+
+  return std::min(std::max((time - t[k]) / h, 0.0), 1.0);
+}
+
+static void BuildResampleGrid(const DataVector& t_sim, const DataVector& t_ref, ResampleGrid& grid)
+{
+  size_t n_sim = t_sim.size();
+  size_t n_ref = t_ref.size();
+
+  double t_start = std::max(t_sim[0], t_ref[0]);
+  double t_end = std::min(t_sim[n_sim - 1], t_ref[n_ref - 1]);
+
+  grid.num_points = 0;
+  grid.sim_index.clear();
+  grid.sim_frac.clear();
+  grid.ref_index.clear();
+  grid.ref_frac.clear();
+
+  size_t capacity = n_sim + n_ref;
+  grid.sim_index.reserve(capacity);
+  grid.sim_frac.reserve(capacity);
+  grid.ref_index.reserve(capacity);
+  grid.ref_frac.reserve(capacity);
+
+  size_t i = 0;
+  size_t j = 0;
+  size_t k_sim = 0;
+  size_t k_ref = 0;
+  double last = -std::numeric_limits<double>::infinity();
+
+  while (i < n_sim || j < n_ref) {
+    // Next time in the merged sequence.
+    double time;
+    if (j >= n_ref || (i < n_sim && t_sim[i] <= t_ref[j]))
+      time = t_sim[i++];
+    else
+      time = t_ref[j++];
+
+    if (time < t_start - TIME_TOLERANCE)
+      continue;
+    if (time > t_end + TIME_TOLERANCE)
+      break;
+
+    // Times closer than the tolerance are considered equal.
+    if (time - last <= TIME_TOLERANCE)
+      continue;
+    last = time;
+
+    time = std::min(std::max(time, t_start), t_end);
+
+    grid.sim_frac.push_back(LocateTime(t_sim, time, k_sim));
+    grid.sim_index.push_back(k_sim);
+    grid.ref_frac.push_back(LocateTime(t_ref, time, k_ref));
+    grid.ref_index.push_back(k_ref);
+  }
+
+  grid.num_points = grid.sim_index.size();
+}
+
+// Estimate the slope at the k-th data point.
+static double Slope(const DataVector& t, const DataVector& y, size_t k)
+{
+  size_t n = t.size();
+  size_t k0 = (k > 0) ? k - 1 : k;
+  size_t k1 = (k + 1 < n) ? k + 1 : k;
+
+  double h0 = t[k] - t[k0];
+  double h1 = t[k1] - t[k];
+
+  if (h0 <= 0 && h1 <= 0)
+    return 0;
+  if (h0 <= 0)
+    return (y[k1] - y[k]) / h1;
+  if (h1 <= 0)
+    return (y[k] - y[k0]) / h0;
+
+  return ((y[k1] - y[k]) / h1 * h0 + (y[k] - y[k0]) / h0 * h1) / (h0 + h1);
+}
+
+template <bool CUBIC>
+static double Interpolate(const DataVector& t, const DataVector& y, size_t k, double s)
+{
+  double y0 = y[k];
+  double y1 = y[k + 1];
+
+  if (!CUBIC)
+    return y0 + s * (y1 - y0);
+
+  double h = t[k + 1] - t[k];
+  double s2 = s * s;
+  double s3 = s2 * s;
+
+  return (2 * s3 - 3 * s2 + 1) * y0 + (s3 - 2 * s2 + s) * h * Slope(t, y, k) +
+         (3 * s2 - 2 * s3) * y1 + (s3 - s2) * h * Slope(t, y, k + 1);
+}
+
+template <bool CUBIC>
+static void ResampledColumnNorms(const Data&         sim_data,
+                                 const Data&         ref_data,
+                                 size_t              col,
+                                 const ResampleGrid& grid,
+                                 double&             sum_sq,
+                                 double&             max_abs)
+{
+  const DataVector& t_sim = sim_data[0];
+  const DataVector& t_ref = ref_data[0];
+  const DataVector& y_sim = sim_data[col];
+  const DataVector& y_ref = ref_data[col];
+
+  double sum = 0;
+  double max = 0;
+
+  for (size_t p = 0; p < grid.num_points; p++) {
+    double d = Interpolate<CUBIC>(t_sim, y_sim, grid.sim_index[p], grid.sim_frac[p]) -
+               Interpolate<CUBIC>(t_ref, y_ref, grid.ref_index[p], grid.ref_frac[p]);
+    sum += d * d;
+    max = std::max(max, std::abs(d));
+  }
+
+  sum_sq = sum;
+  max_abs = max;
+}
+
+static void ResampledNormsWorker(size_t               first,
+                                 size_t               stride,
+                                 ChInterpolationType  interp_type,
+                                 const Data*          sim_data,
+                                 const Data*          ref_data,
+                                 const ResampleGrid*  grid,
+                                 DataVector*          sum_sq,
+                                 DataVector*          max_abs)
+{
+  for (size_t col = first; col < sum_sq->size(); col += stride) {
+    if (interp_type == CUBIC_INTERPOLATION)
+      ResampledColumnNorms<true>(*sim_data, *ref_data, col + 1, *grid, (*sum_sq)[col], (*max_abs)[col]);
+    else
+      ResampledColumnNorms<false>(*sim_data, *ref_data, col + 1, *grid, (*sum_sq)[col], (*max_abs)[col]);
+  }
+}
+
+void ChValidation::ComputeResampledNorms(ChInterpolationType interp_type)
+{
+  size_t num_data_cols = m_num_cols - 1;
+
+  ResampleGrid grid;
+  BuildResampleGrid(m_sim_data[0], m_ref_data[0], grid);
+  m_num_rows = grid.num_points;
+
+  DataVector sum_sq(0.0, num_data_cols);
+  DataVector max_abs(0.0, num_data_cols);
+
+  size_t num_threads = NumThreads(m_num_threads);
+  num_threads = std::min(num_threads, num_data_cols);
+  num_threads = std::min(num_threads, num_data_cols * m_num_rows / NORMS_PARALLEL_SIZE + 1);
+
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < num_threads; i++)
+    threads.push_back(std::thread(ResampledNormsWorker, i, num_threads, interp_type,
+                                  &m_sim_data, &m_ref_data, &grid, &sum_sq, &max_abs));
+  ResampledNormsWorker(0, num_threads, interp_type, &m_sim_data, &m_ref_data, &grid, &sum_sq, &max_abs);
+  for (size_t i = 0; i < threads.size(); i++)
+    threads[i].join();
+
+  SetNorms(sum_sq, max_abs);
+}
+
+
 // -----------------------------------------------------------------------------
 // -----------------------------------------------------------------------------
 bool ChValidation::Process(const std::string& sim_filename,
@@ -30,11 +403,11 @@ bool ChValidation::Process(const std::string& sim_filename,
                            char               delim)
 {
   // Read the simulation results file.
-  m_num_rows = ReadDataFile(sim_filename, delim, m_sim_headers, m_sim_data);
+  m_num_rows = ReadDataFile(sim_filename, delim, m_sim_headers, m_sim_data, m_num_threads);
   m_num_cols = m_sim_headers.size();
 
   // Read the reference data file.
-  size_t num_ref_rows = ReadDataFile(ref_filename, delim, m_ref_headers, m_ref_data);
+  size_t num_ref_rows = ReadDataFile(ref_filename, delim, m_ref_headers, m_ref_data, m_num_threads);
 
   // Resize the arrays of norms to zero length
   // (needed if we return with an error below)
@@ -42,39 +415,127 @@ bool ChValidation::Process(const std::string& sim_filename,
   m_RMS_norms.resize(0);
   m_INF_norms.resize(0);
 
+  m_error.clear();
+
   // Perform some sanity checks.
+  if (m_num_cols == 0 || m_ref_headers.size() == 0) {
+    m_error = "cannot read data from " + (m_num_cols == 0 ? sim_filename : ref_filename);
+    ReportError();
+    return false;
+  }
+
   if (m_num_cols != m_ref_headers.size()) {
-    std::cout << "ERROR: the number of columns in the two files is different:" << std::endl;
-    std::cout << "   File " << sim_filename << " has " << m_num_cols << " columns" << std::endl;
-    std::cout << "   File " << ref_filename << " has " << m_ref_headers.size() << " columns" << std::endl;
+    std::stringstream msg;
+    msg << "the number of columns in the two files is different (" << m_num_cols << " vs. "
+        << m_ref_headers.size() << ")";
+    m_error = msg.str();
+    if (m_verbose) {
+      std::cout << "ERROR: the number of columns in the two files is different:" << std::endl;
+      std::cout << "   File " << sim_filename << " has " << m_num_cols << " columns" << std::endl;
+      std::cout << "   File " << ref_filename << " has " << m_ref_headers.size() << " columns" << std::endl;
+    }
     return false;
   }
 
   if (m_num_rows != num_ref_rows) {
-    std::cout << "ERROR: the number of rows in the two files is different:" << std::endl;
-    std::cout << "   File " << sim_filename << " has " << m_num_rows << " columns" << std::endl;
-    std::cout << "   File " << ref_filename << " has " << num_ref_rows << " columns" << std::endl;
+    std::stringstream msg;
+    msg << "the number of rows in the two files is different (" << m_num_rows << " vs. "
+        << num_ref_rows << ")";
+    m_error = msg.str();
+    if (m_verbose) {
+      std::cout << "ERROR: the number of rows in the two files is different:" << std::endl;
+      std::cout << "   File " << sim_filename << " has " << m_num_rows << " columns" << std::endl;
+      std::cout << "   File " << ref_filename << " has " << num_ref_rows << " columns" << std::endl;
+    }
     return false;
   }
 
   // Ensure that the first columns (time) are the same.
-  if (L2norm(m_sim_data[0] - m_ref_data[0]) > 1e-10) {
-    std::cout << "ERROR: time sequences do not match." << std::endl;
+  double time_sum_sq = 0, time_max_abs = 0;
+  if (m_num_rows > 0)
+    ColumnNorms<true>(&m_sim_data[0][0], &m_ref_data[0][0], m_num_rows, time_sum_sq, time_max_abs);
+  if (std::sqrt(time_sum_sq) > 1e-10) {
+    m_error = "time sequences do not match";
+    ReportError();
     return false;
   }
 
-  // Resize arrays of norms.
-  m_L2_norms.resize(m_num_cols - 1);
-  m_RMS_norms.resize(m_num_cols - 1);
-  m_INF_norms.resize(m_num_cols - 1);
-
   // Calculate norms of the differences.
-  for (size_t col = 0; col < m_num_cols - 1; col++) {
-    m_L2_norms[col] = L2norm(m_sim_data[col + 1] - m_ref_data[col + 1]);
-    m_RMS_norms[col] = RMSnorm(m_sim_data[col + 1] - m_ref_data[col + 1]);
-    m_INF_norms[col] = INFnorm(m_sim_data[col + 1] - m_ref_data[col + 1]);
+  ComputeNorms(&m_ref_data);
+
+  return true;
+}
+
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+static bool IsNonDecreasing(const DataVector& t)
+{
+  for (size_t i = 1; i < t.size(); i++) {
+    if (!(t[i] >= t[i - 1]))
+      return false;
+  }
+  return true;
+}
+
+bool ChValidation::ProcessResampled(const std::string&  sim_filename,
+                                    const std::string&  ref_filename,
+                                    ChInterpolationType interp_type,
+                                    char                delim)
+{
+  // Read the simulation results file.
+  m_num_rows = ReadDataFile(sim_filename, delim, m_sim_headers, m_sim_data, m_num_threads);
+  m_num_cols = m_sim_headers.size();
+
+  // Read the reference data file.
+  size_t num_ref_rows = ReadDataFile(ref_filename, delim, m_ref_headers, m_ref_data, m_num_threads);
+
+  // Resize the arrays of norms to zero length
+  // (needed if we return with an error below)
+  m_L2_norms.resize(0);
+  m_RMS_norms.resize(0);
+  m_INF_norms.resize(0);
+
+  m_error.clear();
+
+  // Perform some sanity checks.
+  if (m_num_cols == 0 || m_ref_headers.size() == 0) {
+    m_error = "cannot read data from " + (m_num_cols == 0 ? sim_filename : ref_filename);
+    ReportError();
+    return false;
+  }
+
+  if (m_num_cols != m_ref_headers.size()) {
+    std::stringstream msg;
+    msg << "the number of columns in the two files is different (" << m_num_cols << " vs. "
+        << m_ref_headers.size() << ")";
+    m_error = msg.str();
+    ReportError();
+    return false;
+  }
+
+  if (m_num_rows < 2 || num_ref_rows < 2) {
+    m_error = "at least two rows are required for interpolation";
+    ReportError();
+    return false;
   }
 
+  if (!IsNonDecreasing(m_sim_data[0]) || !IsNonDecreasing(m_ref_data[0])) {
+    m_error = "time values are not sorted";
+    ReportError();
+    return false;
+  }
+
+  if (std::max(m_sim_data[0][0], m_ref_data[0][0]) >
+      std::min(m_sim_data[0][m_num_rows - 1], m_ref_data[0][num_ref_rows - 1])) {
+    m_error = "time intervals do not overlap";
+    ReportError();
+    return false;
+  }
+
+  // Calculate norms of the differences on the merged time grid.
+  ComputeResampledNorms(interp_type);
+
   return true;
 }
 
@@ -85,88 +546,673 @@ bool ChValidation::Process(const std::string& sim_filename,
                            char               delim)
 {
   // Read the simulation results file.
-  m_num_rows = ReadDataFile(sim_filename, delim, m_sim_headers, m_sim_data);
+  m_num_rows = ReadDataFile(sim_filename, delim, m_sim_headers, m_sim_data, m_num_threads);
   m_num_cols = m_sim_headers.size();
 
-  // Resize arrays of norms.
-  m_L2_norms.resize(m_num_cols - 1);
-  m_RMS_norms.resize(m_num_cols - 1);
-  m_INF_norms.resize(m_num_cols - 1);
+  m_error.clear();
 
-  // Calculate norms of the column vectors.
-  for (size_t col = 0; col < m_num_cols - 1; col++) {
-    m_L2_norms[col] = L2norm(m_sim_data[col + 1]);
-    m_RMS_norms[col] = RMSnorm(m_sim_data[col + 1]);
-    m_INF_norms[col] = INFnorm(m_sim_data[col + 1]);
+  if (m_num_cols == 0) {
+    m_L2_norms.resize(0);
+    m_RMS_norms.resize(0);
+    m_INF_norms.resize(0);
+    m_error = "cannot read data from " + sim_filename;
+    ReportError();
+    return false;
   }
 
+  // Calculate norms of the column vectors.
+  ComputeNorms(NULL);
+
   return true;
 }
 
 // -----------------------------------------------------------------------------
+// ChValidation::ReadDataFile
+//
+// The file is memory-mapped and parsed in a single pass. Large files are split
+// (at line boundaries) into chunks which are parsed concurrently. Values are
+// read into column buffers (grown geometrically, starting from an estimate
+// based on the length of the first data line) and copied once into the output
+// data table. Blank lines are ignored, missing values are set to 0, and values
+// beyond the number of header columns are ignored.
 // -----------------------------------------------------------------------------
-double ChValidation::L2norm(const DataVector& v)
+static const size_t DATA_CHUNK_SIZE = 4 << 20;
+
+static bool IsBlank(char c, char delim)
 {
-  return std::sqrt((v * v).sum());
+  return c == ' ' || c == '\t' || c == '\r' || c == delim;
 }
 
-double ChValidation::RMSnorm(const DataVector& v)
+static const char* NextLine(const char* cur, const char* end)
 {
-  return std::sqrt((v * v).sum() / v.size());
+  const char* eol = (const char*) std::memchr(cur, '\n', end - cur);
+  return eol ? eol + 1 : end;
 }
 
-double ChValidation::INFnorm(const DataVector& v)
+struct DataChunk {
+  const char*                        begin;
+  const char*                        end;
+  size_t                             num_rows;
+  std::vector<std::vector<double> >  columns;
+};
+
+// Parse the values of a data row into 'vals'. Return false if the line is blank.
+static bool ParseDataRow(const char* p, const char* eol, char delim, size_t num_cols, double* vals)
 {
-   return std::abs(v).max();
+  while (p < eol && IsBlank(*p, delim))
+    p++;
+
+  if (p == eol)
+    return false;
+
+  for (size_t col = 0; col < num_cols; col++) {
+    double val = 0;
+    if (p < eol) {
+      const char* next = ChTextScanner::ParseDouble(p, eol, val);
+      if (next == p) {
+        // Not a number: skip the token.
+        while (next < eol && !IsBlank(*next, delim))
+          next++;
+      }
+      p = next;
+      while (p < eol && IsBlank(*p, delim))
+        p++;
+    }
+    vals[col] = val;
+  }
+
+  return true;
 }
 
+// Skip the two description lines and read the column headers. Return the
+// position of the first data line.
+static const char* ParseDataHeader(const char* cur, const char* end, char delim, Headers& headers)
+{
+  cur = NextLine(cur, end);
+  cur = NextLine(cur, end);
+
+  const char* eol = NextLine(cur, end);
+  const char* line_end = eol;
+  while (line_end > cur && (line_end[-1] == '\n' || line_end[-1] == '\r'))
+    line_end--;
+
+  while (cur < line_end) {
+    const char* next = (const char*) std::memchr(cur, delim, line_end - cur);
+    if (!next)
+      next = line_end;
+    headers.push_back(std::string(cur, next));
+    cur = (next < line_end) ? next + 1 : line_end;
+  }
+
+  return eol;
+}
+
+static void ParseDataChunk(DataChunk* chunk, char delim, size_t num_cols)
+{
+  const char* cur = chunk->begin;
+  const char* end = chunk->end;
+
+  // Estimate the number of rows from the length of the first data line (but
+  // never more than the number of rows with one character per value).
+  size_t line_length = NextLine(cur, end) - cur;
+  size_t estimate = std::min((end - cur) / std::max(line_length, (size_t) 1),
+                             (end - cur) / (2 * num_cols)) + 1;
+
+  chunk->columns.resize(num_cols);
+  for (size_t col = 0; col < num_cols; col++)
+    chunk->columns[col].reserve(estimate);
+
+  std::vector<double> row(num_cols);
+  size_t num_rows = 0;
+
+  while (cur < end) {
+    const char* eol = (const char*) std::memchr(cur, '\n', end - cur);
+    if (!eol)
+      eol = end;
+
+    if (ParseDataRow(cur, eol, delim, num_cols, &row[0])) {
+      for (size_t col = 0; col < num_cols; col++)
+        chunk->columns[col].push_back(row[col]);
+      num_rows++;
+    }
+
+    cur = (eol < end) ? eol + 1 : end;
+  }
+
+  chunk->num_rows = num_rows;
+}
 
-// -----------------------------------------------------------------------------
-// -----------------------------------------------------------------------------
 size_t ChValidation::ReadDataFile(const std::string& filename,
                                   char               delim,
                                   Headers&           headers,
-                                  Data&              data)
+                                  Data&              data,
+                                  int                num_threads)
 {
-  std::ifstream ifile(filename.c_str());
-  std::string   line;
+  headers.clear();
+  data.clear();
 
-  // Count the number of lines in the file then rewind the input file stream.
-  size_t num_lines = std::count(std::istreambuf_iterator<char>(ifile),
-                                std::istreambuf_iterator<char>(), '\n');
-  ifile.seekg(0, ifile.beg);
+  ChMappedFile file;
+  if (!file.Open(filename) || file.GetSize() == 0)
+    return 0;
 
-  size_t num_data_points = num_lines - 3;
+  const char* cur = file.GetData();
+  const char* end = cur + file.GetSize();
 
-  // Skip the first two lines.
-  std::getline(ifile, line);
-  std::getline(ifile, line);
+  cur = ParseDataHeader(cur, end, delim, headers);
 
-  // Read the line with column headers.
-  std::getline(ifile, line);
-  std::stringstream iss1(line);
-  std::string col_header = "";
+  size_t num_cols = headers.size();
+  if (num_cols == 0)
+    return 0;
 
-  while (std::getline(iss1, col_header, delim))
-    headers.push_back(col_header);
+  // Split the data into chunks, at line boundaries.
+  size_t num_chunks = std::min(NumThreads(num_threads), (size_t) (end - cur) / DATA_CHUNK_SIZE + 1);
+  size_t chunk_size = (end - cur) / num_chunks + 1;
 
-  size_t num_cols = headers.size();
+  std::vector<DataChunk> chunks(num_chunks);
+  for (size_t i = 0; i < num_chunks; i++) {
+    chunks[i].begin = cur;
+    cur = (i == num_chunks - 1) ? end : NextLine(std::min(cur + chunk_size, end), end);
+    chunks[i].end = cur;
+  }
+
+  // Read the actual data.
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < num_chunks; i++)
+    threads.push_back(std::thread(ParseDataChunk, &chunks[i], delim, num_cols));
+  ParseDataChunk(&chunks[0], delim, num_cols);
+  for (size_t i = 0; i < threads.size(); i++)
+    threads[i].join();
+
+  // Copy the columns into the data table.
+  size_t num_rows = 0;
+  for (size_t i = 0; i < num_chunks; i++)
+    num_rows += chunks[i].num_rows;
 
-  // Resize data
   data.resize(num_cols);
-  for (size_t col = 0; col < num_cols; col++)
-    data[col].resize(num_data_points);
+  for (size_t col = 0; col < num_cols; col++) {
+    data[col].resize(num_rows);
+    size_t row = 0;
+    for (size_t i = 0; i < num_chunks; i++) {
+      const std::vector<double>& v = chunks[i].columns[col];
+      std::copy(v.begin(), v.begin() + chunks[i].num_rows, &data[col][row]);
+      row += chunks[i].num_rows;
+      std::vector<double>().swap(chunks[i].columns[col]);
+    }
+  }
 
-  // Read the actual data, one line at a time.
-  size_t row = 0;
-  while (std::getline(ifile, line)) {
-    std::stringstream iss(line);
-    for (size_t col = 0; col < num_cols; col++)
-      iss >> data[col][row];
-    row++;
+  return num_rows;
+}
+
+
+// -----------------------------------------------------------------------------
+// ChValidation::ProcessSelected
+//
+// Each file is mapped and read in blocks of ROW_BLOCK_SIZE rows. Only the
+// fields of the time column and of the selected columns are converted; the
+// other fields are skipped, and the rest of a line is skipped altogether after
+// the last selected field. Blocks are stored column-major, so that the fused
+// norm kernel can be applied to each selected column of a block.
+// -----------------------------------------------------------------------------
+static const size_t ROW_BLOCK_SIZE = 4096;
+
+struct SelectedColumnReader {
+  ChMappedFile         file;
+  const char*          cur;
+  const char*          end;
+  char                 delim;
+  Headers              headers;
+  std::vector<size_t>  fields;    ///< sorted indices of the fields to parse
+  std::vector<double>  block;     ///< current block (one segment per field)
+
+  bool Open(const std::string& filename, char file_delim)
+  {
+    if (!file.Open(filename) || file.GetSize() == 0)
+      return false;
+
+    delim = file_delim;
+    cur = file.GetData();
+    end = cur + file.GetSize();
+    cur = ParseDataHeader(cur, end, delim, headers);
+
+    return !headers.empty();
+  }
+
+  // Select the time column and the specified columns. On return, 'slots'
+  // contains the position of each specified column in the block (the time
+  // column is always at position 0). Return false (and the name of the first
+  // column not found) if a column does not exist.
+  bool Select(const Headers& columns, std::vector<size_t>& slots, std::string& missing)
+  {
+    std::vector<size_t> indices(columns.size());
+    for (size_t i = 0; i < columns.size(); i++) {
+      Headers::const_iterator it = std::find(headers.begin() + 1, headers.end(), columns[i]);
+      if (it == headers.end()) {
+        missing = columns[i];
+        return false;
+      }
+      indices[i] = it - headers.begin();
+    }
+
+    fields.assign(1, 0);
+    fields.insert(fields.end(), indices.begin(), indices.end());
+    std::sort(fields.begin(), fields.end());
+    fields.erase(std::unique(fields.begin(), fields.end()), fields.end());
+
+    slots.resize(columns.size());
+    for (size_t i = 0; i < columns.size(); i++)
+      slots[i] = std::lower_bound(fields.begin(), fields.end(), indices[i]) - fields.begin();
+
+    block.resize(fields.size() * ROW_BLOCK_SIZE);
+
+    return true;
+  }
+
+  // Read the next block of (non-blank) rows. Return the number of rows read.
+  size_t ReadBlock()
+  {
+    size_t last_field = fields.back();
+    size_t num_rows = 0;
+
+    while (num_rows < ROW_BLOCK_SIZE && cur < end) {
+      const char* eol = (const char*) std::memchr(cur, '\n', end - cur);
+      if (!eol)
+        eol = end;
+
+      const char* p = cur;
+      while (p < eol && IsBlank(*p, delim))
+        p++;
+
+      if (p < eol) {
+        size_t k = 0;
+        for (size_t field = 0; field <= last_field; field++) {
+          if (field == fields[k]) {
+            double val = 0;
+            const char* next = (p < eol) ? ChTextScanner::ParseDouble(p, eol, val) : p;
+            block[k * ROW_BLOCK_SIZE + num_rows] = val;
+            p = next;
+            k++;
+          }
+          // Skip the rest of the field (all of it, if not selected).
+          while (p < eol && !IsBlank(*p, delim))
+            p++;
+          while (p < eol && IsBlank(*p, delim))
+            p++;
+        }
+        num_rows++;
+      }
+
+      cur = (eol < end) ? eol + 1 : end;
+    }
+
+    return num_rows;
+  }
+
+  const double* GetColumn(size_t slot) const { return &block[slot * ROW_BLOCK_SIZE]; }
+};
+
+bool ChValidation::ProcessSelected(const std::string& sim_filename,
+                                   const std::string& ref_filename,
+                                   const Headers&     columns,
+                                   char               delim)
+{
+  m_num_rows = 0;
+  m_num_cols = 0;
+  m_sim_headers.clear();
+  m_ref_headers.clear();
+  m_sim_data.clear();
+  m_ref_data.clear();
+  m_L2_norms.resize(0);
+  m_RMS_norms.resize(0);
+  m_INF_norms.resize(0);
+  m_error.clear();
+
+  bool has_ref = !ref_filename.empty();
+
+  SelectedColumnReader sim;
+  SelectedColumnReader ref;
+
+  if (!sim.Open(sim_filename, delim) || (has_ref && !ref.Open(ref_filename, delim))) {
+    m_error = "cannot read data from " + (sim.headers.empty() ? sim_filename : ref_filename);
+    ReportError();
+    return false;
+  }
+
+  // Select the requested columns (all data columns, if none specified).
+  Headers selected(columns);
+  if (selected.empty())
+    selected.assign(sim.headers.begin() + 1, sim.headers.end());
+
+  std::vector<size_t> sim_slots;
+  std::vector<size_t> ref_slots;
+  std::string missing;
+
+  if (!sim.Select(selected, sim_slots, missing)) {
+    m_error = "column " + missing + " not found in " + sim_filename;
+    ReportError();
+    return false;
+  }
+
+  if (has_ref && !ref.Select(selected, ref_slots, missing)) {
+    m_error = "column " + missing + " not found in " + ref_filename;
+    ReportError();
+    return false;
+  }
+
+  size_t num_data_cols = selected.size();
+
+  m_num_cols = num_data_cols + 1;
+  m_sim_headers.push_back(sim.headers[0]);
+  m_sim_headers.insert(m_sim_headers.end(), selected.begin(), selected.end());
+  if (has_ref) {
+    m_ref_headers.push_back(ref.headers[0]);
+    m_ref_headers.insert(m_ref_headers.end(), selected.begin(), selected.end());
+  }
+
+  // Accumulate the norms block by block.
+  DataVector sum_sq(0.0, num_data_cols);
+  DataVector max_abs(0.0, num_data_cols);
+  double time_sum_sq = 0;
+
+  for (;;) {
+    size_t num_rows = sim.ReadBlock();
+    size_t num_ref_rows = has_ref ? ref.ReadBlock() : num_rows;
+
+    if (num_rows != num_ref_rows) {
+      m_error = "the number of rows in the two files is different";
+      ReportError();
+      return false;
+    }
+
+    if (num_rows == 0)
+      break;
+
+    m_num_rows += num_rows;
+
+    for (size_t col = 0; col < num_data_cols; col++) {
+      double s, m;
+      if (has_ref)
+        ColumnNorms<true>(sim.GetColumn(sim_slots[col]), ref.GetColumn(ref_slots[col]), num_rows, s, m);
+      else
+        ColumnNorms<false>(sim.GetColumn(sim_slots[col]), NULL, num_rows, s, m);
+      sum_sq[col] += s;
+      max_abs[col] = std::max(max_abs[col], m);
+    }
+
+    // Ensure that the first columns (time) are the same.
+    if (has_ref) {
+      double s, m;
+      ColumnNorms<true>(sim.GetColumn(0), ref.GetColumn(0), num_rows, s, m);
+      time_sum_sq += s;
+      if (std::sqrt(time_sum_sq) > 1e-10) {
+        m_error = "time sequences do not match";
+        ReportError();
+        return false;
+      }
+    }
+  }
+
+  SetNorms(sum_sq, max_abs);
+
+  return true;
+}
+
+
+// -----------------------------------------------------------------------------
+// ChStreamingValidation
+// -----------------------------------------------------------------------------
+ChStreamingValidation::ChStreamingValidation()
+: m_num_cols(0),
+  m_num_rows(0),
+  m_num_ref_rows(0),
+  m_has_tolerance(false),
+  m_norm_type(L2_NORM),
+  m_tolerance(0),
+  m_failed(false),
+  m_time_sum_sq(0),
+  m_ref_data(NULL),
+  m_ref_cur(NULL),
+  m_ref_end(NULL),
+  m_ref_delim('\t')
+{
+}
+
+void ChStreamingValidation::Reset(size_t num_cols)
+{
+  m_num_cols = num_cols;
+  m_num_rows = 0;
+  m_num_ref_rows = 0;
+  m_failed = false;
+  m_error.clear();
+
+  m_sum_sq.assign(num_cols, 0.0);
+  m_max_abs.assign(num_cols, 0.0);
+  m_time_sum_sq = 0;
+
+  m_ref_data = NULL;
+  m_ref_file.Close();
+  m_ref_cur = NULL;
+  m_ref_end = NULL;
+  m_ref_headers.clear();
+  m_ref_row.clear();
+}
+
+void ChStreamingValidation::Initialize(size_t num_cols)
+{
+  Reset(num_cols);
+}
+
+bool ChStreamingValidation::Initialize(const Data& ref_data)
+{
+  if (ref_data.empty()) {
+    Reset(0);
+    return Fail("empty reference data");
+  }
+
+  Reset(ref_data.size() - 1);
+  m_ref_data = &ref_data;
+  m_num_ref_rows = ref_data[0].size();
+
+  return true;
+}
+
+bool ChStreamingValidation::Initialize(const std::string& ref_filename, char delim)
+{
+  Reset(0);
+
+  if (!m_ref_file.Open(ref_filename) || m_ref_file.GetSize() == 0)
+    return Fail("cannot read data from " + ref_filename);
+
+  const char* cur = m_ref_file.GetData();
+  const char* end = cur + m_ref_file.GetSize();
+
+  Headers headers;
+  m_ref_cur = ParseDataHeader(cur, end, delim, headers);
+  m_ref_end = end;
+  m_ref_delim = delim;
+
+  if (headers.empty())
+    return Fail("cannot read data from " + ref_filename);
+
+  m_num_cols = headers.size() - 1;
+  m_sum_sq.assign(m_num_cols, 0.0);
+  m_max_abs.assign(m_num_cols, 0.0);
+  m_ref_headers.swap(headers);
+  m_ref_row.resize(m_num_cols + 1);
+
+  return true;
+}
+
+void ChStreamingValidation::SetTolerance(ChNormType norm_type, double tolerance)
+{
+  m_has_tolerance = true;
+  m_norm_type = norm_type;
+  m_tolerance = tolerance;
+}
+
+bool ChStreamingValidation::Fail(const std::string& message)
+{
+  if (!m_failed) {
+    m_failed = true;
+    m_error = message;
+  }
+
+  return false;
+}
+
+// Read the next (non-blank) row from the reference file into m_ref_row.
+bool ChStreamingValidation::ReadReferenceRow()
+{
+  while (m_ref_cur < m_ref_end) {
+    const char* eol = (const char*) std::memchr(m_ref_cur, '\n', m_ref_end - m_ref_cur);
+    if (!eol)
+      eol = m_ref_end;
+
+    bool found = ParseDataRow(m_ref_cur, eol, m_ref_delim, m_num_cols + 1, &m_ref_row[0]);
+    m_ref_cur = (eol < m_ref_end) ? eol + 1 : m_ref_end;
+
+    if (found)
+      return true;
+  }
+
+  return false;
+}
+
+std::string ChStreamingValidation::ColumnName(size_t col) const
+{
+  std::stringstream name;
+  name << col + 1;
+  if (col + 1 < m_ref_headers.size())
+    name << " (" << m_ref_headers[col + 1] << ")";
+  return name.str();
+}
+
+bool ChStreamingValidation::AddRow(double time, const std::vector<double>& values)
+{
+  if (values.size() != m_num_cols)
+    return Fail("the number of values does not match the number of columns");
+
+  return AddRow(time, values.empty() ? NULL : &values[0]);
+}
+
+bool ChStreamingValidation::AddRow(double time, const double* values)
+{
+  if (m_failed)
+    return false;
+
+  // Locate the reference row, if any.
+  double ref_time = time;
+  const double* ref_values = NULL;
+
+  if (m_ref_data) {
+    if (m_num_rows >= m_num_ref_rows)
+      return Fail("there are more rows than in the reference data");
+    ref_time = (*m_ref_data)[0][m_num_rows];
+  } else if (!m_ref_row.empty()) {
+    if (!ReadReferenceRow())
+      return Fail("there are more rows than in the reference data");
+    ref_time = m_ref_row[0];
+    ref_values = &m_ref_row[1];
+  }
+
+  m_num_rows++;
+
+  // Ensure that the time sequences are the same (see ChValidation::Process).
+  m_time_sum_sq += (time - ref_time) * (time - ref_time);
+  if (std::sqrt(m_time_sum_sq) > 1e-10)
+    return Fail("time sequences do not match");
+
+  // Update the accumulators.
+  for (size_t col = 0; col < m_num_cols; col++) {
+    double diff = values[col];
+    if (m_ref_data)
+      diff -= (*m_ref_data)[col + 1][m_num_rows - 1];
+    else if (ref_values)
+      diff -= ref_values[col];
+
+    m_sum_sq[col] += diff * diff;
+    m_max_abs[col] = std::max(m_max_abs[col], std::abs(diff));
+  }
+
+  if (!m_has_tolerance)
+    return true;
+
+  // The L2 and infinity norms never decrease, so exceeding the tolerance is
+  // final. The RMS norm can be bounded from below only if the total number of
+  // rows is known.
+  double tol_sq = m_tolerance * m_tolerance;
+
+  for (size_t col = 0; col < m_num_cols; col++) {
+    bool exceeded = false;
+    switch (m_norm_type) {
+    case L2_NORM:  exceeded = m_sum_sq[col] > tol_sq; break;
+    case RMS_NORM: exceeded = m_num_ref_rows > 0 && m_sum_sq[col] > tol_sq * m_num_ref_rows; break;
+    case INF_NORM: exceeded = m_max_abs[col] > m_tolerance; break;
+    }
+
+    if (exceeded) {
+      std::stringstream msg;
+      msg << "column " << ColumnName(col) << " exceeds the tolerance at time " << time;
+      return Fail(msg.str());
+    }
+  }
+
+  return true;
+}
+
+bool ChStreamingValidation::Finalize()
+{
+  if (m_failed)
+    return false;
+
+  if (m_ref_data && m_num_rows < m_num_ref_rows)
+    return Fail("there are fewer rows than in the reference data");
+
+  if (!m_ref_row.empty() && ReadReferenceRow())
+    return Fail("there are fewer rows than in the reference data");
+
+  if (!m_has_tolerance)
+    return true;
+
+  DataVector norms;
+  switch (m_norm_type) {
+  case L2_NORM:  norms.resize(m_num_cols); norms = GetL2norms(); break;
+  case RMS_NORM: norms.resize(m_num_cols); norms = GetRMSnorms(); break;
+  case INF_NORM: norms.resize(m_num_cols); norms = GetINFnorms(); break;
+  }
+
+  for (size_t col = 0; col < m_num_cols; col++) {
+    if (norms[col] > m_tolerance) {
+      return Fail("column " + ColumnName(col) + " exceeds the tolerance");
+    }
   }
 
-  return row;
+  return true;
+}
+
+DataVector ChStreamingValidation::GetL2norms() const
+{
+  DataVector norms(m_num_cols);
+  for (size_t col = 0; col < m_num_cols; col++)
+    norms[col] = std::sqrt(m_sum_sq[col]);
+  return norms;
+}
+
+DataVector ChStreamingValidation::GetRMSnorms() const
+{
+  DataVector norms(0.0, m_num_cols);
+  if (m_num_rows > 0) {
+    for (size_t col = 0; col < m_num_cols; col++)
+      norms[col] = std::sqrt(m_sum_sq[col] / m_num_rows);
+  }
+  return norms;
+}
+
+DataVector ChStreamingValidation::GetINFnorms() const
+{
+  DataVector norms(m_num_cols);
+  for (size_t col = 0; col < m_num_cols; col++)
+    norms[col] = m_max_abs[col];
+  return norms;
 }
 
 
@@ -242,6 +1288,320 @@ bool Validate(const std::string& sim_filename,
 }
 
 
+// -----------------------------------------------------------------------------
+// ReadValidationManifest
+// -----------------------------------------------------------------------------
+static bool ParseNormType(const std::string& name, ChNormType& norm_type)
+{
+  std::string upper(name);
+  for (size_t i = 0; i < upper.size(); i++)
+    upper[i] = (char) std::toupper((unsigned char) upper[i]);
+
+  if (upper == "L2")       norm_type = L2_NORM;
+  else if (upper == "RMS") norm_type = RMS_NORM;
+  else if (upper == "INF") norm_type = INF_NORM;
+  else                     return false;
+
+  return true;
+}
+
+static bool IsAbsolutePath(const std::string& path)
+{
+  if (path.empty())
+    return false;
+  if (path[0] == '/' || path[0] == '\\')
+    return true;
+  return path.size() > 1 && path[1] == ':';
+}
+
+bool ReadValidationManifest(const std::string&             filename,
+                            std::vector<ChValidationJob>&  jobs,
+                            size_t&                        error_line)
+{
+  jobs.clear();
+  error_line = 0;
+
+  std::ifstream ifile(filename.c_str());
+  if (!ifile.is_open())
+    return false;
+
+  // Directory of the manifest (including the trailing separator).
+  std::string dir;
+  size_t sep = filename.find_last_of("/\\");
+  if (sep != std::string::npos)
+    dir = filename.substr(0, sep + 1);
+
+  std::string line;
+  size_t line_number = 0;
+
+  while (std::getline(ifile, line)) {
+    line_number++;
+
+    size_t comment = line.find('#');
+    if (comment != std::string::npos)
+      line.erase(comment);
+
+    std::istringstream iss(line);
+    std::string sim, ref, norm;
+    if (!(iss >> sim))
+      continue;
+
+    ChValidationJob job;
+    std::string extra;
+    if (!(iss >> ref >> norm >> job.tolerance) || (iss >> extra) || !ParseNormType(norm, job.norm_type)) {
+      error_line = line_number;
+      return false;
+    }
+
+    job.sim_filename = IsAbsolutePath(sim) ? sim : dir + sim;
+    if (ref != "-")
+      job.ref_filename = IsAbsolutePath(ref) ? ref : dir + ref;
+
+    jobs.push_back(job);
+  }
+
+  return true;
+}
+
+
+// -----------------------------------------------------------------------------
+// ValidateBatch
+//
+// Each worker owns a queue of job indices, initially dealt round-robin. A
+// worker takes jobs from the back of its own queue and, once that is empty,
+// steals from the front of the other queues, so that a few expensive jobs do
+// not leave the remaining workers idle.
+// -----------------------------------------------------------------------------
+struct ValidationQueue {
+  std::mutex          mutex;
+  std::deque<size_t>  jobs;
+};
+
+static void RunValidationJob(const ChValidationJob& job, ChValidationResult& result)
+{
+  // Jobs already run concurrently, so each one is processed on a single thread
+  // and its errors are only returned in the result.
+  ChValidation validator;
+  validator.SetNumThreads(1);
+  validator.SetVerbose(false);
+
+  result.processed = job.ref_filename.empty() ? validator.Process(job.sim_filename)
+                                              : validator.Process(job.sim_filename, job.ref_filename);
+  result.passed = false;
+  result.error = validator.GetErrorMessage();
+  result.failed_columns.clear();
+
+  if (!result.processed) {
+    result.headers.clear();
+    result.norms.resize(0);
+    return;
+  }
+
+  // Exclude the time column.
+  const Headers& headers = validator.GetHeadersSimData();
+  result.headers.assign(headers.begin() + 1, headers.end());
+  result.norms.resize(result.headers.size());
+
+  switch (job.norm_type) {
+  case L2_NORM:  result.norms = validator.GetL2norms(); break;
+  case RMS_NORM: result.norms = validator.GetRMSnorms(); break;
+  case INF_NORM: result.norms = validator.GetINFnorms(); break;
+  }
+
+  for (size_t col = 0; col < result.norms.size(); col++) {
+    if (!(result.norms[col] <= job.tolerance))
+      result.failed_columns.push_back(col);
+  }
+
+  result.passed = result.failed_columns.empty();
+}
+
+static void ValidationWorker(size_t                               id,
+                             std::vector<ValidationQueue>*        queues,
+                             const std::vector<ChValidationJob>*  jobs,
+                             std::vector<ChValidationResult>*     results)
+{
+  size_t num_queues = queues->size();
+
+  for (;;) {
+    size_t index = 0;
+    bool found = false;
+
+    // Own queue first (back), then the others (front).
+    for (size_t k = 0; k < num_queues && !found; k++) {
+      ValidationQueue& queue = (*queues)[(id + k) % num_queues];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (queue.jobs.empty())
+        continue;
+      if (k == 0) {
+        index = queue.jobs.back();
+        queue.jobs.pop_back();
+      } else {
+        index = queue.jobs.front();
+        queue.jobs.pop_front();
+      }
+      found = true;
+    }
+
+    // No jobs are ever added, so all queues being empty means we are done.
+    if (!found)
+      return;
+
+    RunValidationJob((*jobs)[index], (*results)[index]);
+  }
+}
+
+size_t ValidateBatch(const std::vector<ChValidationJob>&  jobs,
+                     std::vector<ChValidationResult>&     results,
+                     int                                  num_threads)
+{
+  results.clear();
+  results.resize(jobs.size());
+
+  if (jobs.empty())
+    return 0;
+
+  size_t num_workers = NumThreads(num_threads);
+  num_workers = std::min(num_workers, jobs.size());
+
+  std::vector<ValidationQueue> queues(num_workers);
+  for (size_t i = 0; i < jobs.size(); i++)
+    queues[i % num_workers].jobs.push_back(i);
+
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < num_workers; i++)
+    threads.push_back(std::thread(ValidationWorker, i, &queues, &jobs, &results));
+  ValidationWorker(0, &queues, &jobs, &results);
+  for (size_t i = 0; i < threads.size(); i++)
+    threads[i].join();
+
+  size_t num_failed = 0;
+  for (size_t i = 0; i < results.size(); i++) {
+    if (!results[i].passed)
+      num_failed++;
+  }
+
+  return num_failed;
+}
+
+
+// -----------------------------------------------------------------------------
+// WriteValidationReport
+// -----------------------------------------------------------------------------
+static void WriteJsonString(std::ostream& os, const std::string& str)
+{
+  os << '"';
+  for (size_t i = 0; i < str.size(); i++) {
+    unsigned char c = (unsigned char) str[i];
+    switch (c) {
+    case '"':  os << "\\\""; break;
+    case '\\': os << "\\\\"; break;
+    case '\n': os << "\\n"; break;
+    case '\r': os << "\\r"; break;
+    case '\t': os << "\\t"; break;
+    default:
+      if (c < 0x20) {
+        char buf[8];
+        sprintf(buf, "\\u%04x", c);
+        os << buf;
+      } else {
+        os << (char) c;
+      }
+    }
+  }
+  os << '"';
+}
+
+static void WriteJsonNumber(std::ostream& os, double val)
+{
+  // JSON has no representation for infinities and NaNs.
+  if (!(val - val == 0)) {
+    os << "null";
+    return;
+  }
+
+  char buf[FORMAT_BUFFER_SIZE];
+  os.write(buf, FormatDouble(val, buf));
+}
+
+static const char* NormTypeName(ChNormType norm_type)
+{
+  switch (norm_type) {
+  case L2_NORM:  return "L2";
+  case RMS_NORM: return "RMS";
+  case INF_NORM: return "INF";
+  }
+  return "";
+}
+
+bool WriteValidationReport(const std::string&                      filename,
+                           const std::vector<ChValidationJob>&     jobs,
+                           const std::vector<ChValidationResult>&  results)
+{
+  std::ofstream ofile(filename.c_str());
+  if (!ofile.is_open())
+    return false;
+
+  size_t num_passed = 0;
+  for (size_t i = 0; i < results.size(); i++) {
+    if (results[i].passed)
+      num_passed++;
+  }
+
+  ofile << "{\n";
+  ofile << "  \"num_jobs\": " << results.size() << ",\n";
+  ofile << "  \"num_passed\": " << num_passed << ",\n";
+  ofile << "  \"num_failed\": " << results.size() - num_passed << ",\n";
+  ofile << "  \"jobs\": [";
+
+  for (size_t i = 0; i < results.size(); i++) {
+    const ChValidationJob& job = jobs[i];
+    const ChValidationResult& result = results[i];
+
+    ofile << (i == 0 ? "\n" : ",\n") << "    {\n";
+    ofile << "      \"sim_file\": ";
+    WriteJsonString(ofile, job.sim_filename);
+    ofile << ",\n      \"ref_file\": ";
+    if (job.ref_filename.empty())
+      ofile << "null";
+    else
+      WriteJsonString(ofile, job.ref_filename);
+    ofile << ",\n      \"norm\": \"" << NormTypeName(job.norm_type) << "\"";
+    ofile << ",\n      \"tolerance\": ";
+    WriteJsonNumber(ofile, job.tolerance);
+    ofile << ",\n      \"processed\": " << (result.processed ? "true" : "false");
+    ofile << ",\n      \"passed\": " << (result.passed ? "true" : "false");
+    if (!result.error.empty()) {
+      ofile << ",\n      \"error\": ";
+      WriteJsonString(ofile, result.error);
+    }
+
+    ofile << ",\n      \"columns\": [";
+    for (size_t col = 0; col < result.headers.size(); col++) {
+      ofile << (col == 0 ? "\n" : ",\n") << "        {\"name\": ";
+      WriteJsonString(ofile, result.headers[col]);
+      ofile << ", \"norm\": ";
+      WriteJsonNumber(ofile, result.norms[col]);
+      ofile << "}";
+    }
+    ofile << (result.headers.empty() ? "]" : "\n      ]");
+
+    ofile << ",\n      \"failed_columns\": [";
+    for (size_t k = 0; k < result.failed_columns.size(); k++) {
+      if (k > 0)
+        ofile << ", ";
+      WriteJsonString(ofile, result.headers[result.failed_columns[k]]);
+    }
+    ofile << "]\n    }";
+  }
+
+  ofile << (results.empty() ? "]\n" : "\n  ]\n");
+  ofile << "}\n";
+
+  return ofile.good();
+}
+
+
 // -----------------------------------------------------------------------------
 // Functions for manipulating the validation data directory
 // -----------------------------------------------------------------------------
@@ -30,6 +30,7 @@
 #include <algorithm>
 
 #include "utils/ChApiUtils.h"
+#include "utils/ChUtilsMappedFile.h"
 
 
 namespace chrono {
@@ -42,6 +43,12 @@ enum ChNormType {
   INF_NORM
 };
 
+/// Interpolation types for validation on different time grids
+enum ChInterpolationType {
+  LINEAR_INTERPOLATION,
+  CUBIC_INTERPOLATION
+};
+
 /// Vector of data file headers.
 typedef std::vector<std::string> Headers;
 
@@ -64,9 +71,17 @@ class CH_UTILS_API ChValidation
 {
 public:
 
-  ChValidation() {}
+  ChValidation() : m_num_threads(0), m_verbose(true) {}
   ~ChValidation() {}
 
+  /// Set the maximum number of threads used to read the data files and to
+  /// calculate the norms (default 0: one per hardware thread).
+  void SetNumThreads(int num_threads) { m_num_threads = num_threads; }
+
+  /// Enable or disable printing of error messages to the console (default
+  /// enabled). Errors are always available through GetErrorMessage.
+  void SetVerbose(bool verbose) { m_verbose = verbose; }
+
   /// Read the data from the specified files and process it.
   /// Excluding the first column (which must contain identical values in the two
   /// input files), we subtract the data in corresponding columns in the two
@@ -77,6 +92,19 @@ public:
     char               delim = '\t'     ///< delimiter (default TAB)
     );
 
+  /// Read the data from the specified files and process it, allowing for
+  /// different time values in the two files.
+  /// Both data sets are resampled (with the specified interpolation) on the
+  /// union of the two time grids, restricted to the time interval covered by
+  /// both files, and we calculate the norms of the differences of the
+  /// resampled columns. The time values in each file must be non-decreasing.
+  bool ProcessResampled(
+    const std::string&  sim_filename,   ///< name of the file with simulation results
+    const std::string&  ref_filename,   ///< name of the file with reference data
+    ChInterpolationType interp_type,    ///< interpolation type
+    char                delim = '\t'    ///< delimiter (default TAB)
+    );
+
   /// Read the data in the specified file and process it.
   /// We calculate the vector norms of all columns except the first one.
   bool Process(
@@ -84,9 +112,27 @@ public:
     char               delim = '\t'     ///< delimiter (default TAB)
     );
 
+  /// Process only the specified columns (identified by their headers) of the
+  /// two files, or of the simulation file alone if 'ref_filename' is empty;
+  /// if no columns are specified, all columns are processed.
+  /// Unlike Process, the data is not loaded in memory: the files are read in
+  /// blocks of rows, of which only the time values and the selected columns are
+  /// parsed, and the norms are accumulated block by block. Memory use is thus
+  /// independent of the file length, and the data tables (see GetSimData and
+  /// GetRefData) remain empty. The norms are returned in the order of the
+  /// specified columns, and the headers are set to the time header followed by
+  /// the column headers.
+  bool ProcessSelected(
+    const std::string& sim_filename,    ///< name of the file with simulation results
+    const std::string& ref_filename,    ///< name of the file with reference data (may be empty)
+    const Headers&     columns,         ///< headers of the columns to process
+    char               delim = '\t'     ///< delimiter (default TAB)
+    );
+
   /// Return the number of data columns.
   size_t GetNumColumns() const { return m_num_cols; }
-  /// Return the number of rows.
+  /// Return the number of rows (for resampled data, the number of points on
+  /// the merged time grid).
   size_t GetNumRows() const { return m_num_rows; }
 
   /// Return the headers in the simulation data file.
@@ -99,6 +145,9 @@ public:
   /// Return the reference data.
   const Data& GetRefData() const { return m_ref_data; }
 
+  /// Return a description of the error, if processing failed.
+  const std::string& GetErrorMessage() const { return m_error; }
+
   /// Return the L2 norm for the specified column.
   double GetL2norm(size_t col) const { return m_L2_norms[col]; }
   /// Return the RMS norm for the specified column.
@@ -114,24 +163,33 @@ public:
   const DataVector& GetINFnorms() const { return m_INF_norms; }
 
   /// Read the specified data file.
-  /// The file is assumed to be delimited by the specified character.
-  /// The return value is the actual number of data points read from the file.
+  /// The file is assumed to be delimited by the specified character, with two
+  /// lines of description followed by a line of column headers. Blank lines are
+  /// ignored. The return value is the actual number of data points read from
+  /// the file (0 if the file cannot be read).
   static size_t ReadDataFile(
     const std::string& filename,        ///< [in] name of the data file
     char               delim,           ///< [in] delimiter
     Headers&           headers,         ///< [out] vector of column header strings
-    Data&              data             ///< [out] table of data values
+    Data&              data,            ///< [out] table of data values
+    int                num_threads = 0  ///< [in] maximum number of threads (0: one per hardware thread)
     );
 
 private:
 
-  double L2norm(const DataVector& v);
-  double RMSnorm(const DataVector& v);
-  double INFnorm(const DataVector& v);
+  void ComputeNorms(const Data* ref_data);
+  void ComputeResampledNorms(ChInterpolationType interp_type);
+  void SetNorms(const DataVector& sum_sq, const DataVector& max_abs);
+  void ReportError() const;
+
+  int    m_num_threads;
+  bool   m_verbose;
 
   size_t m_num_cols;
   size_t m_num_rows;
 
+  std::string m_error;
+
   Headers m_sim_headers;
   Headers m_ref_headers;
 
@@ -178,6 +236,180 @@ bool Validate(
           DataVector&        norms
           );
 
+///
+/// This class provides incremental validation of simulation results, without
+/// the need to write them to a data file first. It is fed one row at a time
+/// (typically after each call to DoStepDynamics) and maintains running L2, RMS
+/// and infinity norms for all data columns. As with ChValidation, these are
+/// either the norms of the differences from reference data (held in memory or
+/// read from a data file in lockstep with the simulation) or, if there is no
+/// reference, the norms of the columns themselves.
+/// If a tolerance is specified, the validation fails as soon as a norm is
+/// known to exceed it, so that a diverging simulation can be stopped early.
+///
+class CH_UTILS_API ChStreamingValidation
+{
+public:
+
+  ChStreamingValidation();
+  ~ChStreamingValidation() {}
+
+  /// Start a validation of the specified number of data columns (excluding
+  /// time) with no reference data.
+  void Initialize(size_t num_cols);
+
+  /// Start a validation against reference data in memory (with time values in
+  /// the first column). The data is not copied and must remain valid until the
+  /// validation is complete.
+  bool Initialize(const Data& ref_data);
+
+  /// Start a validation against the data in the specified reference file (see
+  /// ChValidation::ReadDataFile for the file format). One row of the file is
+  /// read with each call to AddRow.
+  bool Initialize(const std::string& ref_filename, char delim = '\t');
+
+  /// Set the norm type and tolerance used to decide whether the validation
+  /// failed. Without a tolerance, the validation fails only if the simulation
+  /// results do not match the reference data layout.
+  void SetTolerance(ChNormType norm_type, double tolerance);
+
+  /// Add a row of simulation results, with 'values' containing one value for
+  /// each data column. Return false if the validation has failed (with this or
+  /// an earlier row).
+  bool AddRow(double time, const double* values);
+  bool AddRow(double time, const std::vector<double>& values);
+
+  /// Complete the validation. This checks that all reference rows were used
+  /// and that the final norms are within the tolerance (if one was set).
+  /// Return true if the validation passed.
+  bool Finalize();
+
+  /// Return true if the validation has failed.
+  bool IsFailed() const { return m_failed; }
+  /// Return a description of the failure.
+  const std::string& GetErrorMessage() const { return m_error; }
+
+  /// Return the number of data columns (excluding time).
+  size_t GetNumColumns() const { return m_num_cols; }
+  /// Return the number of rows processed so far.
+  size_t GetNumRows() const { return m_num_rows; }
+
+  /// Return the headers in the reference data file.
+  const Headers& GetHeadersRefData() const { return m_ref_headers; }
+
+  /// Return the current L2 norms for all columns.
+  DataVector GetL2norms() const;
+  /// Return the current RMS norms for all columns.
+  DataVector GetRMSnorms() const;
+  /// Return the current infinity norms for all columns.
+  DataVector GetINFnorms() const;
+
+private:
+
+  void Reset(size_t num_cols);
+  bool ReadReferenceRow();
+  bool Fail(const std::string& message);
+  std::string ColumnName(size_t col) const;
+
+  size_t m_num_cols;
+  size_t m_num_rows;
+  size_t m_num_ref_rows;    ///< number of reference rows (0 if not known)
+
+  bool        m_has_tolerance;
+  ChNormType  m_norm_type;
+  double      m_tolerance;
+
+  bool        m_failed;
+  std::string m_error;
+
+  std::vector<double> m_sum_sq;     ///< running sums of squares
+  std::vector<double> m_max_abs;    ///< running maximum absolute values
+  double              m_time_sum_sq;
+
+  // In-memory reference data.
+  const Data* m_ref_data;
+
+  // Reference data file.
+  ChMappedFile        m_ref_file;
+  const char*         m_ref_cur;
+  const char*         m_ref_end;
+  char                m_ref_delim;
+  Headers             m_ref_headers;
+  std::vector<double> m_ref_row;
+};
+
+// -----------------------------------------------------------------------------
+// Batch validation
+// -----------------------------------------------------------------------------
+
+///
+/// Validation job: a simulation file compared against a reference file (or,
+/// if no reference file is given, a constraint violation file validated on
+/// its own) with the given norm type and tolerance.
+///
+struct CH_UTILS_API ChValidationJob {
+  std::string  sim_filename;
+  std::string  ref_filename;    ///< empty for a constraint violation file
+  ChNormType   norm_type;
+  double       tolerance;
+};
+
+///
+/// Result of a validation job.
+///
+struct CH_UTILS_API ChValidationResult {
+  bool                 processed;        ///< false if the files could not be processed
+  bool                 passed;           ///< true if all norms are below the tolerance
+  std::string          error;            ///< error message (if not processed)
+  Headers              headers;          ///< headers of the processed columns
+  DataVector           norms;            ///< norms of the processed columns
+  std::vector<size_t>  failed_columns;   ///< columns with norms above the tolerance
+};
+
+///
+/// Read a validation manifest.
+/// Each non-empty line of the manifest (other than comment lines, starting
+/// with '#') describes one job as
+///     sim_file  ref_file  norm  tolerance
+/// where 'ref_file' is '-' for a constraint violation file and 'norm' is one
+/// of L2, RMS, or INF. Relative file names are taken relative to the
+/// directory of the manifest. Return false (and the offending line number in
+/// 'error_line') if the manifest cannot be read or a line is invalid.
+///
+CH_UTILS_API
+bool ReadValidationManifest(
+          const std::string&             filename,
+          std::vector<ChValidationJob>&  jobs,
+          size_t&                        error_line
+          );
+
+///
+/// Process the given validation jobs concurrently.
+/// The jobs are distributed over a pool of worker threads (by default, one per
+/// hardware thread), each with its own job queue; a worker that runs out of
+/// jobs steals from the queues of the others. Each job is processed on a single
+/// thread, and errors are returned in its result rather than printed. The
+/// function returns the number of jobs that did not pass (including those that
+/// could not be processed).
+///
+CH_UTILS_API
+size_t ValidateBatch(
+          const std::vector<ChValidationJob>&  jobs,
+          std::vector<ChValidationResult>&     results,
+          int                                  num_threads = 0
+          );
+
+///
+/// Write a report of the given validation results in JSON format, with the
+/// per-column norms and failures of every job.
+///
+CH_UTILS_API
+bool WriteValidationReport(
+          const std::string&                      filename,
+          const std::vector<ChValidationJob>&     jobs,
+          const std::vector<ChValidationResult>&  results
+          );
+
 // -----------------------------------------------------------------------------
 // Global functions for accessing the reference validation data.
 // -----------------------------------------------------------------------------